@@ -1,125 +1,298 @@
 #include "Stronghold.h"
-// Save all game state to a single file
-bool GameSaver::saveGame(const Population& pop, const Army& army, const Economy& eco, 
+#include <cstdio>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+// Serializes appends to the score log (the save worker logs too)
+static std::mutex logMutex;
+
+// ================== Save Worker ==================
+
+// One saver's latest snapshot waiting to be written
+struct SaveJob {
+    const GameSaver* saver;
+    GameSnapshot snapshot;
+};
+
+struct SaveWorkerState {
+    std::thread writer;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::deque<SaveJob> queue;      // At most one job per saver, oldest first
+    const GameSaver* writing;       // Saver whose snapshot is being written, if any
+    bool stopping;
+};
+
+// Helper to check whether a saver has a snapshot queued or being written
+static bool isSaving(const SaveWorkerState& state, const GameSaver& saver) {
+    if (state.writing == &saver) return true;
+    for (size_t i = 0; i < state.queue.size(); i++) {
+        if (state.queue[i].saver == &saver) return true;
+    }
+    return false;
+}
+
+static void runSaveWorker(SaveWorkerState& state) {
+    Trace::setThreadName("save writer");
+    SaveJob current;
+    std::unique_lock<std::mutex> guard(state.lock);
+    while (true) {
+        state.wake.wait(guard, [&] { return !state.queue.empty() || state.stopping; });
+        if (state.queue.empty()) break; // Stopping with nothing left to write
+
+        std::swap(current, state.queue.front());
+        state.queue.pop_front();
+        state.writing = current.saver;
+
+        guard.unlock();
+        current.saver->writeSnapshot(current.snapshot);
+        guard.lock();
+
+        state.writing = nullptr;
+        state.idle.notify_all();
+    }
+}
+
+SaveWorker::SaveWorker() {
+    state = new SaveWorkerState();
+    state->writing = nullptr;
+    state->stopping = false;
+    state->writer = std::thread(runSaveWorker, std::ref(*state));
+}
+
+// Destructor writes every save still queued
+SaveWorker::~SaveWorker() {
+    {
+        std::lock_guard<std::mutex> guard(state->lock);
+        state->stopping = true;
+    }
+    state->wake.notify_one();
+    state->writer.join();
+    delete state;
+}
+
+// Hand over a snapshot by swapping it in, so the caller never waits on I/O
+void SaveWorker::submit(const GameSaver& saver, GameSnapshot& snapshot) {
+    {
+        std::lock_guard<std::mutex> guard(state->lock);
+        bool queued = false;
+        for (size_t i = 0; i < state->queue.size() && !queued; i++) {
+            if (state->queue[i].saver == &saver) {
+                std::swap(state->queue[i].snapshot, snapshot);
+                queued = true;
+            }
+        }
+        if (!queued) {
+            state->queue.push_back(SaveJob());
+            state->queue.back().saver = &saver;
+            std::swap(state->queue.back().snapshot, snapshot);
+        }
+    }
+    state->wake.notify_one();
+}
+
+// Block until every save the saver requested is on disk
+void SaveWorker::waitIdle(const GameSaver& saver) {
+    std::unique_lock<std::mutex> guard(state->lock);
+    state->idle.wait(guard, [&] { return !isSaving(*state, saver); });
+}
+
+// ================== Game Saver ==================
+
+GameSaver::GameSaver(const std::string& gameFile, const std::string& scoreFile)
+    : gameStatePath(gameFile), scoreLogPath(scoreFile) {
+    worker = nullptr; // A game that never saves never starts a writer thread
+    ownsWorker = false;
+}
+
+// Destructor lets the worker finish any save of this game still queued
+GameSaver::~GameSaver() {
+    if (ownsWorker) {
+        delete worker;
+    } else if (worker) {
+        worker->waitIdle(*this);
+    }
+    worker = nullptr;
+}
+
+// Write through a worker shared with other savers instead of starting one
+void GameSaver::setWorker(SaveWorker* shared) {
+    waitForSaves();
+    if (ownsWorker) delete worker;
+    worker = shared;
+    ownsWorker = false;
+}
+
+// Capture a snapshot of all game state and write it to a single file in the background
+bool GameSaver::saveGame(const Population& pop, const Army& army, const Economy& eco,
                        const ResourceManager& res, const Bank& bank) const {
-    std::ofstream out(gameStatePath);
-    if (!out) {
-        std::cerr << "Error: Could not open " << gameStatePath << " for saving game state.\n";
+    ScopedLatency timing(PHASE_SAVE_CAPTURE);
+    ScopedTrace span("save.capture");
+    Metrics::count(METRIC_SAVES);
+
+    // Capturing is a handful of field copies; the write happens on the worker
+    GameSnapshot snapshot;
+    pop.exportState(snapshot.kingdom);
+    army.exportState(snapshot.kingdom);
+    eco.exportState(snapshot.kingdom);
+    res.exportState(snapshot.kingdom);
+    bank.exportState(snapshot.kingdom, snapshot.loans);
+
+    if (!worker) {
+        worker = new SaveWorker();
+        ownsWorker = true;
+    }
+    worker->submit(*this, snapshot);
+    console() << "Saving game to " << gameStatePath << " in the background...\n";
+    return true;
+}
+
+// Block until every requested save is on disk
+void GameSaver::waitForSaves() const {
+    if (worker) worker->waitIdle(*this);
+}
+
+// Write a snapshot to disk: temporary file, fsync, atomic rename
+bool GameSaver::writeSnapshot(const GameSnapshot& snapshot) const {
+    ScopedLatency timing(PHASE_SAVE_WRITE);
+    ScopedTrace span("save.write");
+
+    // Write a header with timestamp, then the player's kingdom as a one-kingdom scenario
+    std::string text = "# Stronghold Game Save - " + getTimestamp() + "\n";
+    appendKingdomText(text, 0, snapshot.kingdom, snapshot.loans.data(), (int)snapshot.loans.size());
+
+    // A crash mid-write only ever leaves a stray temporary file behind
+    std::string tempPath = gameStatePath + ".tmp";
+    FILE* file = fopen(tempPath.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Error: Could not open " << tempPath << " for saving game state.\n";
+        logEvent("GAME_SAVE_FAILED", "Could not open " + tempPath);
+        return false;
+    }
+
+    bool written = fwrite(text.data(), 1, text.size(), file) == text.size() && fflush(file) == 0;
+#ifdef _WIN32
+    written = written && _commit(_fileno(file)) == 0;
+#else
+    written = written && fsync(fileno(file)) == 0;
+#endif
+    written = fclose(file) == 0 && written;
+
+    if (!written) {
+        std::cerr << "Error: Could not write " << tempPath << ".\n";
+        logEvent("GAME_SAVE_FAILED", "Could not write " + tempPath);
+        remove(tempPath.c_str());
+        return false;
+    }
+
+#ifdef _WIN32
+    bool renamed = MoveFileExA(tempPath.c_str(), gameStatePath.c_str(),
+                               MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    bool renamed = rename(tempPath.c_str(), gameStatePath.c_str()) == 0;
+    if (renamed) {
+        // Persist the rename itself
+        size_t slash = gameStatePath.find_last_of('/');
+        std::string directory = slash == std::string::npos ? "." : gameStatePath.substr(0, slash + 1);
+        int dirFd = open(directory.c_str(), O_RDONLY);
+        if (dirFd >= 0) {
+            fsync(dirFd);
+            close(dirFd);
+        }
+    }
+#endif
+
+    if (!renamed) {
+        std::cerr << "Error: Could not replace " << gameStatePath << ".\n";
+        logEvent("GAME_SAVE_FAILED", "Could not rename " + tempPath + " to " + gameStatePath);
         return false;
     }
-    
-    // Write a header with timestamp
-    out << "# Stronghold Game Save - " << getTimestamp() << std::endl;
-    
-    // Write Population data with section header
-    out << "[POPULATION]" << std::endl;
-    out << pop.getTotal() << std::endl;
-    
-    // Write Army data with section header
-    out << "[ARMY]" << std::endl;
-    
-    // Write Economy data with section header
-    out << "[ECONOMY]" << std::endl;
-    out << eco.getTreasury() << std::endl;
-    
-    // Write Resource data with section header
-    out << "[RESOURCES]" << std::endl;
-    
-    // Write Bank data with section header
-    out << "[BANK]" << std::endl;
-    
-    out.close();
-    
+
     // Log the save event
     logEvent("GAME_SAVE", "Game state saved to " + gameStatePath);
-    
-    std::cout << "Game saved successfully to " << gameStatePath << std::endl;
     return true;
 }
 
 // Load all game state from a single file
-bool GameSaver::loadGame(Population& pop, Army& army, Economy& eco, 
+bool GameSaver::loadGame(Population& pop, Army& army, Economy& eco,
                        ResourceManager& res, Bank& bank) const {
-    std::ifstream in(gameStatePath);
-    if (!in) {
-        std::cerr << "Error: Could not open " << gameStatePath << " for loading game state.\n";
+    // Make sure a save still in flight has landed first
+    waitForSaves();
+    ScopedLatency timing(PHASE_LOAD);
+    ScopedTrace span("save.load");
+
+    GameSnapshot snapshot;
+    KingdomRecord& k = snapshot.kingdom;
+
+    // Start from the current state so fields missing from older saves keep their values
+    pop.exportState(k);
+    army.exportState(k);
+    eco.exportState(k);
+    res.exportState(k);
+    bank.exportState(k, snapshot.loans);
+    for (int i = 0; i < COHORT_SIZE; i++) {
+        k.cohorts[i] = 0.0f; // Re-seeded from the class counts unless the save has them
+    }
+
+    // A save file is a one-kingdom scenario
+    KingdomTable table;
+    table.setDefaults(k);
+    if (!ScenarioLoader(1).load(gameStatePath, table)) {
         return false;
     }
-    
-    std::string line;
-    std::string currentSection = "";
-    
-    // Skip header line
-    std::getline(in, line);
-    
-    while (std::getline(in, line)) {
-        // Check if this is a section header
-        if (line.length() > 2 && line[0] == '[' && line[line.length()-1] == ']') {
-            currentSection = line;
-            continue;
-        }
-        
-        // Process data based on current section
-        if (currentSection == "[POPULATION]") {
-            // Load population data
-            // This is simplified - in reality, we would need to load all population attributes
-            // pop.loadFromFile();
-        }
-        else if (currentSection == "[ARMY]") {
-            // Load army data
-            // army.loadFromFile();
-        }
-        else if (currentSection == "[ECONOMY]") {
-            // Load economy data
-            // eco.loadFromFile();
-        }
-        else if (currentSection == "[RESOURCES]") {
-            // Load resource data
-            // res.loadFromFile();
-        }
-        else if (currentSection == "[BANK]") {
-            // Load bank data
-            // bank.loadFromFile();
-        }
+
+    k = table.get(0);
+    snapshot.loans.clear();
+    for (int i = 0; i < table.getLoanCount(0); i++) {
+        snapshot.loans.push_back(table.getLoan(0, i));
     }
-    
-    in.close();
-    
+
+    pop.importState(k);
+    army.importState(k);
+    eco.importState(k);
+    res.importState(k);
+    bank.importState(k, snapshot.loans);
+
+    Metrics::count(METRIC_LOADS);
+
     // Log the load event
     logEvent("GAME_LOAD", "Game state loaded from " + gameStatePath);
-    
-    std::cout << "Game loaded successfully from " << gameStatePath << std::endl;
+
+    console() << "Game loaded successfully from " << gameStatePath << "\n";
     return true;
 }
 
 // Log resource changes with timestamp
-void GameSaver::logResourceChange(const std::string& resourceType, int oldValue, int newValue, 
+void GameSaver::logResourceChange(const std::string& resourceType, int oldValue, int newValue,
                                 const std::string& action) const {
-    std::ofstream log(scoreLogPath, std::ios::app); // Open in append mode
-    if (!log) {
-        std::cerr << "Error: Could not open " << scoreLogPath << " for logging.\n";
-        return;
+    ScopedLatency timing(PHASE_LOG);
+    Metrics::count(METRIC_LOG_LINES);
+    std::lock_guard<std::mutex> guard(logMutex);
+    std::ofstream out(scoreLogPath, std::ios::app);
+    if (out) {
+        out << getTimestamp() << " [RESOURCE] " << resourceType << ": " << action << " from " << oldValue << " to " << newValue << std::endl;
+        out.close();
     }
-    
-    int change = newValue - oldValue;
-    std::string changeStr = (change >= 0) ? "+" + std::to_string(change) : std::to_string(change);
-    
-    log << getTimestamp() << " | RESOURCE | " << resourceType << " | " 
-        << oldValue << " -> " << newValue << " (" << changeStr << ") | " 
-        << action << std::endl;
-    
-    log.close();
 }
 
 // Log score and event with timestamp
 void GameSaver::logEvent(const std::string& eventType, const std::string& description) const {
-    std::ofstream log(scoreLogPath, std::ios::app); // Open in append mode
-    if (!log) {
-        std::cerr << "Error: Could not open " << scoreLogPath << " for logging.\n";
-        return;
+    ScopedLatency timing(PHASE_LOG);
+    Metrics::count(METRIC_LOG_LINES);
+    std::lock_guard<std::mutex> guard(logMutex);
+    std::ofstream out(scoreLogPath, std::ios::app);
+    if (out) {
+        out << getTimestamp() << " [" << eventType << "] " << description << std::endl;
+        out.close();
     }
-    
-    log << getTimestamp() << " | EVENT | " << eventType << " | " << description << std::endl;
-    
-    log.close();
-}
\ No newline at end of file
+}
@@ -1,7 +1,18 @@
+#pragma once
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <ctime>
+#include <vector>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <functional>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
 using namespace std;
 
 // ================== Forward Declarations ==================
@@ -12,6 +23,13 @@ class Bank;
 class ResourceManager;
 class EventManager;
 class Leader;
+class PathfindingService;
+class ReplicationPublisher;
+class LiveStateWriter;
+class RivalKingdoms;
+class GameSaver;
+struct KingdomRecord;
+struct LoanRecord;
 
 // ================== Base Classes ==================
 
@@ -25,6 +43,196 @@ public:
     virtual void display() const;
 };
 
+// ================== Small Vector ==================
+
+// Alignment for arrays the compiler vectorizes over (one AVX register)
+const size_t SIMD_ALIGN = 32;
+// Worker pools up to this size need no heap allocation
+const size_t INLINE_THREADS = 8;
+
+// Growable array that keeps its first N elements inside the object and only
+// goes to the heap past that (N = 0 makes it a plain heap array). Growing
+// relocates trivially copyable elements with one memcpy and moves the rest.
+// Align raises the alignment of the elements, inline or on the heap, so
+// batch arrays can be read with aligned SIMD loads. Debug builds check
+// every index.
+template<typename T, size_t N, size_t Align = alignof(T)>
+class SmallVector {
+    static_assert(Align >= alignof(T) && (Align & (Align - 1)) == 0,
+                  "Align must be a power of two no smaller than alignof(T)");
+private:
+    T* items;
+    size_t count;
+    size_t capacity;
+    alignas(Align) unsigned char inlineStorage[N > 0 ? N * sizeof(T) : 1];
+
+    T* inlineItems() { return reinterpret_cast<T*>(inlineStorage); }
+    bool isInline() const { return items == reinterpret_cast<const T*>(inlineStorage); }
+
+    static T* allocate(size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), align_val_t(Align)));
+    }
+    static void release(T* block) {
+        ::operator delete(block, align_val_t(Align));
+    }
+
+    // Helper to move the elements to `target`, freeing the old heap block
+    void relocate(T* target) {
+        if constexpr (is_trivially_copyable<T>::value) {
+            if (count > 0) memcpy((void*)target, (const void*)items, count * sizeof(T));
+        } else {
+            for (size_t i = 0; i < count; i++) {
+                new (target + i) T(std::move(items[i]));
+                items[i].~T();
+            }
+        }
+        if (!isInline()) release(items);
+        items = target;
+    }
+
+    // Helper to make room for at least `minimum` elements
+    void grow(size_t minimum) {
+        size_t next = capacity * 2 > 4 ? capacity * 2 : 4;
+        if (next < minimum) next = minimum;
+        relocate(allocate(next));
+        capacity = next;
+    }
+
+    void checkIndex(size_t index) const {
+#ifndef NDEBUG
+        if (index >= count) {
+            cerr << "Error: index " << index << " past the end of a SmallVector of " << count << ".\n";
+            abort();
+        }
+#else
+        (void)index;
+#endif
+    }
+
+    // Helper to take over `other`'s elements, leaving it empty
+    void steal(SmallVector& other) {
+        if (!other.isInline()) {
+            items = other.items;
+            count = other.count;
+            capacity = other.capacity;
+            other.items = other.inlineItems();
+            other.capacity = N;
+        } else {
+            items = inlineItems();
+            capacity = N;
+            count = 0;
+            if constexpr (N > 0) { // With N = 0 an inline vector is always empty
+                T* source = other.items;
+                for (size_t i = 0; i < other.count; i++) {
+                    new (items + i) T(std::move(source[i]));
+                    source[i].~T();
+                }
+                count = other.count;
+            }
+        }
+        other.count = 0;
+    }
+
+public:
+    SmallVector() : items(inlineItems()), count(0), capacity(N) {}
+    explicit SmallVector(size_t size) : SmallVector() { resize(size); }
+    SmallVector(size_t size, const T& value) : SmallVector() { resize(size, value); }
+    SmallVector(const SmallVector& other) : SmallVector() {
+        reserve(other.count);
+        for (size_t i = 0; i < other.count; i++) new (items + i) T(other.items[i]);
+        count = other.count;
+    }
+    SmallVector(SmallVector&& other) noexcept : SmallVector() { steal(other); }
+    ~SmallVector() {
+        clear();
+        if (!isInline()) release(items);
+    }
+
+    SmallVector& operator=(const SmallVector& other) {
+        if (this != &other) {
+            clear();
+            reserve(other.count);
+            for (size_t i = 0; i < other.count; i++) new (items + i) T(other.items[i]);
+            count = other.count;
+        }
+        return *this;
+    }
+    SmallVector& operator=(SmallVector&& other) noexcept {
+        if (this != &other) {
+            clear();
+            if (!isInline()) release(items);
+            steal(other);
+        }
+        return *this;
+    }
+
+    T& operator[](size_t index) { checkIndex(index); return items[index]; }
+    const T& operator[](size_t index) const { checkIndex(index); return items[index]; }
+    T& back() { checkIndex(count - 1); return items[count - 1]; }
+
+    T* data() { return items; }
+    const T* data() const { return items; }
+    T* begin() { return items; }
+    T* end() { return items + count; }
+    const T* begin() const { return items; }
+    const T* end() const { return items + count; }
+    size_t size() const { return count; }
+    size_t getCapacity() const { return capacity; }
+    bool empty() const { return count == 0; }
+
+    void reserve(size_t minimum) {
+        if (minimum > capacity) grow(minimum);
+    }
+    void push_back(const T& value) {
+        if (count == capacity) {
+            T copy(value); // `value` may live in the block being relocated
+            grow(count + 1);
+            new (items + count) T(std::move(copy));
+        } else {
+            new (items + count) T(value);
+        }
+        count++;
+    }
+    void push_back(T&& value) {
+        if (count == capacity) {
+            T moved(std::move(value));
+            grow(count + 1);
+            new (items + count) T(std::move(moved));
+        } else {
+            new (items + count) T(std::move(value));
+        }
+        count++;
+    }
+    void pop_back() {
+        checkIndex(count - 1);
+        items[--count].~T();
+    }
+    void resize(size_t size) {
+        reserve(size);
+        for (size_t i = count; i < size; i++) new (items + i) T();
+        for (size_t i = size; i < count; i++) items[i].~T();
+        count = size;
+    }
+    // Like resize, but new trivial elements are left uninitialized for the caller to fill
+    void resizeForOverwrite(size_t size) {
+        static_assert(is_trivially_default_constructible<T>::value, "Elements must need no construction");
+        reserve(size);
+        for (size_t i = size; i < count; i++) items[i].~T();
+        count = size;
+    }
+    void resize(size_t size, const T& value) {
+        T fill(value); // `value` may live in the block being relocated
+        reserve(size);
+        for (size_t i = count; i < size; i++) new (items + i) T(fill);
+        for (size_t i = size; i < count; i++) items[i].~T();
+        count = size;
+    }
+    void clear() {
+        for (size_t i = 0; i < count; i++) items[i].~T();
+        count = 0;
+    }
+};
+
 // ================== Social Structure ==================
 
 class SocialClass {
@@ -37,6 +245,48 @@ public:
     virtual void showStatus() const;
 };
 
+// ================== Cohort Model ==================
+
+// Age buckets: 0-9, 10-19, 20-34, 35-49, 50-64, 65+
+const int COHORT_AGE_BUCKETS = 6;
+// Social classes: Peasants, Merchants, Nobles
+const int COHORT_CLASSES = 3;
+// One kingdom's state vector (age-major: index = age * COHORT_CLASSES + class)
+const int COHORT_SIZE = COHORT_AGE_BUCKETS * COHORT_CLASSES;
+
+// Food ratio and happiness are quantized so that every kingdom in the same
+// condition shares one precomputed projection matrix
+const int COHORT_FOOD_LEVELS = 8;
+const int COHORT_HAPPINESS_LEVELS = 11;
+const int COHORT_CONDITIONS = COHORT_FOOD_LEVELS * COHORT_HAPPINESS_LEVELS;
+
+// Number of kingdoms projected together by the blocked kernel
+const int COHORT_BLOCK = 32;
+
+class CohortModel {
+private:
+    // Leslie-style projection matrices, one per condition, row-major [to][from]
+    SmallVector<float, 0, SIMD_ALIGN> projections;
+
+    // Helper method to fill the matrix for one food/happiness condition
+    void buildProjection(int foodLevel, int happinessLevel, float* matrix) const;
+
+public:
+    CohortModel();
+
+    // Model shared by every Population in the process
+    static const CohortModel& shared();
+
+    // Map a food ratio (available / required) and happiness (0-100) to a condition
+    static int conditionIndex(float foodRatio, float happiness);
+
+    // Advance `count` contiguous state vectors that share one condition (in-place allowed)
+    void projectBlock(int condition, const float* in, float* out, int count) const;
+
+    // Advance a batch of kingdoms with mixed conditions, in place
+    void projectBatch(const int* conditions, float* states, int count) const;
+};
+
 // ================== Population ==================
 
 class Population {
@@ -44,6 +294,11 @@ private:
     int total;
     int peasants, merchants, nobles,foodStock;
     float happiness;
+    float cohorts[COHORT_SIZE]; // Age bucket x social class head counts
+
+    // Helper methods to keep the cohorts and the class counters in sync
+    void seedCohorts();
+    void recountFromCohorts();
 public:
     Population();
     void simulate();
@@ -52,6 +307,61 @@ public:
     void loadFromFile();
     int getTotal() const;
     void decrease(int amount);
+    
+    // Snapshot support
+    void exportState(KingdomRecord& record) const;
+    void importState(const KingdomRecord& record);
+};
+
+// ================== Battle Engine ==================
+
+// Unit types: Infantry, Cavalry, Archers, Siege, Special
+const int UNIT_TYPES = 5;
+
+// One army as seen by the battle engine (head counts per unit type)
+struct BattleSide {
+    float units[UNIT_TYPES];
+    float morale;      // 0-100 scale
+    float foodSupply;  // Units of food carried into battle
+};
+
+// Many independent battles stored structure-of-arrays so the attrition
+// loop runs across battles with no branches
+class BattleBatch {
+private:
+    SmallVector<float, 0, SIMD_ALIGN> storage; // Single allocation backing every array below
+    int capacity;      // Battles per array, padded so every array starts SIMD aligned
+
+    BattleBatch(const BattleBatch&) = delete;
+    BattleBatch& operator=(const BattleBatch&) = delete;
+public:
+    int count;
+    float* attackerUnits[UNIT_TYPES];
+    float* defenderUnits[UNIT_TYPES];
+    float* attackerStrength[UNIT_TYPES];
+    float* defenderStrength[UNIT_TYPES];
+    float* attackerMorale;
+    float* defenderMorale;
+    float* attackerSupply;
+    float* defenderSupply;
+    float* rounds;     // Rounds each battle stayed active
+
+    BattleBatch(int battles);
+
+    // Fill / read one side of a battle (strength may be nullptr for 1.0 everywhere)
+    void setAttacker(int battle, const BattleSide& side, const float* strength);
+    void setDefender(int battle, const BattleSide& side, const float* strength);
+    BattleSide getAttacker(int battle) const;
+    BattleSide getDefender(int battle) const;
+
+    // True if the attacker holds the field after resolution
+    bool attackerWon(int battle) const;
+};
+
+class BattleEngine {
+public:
+    // Integrate Lanchester square-law attrition for every battle in the batch
+    static void resolveBatch(BattleBatch& batch);
 };
 
 // ================== Army ==================
@@ -61,23 +371,127 @@ private:
     int soldiers;
     int morale;
     int foodSupply;
+    float unitMix[UNIT_TYPES]; // Share of soldiers in each unit type
+    float unitStrength[UNIT_TYPES]; // Training of each unit type, multiplies its firepower
+    
+    // Location on the world map and current march order
+    int posX, posY;
+    int marchX, marchY;
+    bool marching;
     
     // Helper method to track resource changes
     void trackResourceChange(int& resource, int change, const  string& resourceType, const  string& action);
 public:
     Army();
-    void recruitAndTrain(Population& pop);
+    void recruitAndTrain(Population& pop);     // Asks the player how many
+    bool recruit(Population& pop, int count);
     void showStats() const;
     void saveToFile() const;
     void loadFromFile();
     void lowerMorale(int amount);
     
+    // Battle engine integration
+    BattleSide toBattleSide() const;
+    void applyBattleResult(const BattleSide& survivors);
+    const float* getUnitStrength() const { return unitStrength; } // For BattleBatch::setAttacker/setDefender
+    void setUnitStrength(int unitType, float strength);
+    
+    // Movement on the world map
+    void setPosition(int x, int y);
+    void marchTo(int x, int y);
+    int advanceMarch(PathfindingService& paths, int maxSteps); // Returns steps taken
+    bool isMarching() const { return marching; }
+    int getPositionX() const { return posX; }
+    int getPositionY() const { return posY; }
+    
+    // Snapshot support
+    void exportState(KingdomRecord& record) const;
+    void importState(const KingdomRecord& record);
+    void exportMarch(int& targetX, int& targetY, bool& active) const;
+    void importMarch(int targetX, int targetY, bool active);
+    
     // Getters for GameSaver
     int getSoldiers() const { return soldiers; }
     int getMorale() const { return morale; }
     int getFoodSupply() const { return foodSupply; }
 };
 
+// ================== Anomaly Detection ==================
+
+// Streaming P-square estimator for one quantile (five markers, O(1) per sample)
+struct QuantileSketch {
+    float quantile;
+    float heights[5];
+    float positions[5];
+    float desired[5];
+    int samples;
+
+    void reset(float q);
+    void add(float value);
+    float estimate() const;
+};
+
+// O(1)-per-update statistics over one stream of values
+struct StreamStats {
+    float mean;          // EWMA mean
+    float variance;      // EWMA variance
+    float cusumLow;      // Lower CUSUM of standardized values (sustained drops)
+    int samples;
+    QuantileSketch low;  // Robust 5th percentile
+
+    void reset();
+    // Standard deviation, floored for streams that have not varied yet
+    float deviation() const;
+    // Standard score of a value against the stats so far
+    float zScore(float value) const;
+    // Fold a value into the stats (outliers are clipped once warmed up)
+    void update(float value);
+};
+
+// Kinds of alert the monitor can raise (bit flags)
+const int ALERT_SUDDEN_DROP = 1;    // One drop far outside normal behaviour
+const int ALERT_SUSTAINED_DRAIN = 2; // Treasury drifting down for several transactions
+const int ALERT_UNUSUAL_SPENDING = 4;
+
+// Per-kingdom streaming detector over treasury and spending deltas
+class TreasuryMonitor {
+public:
+    struct KingdomStats {
+        int lastTreasury;
+        bool seen;
+        StreamStats treasuryDeltas;
+        StreamStats spending;
+        int pendingAlerts;      // Raised since the last audit
+        int worstDrop;          // Largest flagged drop since the last audit
+    };
+
+private:
+    SmallVector<KingdomStats, 1> kingdoms; // A game's own monitor watches one kingdom, inline
+    int kingdomCount;
+
+    TreasuryMonitor(const TreasuryMonitor&) = delete;
+    TreasuryMonitor& operator=(const TreasuryMonitor&) = delete;
+
+public:
+    TreasuryMonitor(int kingdoms = 1);
+
+    // Record a treasury change; `spent` is the gold spent by it (0 for income)
+    void observe(int kingdom, int treasury, int spent);
+
+    // Observe the treasury of many kingdoms at once (no spending detail)
+    void observeBatch(const int* treasuries, int count);
+
+    // Alerts raised since the last call, cleared on read
+    int takeAlerts(int kingdom, int& worstDrop);
+    
+    // Treat the given treasury as the new starting point (after loading a save)
+    void resetBaseline(int kingdom, int treasury);
+
+    // Everything the monitor has learned about one kingdom (for replay keyframes)
+    const KingdomStats& getStats(int kingdom) const;
+    void setStats(int kingdom, const KingdomStats& stats);
+};
+
 // ================== Economy ==================
 
 class Economy {
@@ -85,6 +499,11 @@ private:
     int treasury;
     float taxRate;
     float inflation;
+    
+    // Optional detector told about every transaction
+    TreasuryMonitor* monitor;
+    int monitorKingdom;
+    void recordTransaction(int spent);
 public:
     Economy();
     void taxPopulation(const Population& pop);
@@ -94,19 +513,127 @@ public:
     void loadFromFile();
     int getTreasury() const;
     void receiveLoan(int amount);
+    void settleTrade(int gold); // Gold received (+) or paid (-) on the market
+    void attachMonitor(TreasuryMonitor* detector, int kingdom = 0);
+    
+    // Snapshot support
+    void exportState(KingdomRecord& record) const;
+    void importState(const KingdomRecord& record);
+};
+
+// ================== Loan Ledger ==================
+
+// Interest tiers: tier t charges (t + 1)% per turn unless changed
+const int LOAN_RATE_TIERS = 8;
+// Loans can run for at most this many turns (size of the due-turn wheel)
+const int LOAN_MAX_TERM = 1024;
+// A tier index past this is folded into its loans and restarted at 1.0
+const double LOAN_INDEX_REBASE = 1e9;
+
+// Pooled table of individual loans. Interest accrues lazily: each tier keeps
+// a cumulative index, a loan stores its principal divided by the index at
+// issue time, and its balance is that times the current index. Advancing a
+// turn only updates the tier indexes; balances are computed when asked. An
+// index that grows past LOAN_INDEX_REBASE is rebased so it never overflows.
+class LoanLedger {
+private:
+    // Loan table (structure-of-arrays), freed slots are reused
+    SmallVector<int, 0> borrower;
+    SmallVector<double, 0> normalizedBalance;   // Balance / tier index
+    SmallVector<unsigned char, 0> rateTier;
+    SmallVector<int, 0> dueTurn;
+    SmallVector<int, 0> dueNext;                // Due-turn wheel links (also free-list link)
+    SmallVector<int, 0> duePrev;
+    SmallVector<bool, 0> active;
+    int capacity;
+    int used;                    // Slots handed out so far
+    int freeHead;                // First reusable slot, -1 if none
+    int activeCount;
+
+    // Per-tier interest state
+    double tierIndex[LOAN_RATE_TIERS];
+    double tierRate[LOAN_RATE_TIERS];
+    double tierNormalizedTotal[LOAN_RATE_TIERS];
+
+    // Due-turn wheel: one list of loans per turn modulo LOAN_MAX_TERM
+    int dueHead[LOAN_MAX_TERM];
+    int currentTurn;
+
+    // Helper methods
+    void grow(int newCapacity);
+    void linkDue(int loan);
+    void unlinkDue(int loan);
+    void release(int loan);
+    void rebaseTier(int tier);
+
+    LoanLedger(const LoanLedger&) = delete;
+    LoanLedger& operator=(const LoanLedger&) = delete;
+
+public:
+    LoanLedger(int initialCapacity = 64);
+
+    // Record a new loan; returns its id
+    int issue(int borrowerId, double amount, int tier, int termTurns);
+
+    // Current balance including accrued interest
+    double balance(int loanId) const;
+
+    // Pay down a loan; returns the amount actually applied
+    double repay(int loanId, double amount);
+
+    // Change a tier's rate from this turn on (earlier interest is kept)
+    void setTierRate(int tier, double ratePerTurn);
+
+    // Move to the next turn (O(tiers), no loan is touched)
+    void advanceTurn();
+
+    // Close a loan without payment (default)
+    void writeOff(int loanId);
+
+    // Drop every loan and restart at turn 0
+    void clear();
+
+    // Loans that mature on the given turn (this turn by default); returns how many were written
+    int collectDue(int* loanIds, int maxLoans) const;
+    int collectDueAt(int turn, int* loanIds, int maxLoans) const;
+
+    bool isActive(int loanId) const;
+    int getBorrower(int loanId) const { return borrower[loanId]; }
+    int getDueTurn(int loanId) const { return dueTurn[loanId]; }
+    int getRateTier(int loanId) const { return rateTier[loanId]; }
+    int getActiveCount() const { return activeCount; }
+    int getCurrentTurn() const { return currentTurn; }
+    double totalOutstanding() const;
 };
 
 // ================== Bank ==================
 
 class Bank {
     private:
-        int loansIssued;
+        int loansIssued;   // Total principal ever lent
         int fraudDetected;
+        int defaults;      // Loans that matured unpaid
+        int anomalies;     // Suspicious treasury movements flagged by the monitor
+        LoanLedger ledger;
+        TreasuryMonitor monitor;
+        
+        // Helper method to pick an interest tier for new loans
+        int currentRateTier() const;
     public:
         Bank();
+        void watch(Economy& economy); // Feed every transaction to the treasury monitor
         void auditTreasury(Economy& economy);
-        void issueLoan(Economy& economy, int amount);
+        void issueLoan(Economy& economy, int amount, int termTurns = 10);
         void repayLoan(Economy& economy, int amount);
+        void visit(Economy& economy);  // Asks the player to take out or repay a loan
+        void processTurn(Economy& economy); // Accrue interest and collect maturing loans
+        int getOutstandingDebt() const;
+        
+        // Snapshot support
+        void exportState(KingdomRecord& record, vector<LoanRecord>& loans) const;
+        void importState(const KingdomRecord& record, const vector<LoanRecord>& loans);
+        void exportMonitor(TreasuryMonitor::KingdomStats& stats) const;
+        void importMonitor(const TreasuryMonitor::KingdomStats& stats);
         void showStats() const;
         void saveToFile() const;
         void loadFromFile();
@@ -134,6 +661,11 @@ class ResourceManager {
         void saveToFile() const;
         void loadFromFile();
         void consumeFixed(string resourceType, int amount);
+        void applyTrade(int resourceType, int amount); // 0-3: food, wood, stone, iron
+        
+        // Snapshot support
+        void exportState(KingdomRecord& record) const;
+        void importState(const KingdomRecord& record);
         
         // Getters for GameSaver
         int getFood() const { return food; }
@@ -178,106 +710,194 @@ class Leader {
         void imposePolicy_Tyrant(Economy& economy, Army& army);
     };
     
+// ================== Kingdom Record ==================
+
+// Flat copy of one kingdom's state, cheap to capture and hand to other threads
+struct KingdomRecord {
+    // Population
+    int total, peasants, merchants, nobles, foodStock;
+    float happiness;
+    float cohorts[COHORT_SIZE];
+    // Army
+    int soldiers, morale, armyFood;
+    float unitMix[UNIT_TYPES];
+    float unitStrength[UNIT_TYPES];
+    int armyX, armyY;
+    // Economy
+    int treasury;
+    float taxRate, inflation;
+    // Resources
+    int food, wood, stone, iron;
+    // Bank
+    int loansIssued, fraudDetected, defaults, anomalies;
+    int outstandingDebt;
+};
+
+// One outstanding loan as saved to disk
+struct LoanRecord {
+    double balance;
+    int rateTier;
+    int turnsLeft;
+};
+
+// Everything a save file holds for the player's kingdom
+struct GameSnapshot {
+    KingdomRecord kingdom;
+    vector<LoanRecord> loans;
+};
+
 // ================== Game Saver ==================
 
+struct SaveWorkerState; // Writer thread and queue, defined in GameSaver.cpp
+
+// Background thread that writes snapshots to disk for any number of
+// GameSavers. Each saver has at most one snapshot queued; a newer request
+// replaces one that has not started writing yet.
+class SaveWorker {
+private:
+    SaveWorkerState* state;
+
+    SaveWorker(const SaveWorker&) = delete;
+    SaveWorker& operator=(const SaveWorker&) = delete;
+
+public:
+    SaveWorker();
+    ~SaveWorker(); // Writes every save still queued
+
+    void submit(const GameSaver& saver, GameSnapshot& snapshot); // Takes the snapshot's contents
+    void waitIdle(const GameSaver& saver);
+};
+
 class GameSaver {
 private:
      string gameStatePath;
      string scoreLogPath;
+     mutable SaveWorker* worker; // Shared, or started by the first save
+     mutable bool ownsWorker;
     
     // Helper method to get current timestamp
      string getTimestamp() const {
         time_t now = time(0);
         char buffer[80];
         struct tm timeinfo;
+#ifdef _WIN32
         localtime_s(&timeinfo, &now);
+#else
+        localtime_r(&now, &timeinfo);
+#endif
         strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &timeinfo);
         return  string(buffer);
     }
     
+    GameSaver(const GameSaver&) = delete;
+    GameSaver& operator=(const GameSaver&) = delete;
+    
 public:
-    GameSaver(const  string& gameFile = "game_save.txt", const  string& scoreFile = "score.txt")
-        : gameStatePath(gameFile), scoreLogPath(scoreFile) {}
+    GameSaver(const  string& gameFile = "game_save.txt", const  string& scoreFile = "score.txt");
+    ~GameSaver(); // Finishes any save still being written
     
-    // Save all game state to a single file
+    // Write through a worker shared with other savers; it must outlive this saver
+    void setWorker(SaveWorker* shared);
+    
+    // Capture a snapshot of all game state and write it to a single file in the background
     bool saveGame(const Population& pop, const Army& army, const Economy& eco, 
-                 const ResourceManager& res, const Bank& bank) const {
-        ofstream out(gameStatePath);
-        if (!out) {
-             cerr << "Error: Could not open " << gameStatePath << " for saving game state.\n";
-            return false;
-        }
-        out << "# Stronghold Game Save - " << getTimestamp() <<  endl;
-        out << "[POPULATION]" <<  endl;
-        out << pop.getTotal() <<  endl;
-        out << "[ARMY]" <<  endl;
-        out << "[ECONOMY]" <<  endl;
-        out << eco.getTreasury() <<  endl;
-        out << "[RESOURCES]" <<  endl;
-        out << "[BANK]" <<  endl;
-        out.close();
-        logEvent("GAME_SAVE", "Game state saved to " + gameStatePath);
-         cout << "Game saved successfully to " << gameStatePath <<  endl;
-        return true;
-    }
+                 const ResourceManager& res, const Bank& bank) const;
+    
+    // Block until every requested save is on disk
+    void waitForSaves() const;
     
     // Load all game state from a single file
     bool loadGame(Population& pop, Army& army, Economy& eco, 
-                 ResourceManager& res, Bank& bank) const {
-         ifstream in(gameStatePath);
-        if (!in) {
-             cerr << "Error: Could not open " << gameStatePath << " for loading game state.\n";
-            return false;
-        }
-         string line;
-         string currentSection = "";
-         getline(in, line);
-        while ( getline(in, line)) {
-            if (line.length() > 2 && line[0] == '[' && line[line.length()-1] == ']') {
-                currentSection = line;
-                continue;
-            }
-            if (currentSection == "[POPULATION]") {
-                // pop.loadFromFile();
-            }
-            else if (currentSection == "[ARMY]") {
-                // army.loadFromFile();
-            }
-            else if (currentSection == "[ECONOMY]") {
-                // eco.loadFromFile();
-            }
-            else if (currentSection == "[RESOURCES]") {
-                // res.loadFromFile();
-            }
-            else if (currentSection == "[BANK]") {
-                // bank.loadFromFile();
-            }
-        }
-        in.close();
-        logEvent("GAME_LOAD", "Game state loaded from " + gameStatePath);
-         cout << "Game loaded successfully from " << gameStatePath <<  endl;
-        return true;
-    }
+                 ResourceManager& res, Bank& bank) const;
+    
+    // Write a snapshot to disk: temporary file, fsync, atomic rename
+    bool writeSnapshot(const GameSnapshot& snapshot) const;
     
     // Log resource changes with timestamp
     void logResourceChange(const  string& resourceType, int oldValue, int newValue, 
-                          const  string& action) const {
-         ofstream out(scoreLogPath,  ios::app);
-        if (out) {
-            out << getTimestamp() << " [RESOURCE] " << resourceType << ": " << action << " from " << oldValue << " to " << newValue <<  endl;
-            out.close();
-        }
-    }
+                          const  string& action) const;
     // Log score and event with timestamp
-    void logEvent(const  string& eventType, const  string& description) const {
-         ofstream out(scoreLogPath,  ios::app);
-        if (out) {
-            out << getTimestamp() << " [" << eventType << "] " << description <<  endl;
-            out.close();
-        }
+    void logEvent(const  string& eventType, const  string& description) const;
+};
+
+// ================== Turn Arena ==================
+
+const size_t TURN_ARENA_INITIAL_BYTES = 16 * 1024;
+
+// Monotonic memory for what lives no longer than a turn: AI reports and
+// scratch arrays. Each thread has its own, so nothing here takes a lock, and
+// it is released wholesale at the end of the turn (a worker's when it runs
+// out of work). A turn that outgrows the arena spills to the heap, and the
+// arena grows to fit at the next reset.
+class TurnArena {
+private:
+    // Heap memory past the arena's own buffer, counted so reset() can grow it
+    class Overflow : public pmr::memory_resource {
+    public:
+        size_t bytes = 0;
+    protected:
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const pmr::memory_resource& other) const noexcept override;
+    };
+
+    SmallVector<char, 0, alignof(max_align_t)> buffer;
+    size_t capacity;
+    Overflow overflow;
+    pmr::monotonic_buffer_resource* arena;
+
+    TurnArena(const TurnArena&) = delete;
+    TurnArena& operator=(const TurnArena&) = delete;
+
+public:
+    TurnArena(size_t capacity = TURN_ARENA_INITIAL_BYTES);
+    ~TurnArena();
+
+    // The calling thread's arena
+    static TurnArena& local();
+
+    pmr::memory_resource* resource();
+
+    // Uninitialized scratch space, never freed individually
+    template<typename T>
+    T* allocate(size_t count) {
+        static_assert(is_trivially_destructible<T>::value, "Arena memory is never destroyed");
+        return (T*)arena->allocate(count * sizeof(T), alignof(T));
     }
+
+    // Everything allocated since the last reset is gone
+    void reset();
+    size_t getCapacity() const;
 };
 
+// Text built during a turn, in the calling thread's arena
+typedef pmr::string TurnString;
+
+inline TurnString turnString(const char* text = "") {
+    return TurnString(text, TurnArena::local().resource());
+}
+
+// Helpers for appendText; numbers read as to_string would print them
+inline void appendPart(TurnString& out, const char* text) {
+    out += text;
+}
+
+inline void appendPart(TurnString& out, int value) {
+    char digits[16];
+    out.append(digits, (size_t)snprintf(digits, sizeof(digits), "%d", value));
+}
+
+inline void appendPart(TurnString& out, float value) {
+    char digits[64];
+    out.append(digits, (size_t)snprintf(digits, sizeof(digits), "%f", value));
+}
+
+// Append every part in turn, without the temporaries `a + to_string(b)` makes
+template<typename... Parts>
+void appendText(TurnString& out, const Parts&... parts) {
+    (appendPart(out, parts), ...);
+}
+
 // ================== AI Controller ==================
 
 class AIController {
@@ -286,16 +906,15 @@ private:
     int lastTaxCollection;  // Tracks last tax collection amount
     int lastArmySize;       // Tracks previous army size
     int conflictLevel;      // Tracks internal conflict level (0-10)
+    bool autonomous;        // Recruits its own target instead of asking the player
     
-    // Dynamically allocated arrays
-    int* decisionHistory;   // Array to track past decisions
-    int decisionHistorySize;
-    int decisionHistoryCapacity;
+    // Dynamic arrays, inline while they stay small
+    SmallVector<int, 16> decisionHistory;   // Array to track past decisions
     
-    float* unitStrengthFactors; // Array of strength multipliers for different unit types
+    SmallVector<float, 5> unitStrengthFactors; // Array of strength multipliers for different unit types
     int unitTypesCount;
     
-    int* resourceAllocation;    // Array to track resource allocation priorities
+    SmallVector<int, 4> resourceAllocation;    // Array to track resource allocation priorities
     int resourceTypesCount;
     
     // Helper methods for decision making
@@ -305,12 +924,15 @@ private:
     
 public:
     AIController();
-    ~AIController(); // Destructor to clean up dynamically allocated memory
+    void setAutonomous(bool value);
     
     // Main decision methods
-    string makeTaxDecision(Economy& eco, Population& pop);
-    string mobilizeArmy(Army& army, Population& pop, ResourceManager& res);
-    string handleInternalConflict(Population& pop, Army& army, Economy& eco);
+    // Reports live in the calling thread's TurnArena
+    TurnString makeTaxDecision(Economy& eco, Population& pop);
+    TurnString mobilizeArmy(Army& army, Population& pop, ResourceManager& res);
+    TurnString mobilizeArmy(Army& army, Population& pop, ResourceManager& res,
+                            PathfindingService& paths, int rallyX, int rallyY);
+    TurnString handleInternalConflict(Population& pop, Army& army, Economy& eco);
     
     // Methods to work with dynamic arrays
     void addDecision(int decisionCode);
@@ -318,18 +940,209 @@ public:
     void setResourcePriority(int resourceType, int priority);
 };
 
+// ================== Persistent Vector ==================
+
+const int PERSISTENT_CHUNK_BITS = 5;
+const size_t PERSISTENT_CHUNK = (size_t)1 << PERSISTENT_CHUNK_BITS;
+
+// Vector held in a tree of reference-counted 32-element chunks. Copying one
+// is O(1): the copy shares every chunk, and whichever side writes first
+// copies only the chunks on the path to the element it changes. Copies may
+// live on different threads; a single copy is not safe to share unguarded.
 template<typename T>
-class SimpleArray {
+class PersistentVector {
 private:
-    T data[5];
-    int size;
+    struct Node {
+        atomic<int> refs;
+        Node() : refs(1) {}
+    };
+    struct Leaf : Node {
+        T values[PERSISTENT_CHUNK];
+    };
+    struct Branch : Node {
+        Node* children[PERSISTENT_CHUNK];
+        Branch() {
+            for (size_t i = 0; i < PERSISTENT_CHUNK; i++) children[i] = nullptr;
+        }
+    };
+
+    Node* root;
+    size_t count;
+    int shift; // Index bits above the leaves: 0 while the root is a leaf
+
+    static void release(Node* node, int level) {
+        if (!node || node->refs.fetch_sub(1, memory_order_acq_rel) != 1) return;
+        if (level == 0) {
+            delete static_cast<Leaf*>(node);
+            return;
+        }
+        Branch* branch = static_cast<Branch*>(node);
+        for (size_t i = 0; i < PERSISTENT_CHUNK; i++) {
+            release(branch->children[i], level - PERSISTENT_CHUNK_BITS);
+        }
+        delete branch;
+    }
+
+    // Helper to make `slot` a chunk only this vector holds, copying it if shared
+    static Node* own(Node*& slot, int level) {
+        if (!slot) {
+            slot = level == 0 ? (Node*)new Leaf() : (Node*)new Branch();
+            return slot;
+        }
+        if (slot->refs.load(memory_order_acquire) == 1) return slot;
+
+        Node* copy;
+        if (level == 0) {
+            Leaf* leaf = new Leaf();
+            for (size_t i = 0; i < PERSISTENT_CHUNK; i++) {
+                leaf->values[i] = static_cast<Leaf*>(slot)->values[i];
+            }
+            copy = leaf;
+        } else {
+            Branch* branch = new Branch();
+            for (size_t i = 0; i < PERSISTENT_CHUNK; i++) {
+                Node* child = static_cast<Branch*>(slot)->children[i];
+                if (child) child->refs.fetch_add(1, memory_order_relaxed);
+                branch->children[i] = child;
+            }
+            copy = branch;
+        }
+        release(slot, level);
+        slot = copy;
+        return copy;
+    }
+
+    // Helper to reach the chunk holding `index` for writing, growing the
+    // tree when `index` is one past its capacity
+    T* editChunk(size_t index) {
+        if (root && index >> shift >= PERSISTENT_CHUNK) {
+            Branch* top = new Branch();
+            top->children[0] = root;
+            root = top;
+            shift += PERSISTENT_CHUNK_BITS;
+        }
+        Node* node = own(root, shift);
+        for (int level = shift; level > 0; level -= PERSISTENT_CHUNK_BITS) {
+            Node*& child = static_cast<Branch*>(node)->children[(index >> level) & (PERSISTENT_CHUNK - 1)];
+            node = own(child, level - PERSISTENT_CHUNK_BITS);
+        }
+        return static_cast<Leaf*>(node)->values;
+    }
+
+    // Helper for forEachChanged(): walk `node` against the same subtree of the base
+    template<typename Visit>
+    void visitChanged(const Node* node, const Node* base, int level, size_t first, size_t baseCount,
+                      Visit& visit) const {
+        if (!node || node == base || first >= count || first >= baseCount) return;
+        if (level == 0 || !base) {
+            size_t end = first + (PERSISTENT_CHUNK << level);
+            if (end > count) end = count;
+            if (end > baseCount) end = baseCount;
+            for (size_t i = first; i < end; i++) visit(i);
+            return;
+        }
+        for (size_t i = 0; i < PERSISTENT_CHUNK; i++) {
+            visitChanged(static_cast<const Branch*>(node)->children[i], static_cast<const Branch*>(base)->children[i],
+                         level - PERSISTENT_CHUNK_BITS, first + (i << level), baseCount, visit);
+        }
+    }
+
 public:
-    SimpleArray() : size(0) {}
-    void add(const T& value) {
-        if (size < 5) data[size++] = value;
+    PersistentVector() : root(nullptr), count(0), shift(0) {}
+
+    PersistentVector(const PersistentVector& other) : root(other.root), count(other.count), shift(other.shift) {
+        if (root) root->refs.fetch_add(1, memory_order_relaxed);
+    }
+
+    PersistentVector& operator=(const PersistentVector& other) {
+        if (other.root) other.root->refs.fetch_add(1, memory_order_relaxed);
+        release(root, shift);
+        root = other.root;
+        count = other.count;
+        shift = other.shift;
+        return *this;
+    }
+
+    ~PersistentVector() {
+        release(root, shift);
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    const T& operator[](size_t index) const {
+        const Node* node = root;
+        for (int level = shift; level > 0; level -= PERSISTENT_CHUNK_BITS) {
+            node = static_cast<const Branch*>(node)->children[(index >> level) & (PERSISTENT_CHUNK - 1)];
+        }
+        return static_cast<const Leaf*>(node)->values[index & (PERSISTENT_CHUNK - 1)];
+    }
+
+    // Writable element; its chunk is copied first if another vector shares it.
+    // Distinct elements of a vector no one shares may be edited from several threads.
+    T& edit(size_t index) {
+        return editChunk(index)[index & (PERSISTENT_CHUNK - 1)];
+    }
+
+    void set(size_t index, const T& value) {
+        edit(index) = value;
+    }
+
+    void push_back(const T& value) {
+        editChunk(count)[count & (PERSISTENT_CHUNK - 1)] = value;
+        count++;
+    }
+
+    // Shrink, or grow with copies of `value` one chunk at a time
+    void resize(size_t size, const T& value = T()) {
+        if (size <= count) {
+            count = size;
+            return;
+        }
+        while (count < size) {
+            T* chunk = editChunk(count);
+            size_t end = (count | (PERSISTENT_CHUNK - 1)) + 1;
+            if (end > size) end = size;
+            for (; count < end; count++) {
+                chunk[count & (PERSISTENT_CHUNK - 1)] = value;
+            }
+        }
+    }
+
+    // Replace the contents with `size` values copied from `values`
+    void assign(const T* values, size_t size) {
+        clear();
+        while (count < size) {
+            T* chunk = editChunk(count);
+            size_t end = (count | (PERSISTENT_CHUNK - 1)) + 1;
+            if (end > size) end = size;
+            for (; count < end; count++) {
+                chunk[count & (PERSISTENT_CHUNK - 1)] = *values++;
+            }
+        }
+    }
+
+    void clear() {
+        release(root, shift);
+        root = nullptr;
+        count = 0;
+        shift = 0;
+    }
+
+    // Call `visit(index)` for every index that may hold a different value than
+    // in `base`: each index of a chunk the two do not share, then each index
+    // past the end of `base`. Shared chunks are skipped unread, so comparing a
+    // vector with an earlier copy of itself costs what was changed since.
+    template<typename Visit>
+    void forEachChanged(const PersistentVector& base, Visit visit) const {
+        size_t common = count < base.count ? count : base.count;
+        if (shift == base.shift) {
+            visitChanged(root, base.root, shift, 0, common, visit);
+        } else {
+            for (size_t i = 0; i < common; i++) visit(i);
+        }
+        for (size_t i = common; i < count; i++) visit(i);
     }
-    T& operator[](int idx) { return data[idx]; }
-    int getSize() const { return size; }
 };
 
 // ================== History Tracker ==================
@@ -348,19 +1161,14 @@ struct GameStateSnapshot {
     string eventDescription; // Description of major event in this turn
 };
 
+// Copying a tracker is O(1); the copies share every snapshot taken so far
 class HistoryTracker {
 private:
-    GameStateSnapshot* snapshots;  // Dynamic array of game state snapshots
-    int capacity;                  // Current capacity of the snapshots array
-    int size;                      // Current number of snapshots
+    PersistentVector<GameStateSnapshot> snapshots;
     int currentTurn;              // Current game turn
     
-    // Helper method to resize the snapshots array when needed
-    void resizeSnapshotsArray();
-    
 public:
     HistoryTracker();
-    ~HistoryTracker();
     
     // Take a snapshot of the current game state
     void takeSnapshot(const Population& pop, const Economy& eco, 
@@ -375,5 +1183,1195 @@ public:
     
     // Get the current turn
     int getCurrentTurn() const;
+    
+    // Continue numbering from `turn` (when a replay keyframe is restored)
+    void setCurrentTurn(int turn);
+
+    // Go back to the start of `turn`, dropping the snapshots taken since
+    void rewindTo(int turn);
 };
 
+// ================== World Map ==================
+
+struct TilePosition {
+    int x;
+    int y;
+};
+
+// Kingdoms a grid cell holds before its member list goes to the heap
+const int WORLD_CELL_INLINE = 4;
+
+// 2D tile map of kingdom locations backed by a uniform grid index.
+// Each grid cell keeps the ids of the kingdoms standing in it, so moving a
+// kingdom only touches its old and new cell.
+class WorldMap {
+private:
+    int width;              // Map size in tiles
+    int height;
+    int cellSize;           // Grid cell side in tiles
+    int gridWidth;          // Map size in grid cells
+    int gridHeight;
+
+    // Per-kingdom arrays, indexed by kingdom id
+    SmallVector<int, 0> kingdomX;
+    SmallVector<int, 0> kingdomY;
+    SmallVector<int, 0> kingdomCell;       // Grid cell index, -1 once removed
+    SmallVector<int, 0> kingdomSlot;       // Position inside the cell's member list
+    int kingdomCount;       // Ids handed out so far
+    int activeKingdoms;     // Kingdoms currently placed on the map
+
+    // Per-cell member lists; most cells hold a few kingdoms and never allocate
+    SmallVector<SmallVector<int, WORLD_CELL_INLINE>, 0> cellMembers;
+
+    // Helper methods
+    int cellOf(int x, int y) const;
+    void insertIntoCell(int id, int cell);
+    void removeFromCell(int id);
+
+public:
+    WorldMap(int width, int height, int cellSize = 16);
+
+    // Place a kingdom on a tile and return its id
+    int addKingdom(int x, int y);
+
+    // Incremental updates when borders change
+    void moveKingdom(int id, int x, int y);
+    void removeKingdom(int id);
+
+    // Ids of kingdoms within `radius` tiles of (x, y); returns the number found
+    // (at most maxResults are written to results)
+    int queryRadius(int x, int y, int radius, int* results, int maxResults) const;
+
+    // Ids of the k kingdoms closest to (x, y), nearest first; returns the number found
+    int queryNearest(int x, int y, int k, int* results) const;
+
+    TilePosition getPosition(int id) const;
+    bool isPlaced(int id) const;
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getKingdomCount() const { return activeKingdoms; }
+};
+
+// ================== Pathfinding ==================
+
+// Per-destination flow field: every tile stores the direction of its next
+// step towards the destination, so any number of armies heading to the
+// same place share one computation. The single-kingdom game has no world
+// map, so its army never marches; the service is for many-kingdom worlds.
+struct FlowField {
+    int destination;          // Destination tile index (y * width + x)
+    int destinationOwner;     // Owner of the destination tile when built
+    SmallVector<unsigned int, 0> distance;   // Travel cost to the destination, per tile
+    SmallVector<unsigned char, 0> direction; // Index into the 8 neighbour offsets, per tile
+    bool stale;               // Needs a rebuild before the next lookup
+    unsigned int lastUsed;    // For least-recently-used eviction
+};
+
+class PathfindingService {
+private:
+    int width;
+    int height;
+    SmallVector<unsigned char, 0> terrainCost;  // Cost of entering each tile, 0 = impassable
+    SmallVector<int, 0> tileOwner;              // Kingdom owning each tile, -1 = unclaimed
+
+    SmallVector<FlowField, 0> cache;            // cacheCapacity slots, the first cacheSize in use
+    int cacheSize;
+    int cacheCapacity;
+    unsigned int useClock;
+    int fieldsBuilt;             // Total rebuilds, for diagnostics
+
+    // Helper methods
+    unsigned int stepCost(int tile, int direction, int destinationOwner) const;
+    void buildField(FlowField& field);
+    FlowField& fieldFor(int destination);
+    void invalidateAround(int tile, unsigned int oldTerrain, int oldOwner);
+
+public:
+    PathfindingService(const WorldMap& map, int cacheCapacity = 32);
+
+    // Terrain and ownership edits invalidate only the cached fields they affect
+    void setTerrainCost(int x, int y, int cost);
+    void setOwner(int x, int y, int kingdomId);
+
+    // Next tile on the way from (x, y) to the destination; false if unreachable
+    bool nextStep(int x, int y, int destX, int destY, TilePosition& next);
+
+    // Travel cost from (x, y) to the destination (-1 if unreachable)
+    int travelCost(int x, int y, int destX, int destY);
+
+    int getCachedFieldCount() const { return cacheSize; }
+    int getFieldsBuilt() const { return fieldsBuilt; }
+};
+
+// ================== Trade Market ==================
+
+// Traded resources: Food, Wood, Stone, Iron
+const int TRADE_RESOURCES = 4;
+
+// Per-turn market where kingdoms post surplus and deficit orders. Every
+// (region, resource) pair is an independent market cleared by tatonnement
+// (the price moves toward the excess demand until supply meets demand), and
+// markets are cleared in parallel on worker threads. It is meant for
+// many-kingdom worlds; the single-kingdom game does not trade.
+class TradeMarket {
+private:
+    int kingdomCount;
+    int regionCount;
+    int threadCount;
+    SmallVector<int, 0> kingdomRegion;
+
+    // Orders, indexed [resource][kingdom]
+    typedef SmallVector<float, 0, SIMD_ALIGN> KingdomFloats;
+    KingdomFloats offered[TRADE_RESOURCES];     // Units for sale
+    KingdomFloats wanted[TRADE_RESOURCES];      // Units wanted
+    KingdomFloats budget[TRADE_RESOURCES];      // Gold set aside to buy this resource
+    KingdomFloats willingness;                  // Price a buyer tolerates, as a multiple of the base price
+
+    // Results of the last clearing
+    SmallVector<float, 0> prices;               // [region * TRADE_RESOURCES + resource]
+    KingdomFloats filled[TRADE_RESOURCES];      // Units bought (+) or sold (-) per kingdom
+    KingdomFloats goldFlow;                     // Gold received (+) or paid (-) per kingdom
+    SmallVector<int, 0> iterationsUsed;         // Tatonnement rounds per market
+
+    // Kingdoms grouped by region (built at clearing time)
+    SmallVector<int, 0> regionStart;
+    SmallVector<int, 0> regionMembers;
+
+    // Helper method to clear one market
+    void clearMarket(int region, int resource);
+
+public:
+    TradeMarket(int kingdoms, int regions = 1, int threads = 0);
+
+    void setRegion(int kingdom, int region);
+
+    // Post a raw order for one resource
+    void postOrder(int kingdom, int resource, float surplus, float deficit, float goldBudget);
+
+    // Derive a kingdom's orders from its stocks and needs
+    void postOrders(int kingdom, const ResourceManager& res, const Population& pop,
+                    const Army& army, const Economy& eco);
+
+    // Clear every market in parallel
+    void clear();
+
+    // Apply a kingdom's trades to its stockpile and treasury
+    void settle(int kingdom, ResourceManager& res, Economy& eco) const;
+
+    float getPrice(int region, int resource) const;
+    float getFilled(int kingdom, int resource) const;
+    float getGoldFlow(int kingdom) const;
+    int getIterations(int region, int resource) const;
+};
+
+
+// ================== Scenario Loader ==================
+
+// Binary scenario files hold this header, then kingdomCount KingdomRecords
+// (kingdom k at index k), then loanCount ScenarioLoans
+struct ScenarioHeader {
+    char magic[8];              // SCENARIO_MAGIC
+    uint32_t version;
+    uint32_t recordSize;        // sizeof(KingdomRecord) of the writer
+    uint64_t kingdomCount;
+    uint64_t loanCount;
+};
+
+struct ScenarioLoan {
+    int32_t kingdom;
+    int32_t rateTier;
+    int32_t turnsLeft;
+    int32_t reserved;
+    double balance;
+};
+
+const char SCENARIO_MAGIC[8] = { 'S', 'T', 'R', 'H', 'O', 'L', 'D', 'B' };
+const uint32_t SCENARIO_VERSION = 1;
+
+// Fill in a binary scenario header for this build
+void initScenarioHeader(ScenarioHeader& header, uint64_t kingdoms, uint64_t loans);
+
+// Most kingdoms a scenario may hold, so a bad id or count cannot size a huge table
+const int MAX_SCENARIO_KINGDOMS = 1 << 24;
+
+// Check a binary scenario header against this build
+bool isScenarioHeaderValid(const ScenarioHeader& header);
+
+// Append one kingdom in the text scenario (and save file) format
+void appendKingdomText(string& out, int kingdom, const KingdomRecord& record,
+                       const LoanRecord* loans, int loanCount);
+
+// Every kingdom of a scenario. Loans of kingdom k are stored back to back in
+// loans[loanStart[k] .. loanStart[k + 1]). Copying a table is O(1): a copy
+// forks the world and pays only for the chunks of kingdoms it changes.
+class KingdomTable {
+private:
+    int kingdomCount;
+    PersistentVector<KingdomRecord> records;
+    KingdomRecord defaults;     // Values for fields a scenario leaves out
+    PersistentVector<int> loanStart;
+    PersistentVector<LoanRecord> loans;
+
+    friend class ScenarioLoader;
+
+public:
+    KingdomTable();
+
+    // Size the table, filling every kingdom with the defaults and no loans
+    void reset(int kingdoms);
+    void setDefaults(const KingdomRecord& record);
+
+    int getKingdomCount() const;
+    KingdomRecord& get(int kingdom); // Unshares the kingdom's chunk
+    const KingdomRecord& get(int kingdom) const;
+    int getLoanCount(int kingdom) const;
+    const LoanRecord& getLoan(int kingdom, int loan) const;
+    const PersistentVector<KingdomRecord>& getRecords() const;
+};
+
+// Loads text scenarios: `[KINGDOM n]` blocks, each holding the sections of a
+// save file. The file is memory-mapped, split at kingdom boundaries and the
+// pieces are parsed on worker threads straight into a KingdomTable. Binary
+// scenarios (see ScenarioHeader) are recognised and copied directly.
+class ScenarioLoader {
+private:
+    int threadCount;
+
+public:
+    ScenarioLoader(int threads = 0);
+
+    // Load a scenario file; kingdoms missing from it keep the table defaults
+    bool load(const string& path, KingdomTable& table) const;
+
+    // Parse scenario text already in memory; false if a kingdom id is too large
+    // or appears twice
+    bool parse(const char* text, size_t length, KingdomTable& table) const;
+
+    // Copy a binary scenario already in memory; false if the header does not match
+    bool parseBinary(const char* data, size_t length, KingdomTable& table) const;
+};
+
+// ================== Streaming Simulator ==================
+
+// Regions are a REGION_GRID x REGION_GRID grid over army positions
+const int REGION_GRID = 16;
+const int REGION_COUNT = REGION_GRID * REGION_GRID;
+
+// What a region looked like over one turn; the only state that crosses chunks
+struct RegionSummary {
+    long long kingdoms;
+    long long population;
+    long long soldiers;
+    long long treasury;
+    double foodSupply;      // Surplus food offered on the regional market
+    double foodDemand;      // Food shortage kingdoms tried to buy
+    float foodPrice;        // Gold per unit of food on this turn's market
+};
+
+class StreamChunkQueue; // Hand-off between the I/O threads, defined in streamingsim.cpp
+
+// Runs turns over a binary scenario that need not fit in memory. The kingdom
+// records are read a chunk at a time, ticked through the Population, Economy,
+// Army and ResourceManager rules and written back in place; a reader and a
+// writer thread overlap the disk with the compute. Kingdoms only interact
+// through the per-region summaries of the previous turn (a regional food
+// market), so chunks never need each other. Loans in the file are untouched.
+class StreamingSimulator {
+private:
+    string path;
+    int chunkKingdoms;
+    int regionSize;         // Map tiles per region side
+    long long kingdomCount;
+    int turn;
+
+    SmallVector<RegionSummary, 0> previous;    // Last turn, drives this turn's prices
+    SmallVector<RegionSummary, 0> current;     // Being accumulated this turn
+
+    StreamingSimulator(const StreamingSimulator&) = delete;
+    StreamingSimulator& operator=(const StreamingSimulator&) = delete;
+
+    // Helper methods
+    int regionOf(const KingdomRecord& record) const;
+    void tickKingdom(KingdomRecord& record);
+
+public:
+    StreamingSimulator(const string& scenarioPath, int chunkKingdoms = 65536, int regionSize = 64);
+
+    // Check the file header; must succeed before running turns
+    bool open();
+
+    // Stream every kingdom through one turn
+    bool runTurn();
+
+    long long getKingdomCount() const { return kingdomCount; }
+    int getTurn() const { return turn; }
+    const RegionSummary& getRegion(int region) const { return previous[region]; }
+};
+
+// ================== Metrics ==================
+
+// Counters, summed over every thread when exported
+enum MetricCounter {
+    METRIC_TURNS,
+    METRIC_SNAPSHOTS_TAKEN,
+    METRIC_RESOURCE_CHANGES,
+    METRIC_AI_DECISIONS,
+    METRIC_EVENTS_FIRED,
+    METRIC_SAVES,
+    METRIC_LOADS,
+    METRIC_LOG_LINES,
+    METRIC_COUNTER_COUNT
+};
+
+// Gauges hold the last value set, from any thread
+enum MetricGauge {
+    METRIC_TREASURY,
+    METRIC_POPULATION,
+    METRIC_SOLDIERS,
+    METRIC_GAUGE_COUNT
+};
+
+// Latency histograms, one per phase
+enum MetricPhase {
+    PHASE_TURN,
+    PHASE_AI_TAX,
+    PHASE_AI_ARMY,
+    PHASE_AI_CONFLICT,
+    PHASE_BANK,
+    PHASE_SNAPSHOT,
+    PHASE_EVENT,
+    PHASE_SAVE_CAPTURE,
+    PHASE_SAVE_WRITE,
+    PHASE_LOAD,
+    PHASE_LOG,
+    METRIC_PHASE_COUNT
+};
+
+// Log-linear (HDR-style) buckets: exact below 8 ns, then 8 sub-buckets per
+// power of two up to about half an hour, so every bucket is within 12.5%
+const int METRIC_SUB_BUCKETS = 8;
+const int METRIC_BUCKETS = 8 + 38 * METRIC_SUB_BUCKETS;
+
+struct MetricsShard;
+
+// Process-wide metrics. Each thread records into its own shard with plain
+// relaxed stores, so recording never contends; exporting sums the shards.
+// Everything is off until setEnabled(true), and then costs one branch.
+class Metrics {
+public:
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    static void count(MetricCounter counter, uint64_t amount = 1);
+    static void setGauge(MetricGauge gauge, int64_t value);
+    static void recordLatency(MetricPhase phase, uint64_t nanoseconds);
+
+    // Prometheus text exposition format
+    static string renderPrometheus();
+    static bool writePrometheus(const string& path);
+
+    // Serve the text on a local (Unix domain) socket until stopServing()
+    static bool servePrometheus(const string& socketPath);
+    static void stopServing();
+
+    // Helpers for the histogram layout
+    static int bucketFor(uint64_t nanoseconds);
+    static uint64_t bucketLowerBound(int bucket);
+};
+
+// Records the time from construction to destruction into a phase histogram
+class ScopedLatency {
+private:
+    MetricPhase phase;
+    bool active;
+    uint64_t start;
+public:
+    ScopedLatency(MetricPhase phase);
+    ~ScopedLatency();
+};
+
+// ================== Output ==================
+
+// How a thread's console output is rendered
+enum OutputMode {
+    OUTPUT_BUFFERED, // Everything, written out in large blocks
+    OUTPUT_QUIET,    // Nothing; follow the game through metrics instead
+    OUTPUT_DIFF      // Everything except stat fields that did not change
+};
+
+// Bytes held before the buffer is written out
+const int OUTPUT_BUFFER_BYTES = 1 << 16;
+
+struct OutputState;
+
+// Console output for the menu and every subsystem. Each thread has its own
+// sink; text is buffered until the buffer fills, flush() is called, or a
+// stream tied to it (cin, in the game) is about to read.
+// Stat blocks go through section() and field() so diff mode can skip
+// fields whose value is the same as at the last render.
+// A holding sink renders nothing itself: it keeps its text and stat blocks
+// until replayInto() shows them on another sink, in that sink's mode. This
+// lets work on other threads print for the thread that started it.
+class OutputSink {
+private:
+    OutputState* state;
+    OutputMode mode;
+
+    ostream& beginField();
+    void endField(const char* label);
+public:
+    OutputSink(bool holds = false);
+    ~OutputSink();
+
+    // The calling thread's sink, or the one it is redirected to
+    static OutputSink& local();
+
+    // Redirects the calling thread's output (nullptr: back to its own sink).
+    // Returns the sink it went to before.
+    static OutputSink* redirect(OutputSink* sink);
+
+    void setMode(OutputMode mode);
+    OutputMode getMode() const;
+
+    ostream& text();
+    void flush();
+
+    // Shows everything a holding sink kept on `target`, then forgets it
+    void replayInto(OutputSink& target);
+
+    // Starts a stat block; `owner` keeps two kingdoms' blocks apart in diff mode
+    void section(const char* title, const void* owner);
+
+    // One "label: value" line of the current stat block
+    template<typename... Parts>
+    void field(const char* label, const Parts&... parts) {
+        if (mode == OUTPUT_QUIET) return;
+        ostream& value = beginField();
+        (value << ... << parts);
+        endField(label);
+    }
+};
+
+// Shorthand for the calling thread's text stream
+inline ostream& console() {
+    return OutputSink::local().text();
+}
+
+// Silences the calling thread's sink for a scope, e.g. to keep the game
+// rules' console reports out of a bulk run
+class MutedOutput {
+public:
+    MutedOutput() : saved(OutputSink::local().getMode()) { OutputSink::local().setMode(OUTPUT_QUIET); }
+    ~MutedOutput() { OutputSink::local().setMode(saved); }
+private:
+    OutputMode saved;
+};
+
+// Sends the calling thread's output to another sink for a scope
+class RedirectedOutput {
+public:
+    RedirectedOutput(OutputSink& sink) : saved(OutputSink::redirect(&sink)) {}
+    ~RedirectedOutput() { OutputSink::redirect(saved); }
+private:
+    OutputSink* saved;
+};
+
+// ================== Input ==================
+
+// Where the game's questions are answered. Call sites ask the calling
+// thread's provider through InputProvider::local() instead of reading cin.
+class InputProvider {
+public:
+    virtual ~InputProvider() {}
+
+    // Shows `prompt` if a person is answering, then reads one whole number.
+    // False if the answer was not a number or input has run out.
+    virtual bool readInt(const char* prompt, int& value) = 0;
+
+    // True once no more answers will come
+    virtual bool exhausted() const = 0;
+
+    // Whether menus should be printed before asking
+    virtual bool showsPrompts() const = 0;
+
+    // The calling thread's provider (the terminal unless replaced)
+    static InputProvider& local();
+    static void setLocal(InputProvider* provider); // nullptr restores the terminal
+};
+
+// Answers typed at the terminal (or piped into a stream)
+class TerminalInput : public InputProvider {
+private:
+    istream& in;
+public:
+    TerminalInput(istream& in = cin);
+    bool readInt(const char* prompt, int& value) override;
+    bool exhausted() const override;
+    bool showsPrompts() const override;
+};
+
+// Passes another provider's answers through, appending each to a file that
+// ReplayInput can play back. Answers that were not numbers are kept as "x".
+class RecordingInput : public InputProvider {
+private:
+    InputProvider& source;
+    ofstream log;
+public:
+    RecordingInput(InputProvider& source);
+    bool open(const string& path);
+    bool readInt(const char* prompt, int& value) override;
+    bool exhausted() const override;
+    bool showsPrompts() const override;
+};
+
+// One recorded answer
+struct InputAnswer {
+    int value;
+    bool valid;
+};
+
+// Plays back recorded answers from memory without prompting
+class ReplayInput : public InputProvider {
+private:
+    vector<InputAnswer> answers;
+    size_t next;
+public:
+    ReplayInput();
+    bool load(const string& path);
+    void add(int value);
+    void add(const InputAnswer& answer);
+    void rewind();
+    size_t getAnswerCount() const;
+
+    bool readInt(const char* prompt, int& value) override;
+    bool exhausted() const override;
+    bool showsPrompts() const override;
+};
+
+// ================== Tracing ==================
+
+// Spans each thread can hold; later spans are dropped and counted
+const int TRACE_BUFFER_EVENTS = 1 << 16;
+
+struct TraceBuffer;
+
+// Timeline of scoped spans, written as Chrome trace-event JSON for
+// chrome://tracing or Perfetto. Each thread appends to its own buffer and
+// publishes with one release store, so writeChromeTrace() may run at any time.
+class Trace {
+public:
+    static atomic<bool> enabled;
+
+    static void setEnabled(bool on);
+    static bool isEnabled() { return enabled.load(memory_order_relaxed); }
+
+    // Names the calling thread's row in the timeline
+    static void setThreadName(const char* name);
+
+    static void record(const char* name, uint64_t start, uint64_t end);
+    static uint64_t now();
+
+    static bool writeChromeTrace(const string& path);
+};
+
+// Records a span from construction to destruction. `name` must outlive the
+// trace (a string literal). When tracing is off this is one branch on a flag.
+class ScopedTrace {
+private:
+    const char* name;
+    uint64_t start;
+public:
+    ScopedTrace(const char* spanName) : name(nullptr), start(0) {
+        if (Trace::enabled.load(memory_order_relaxed)) {
+            name = spanName;
+            start = Trace::now();
+        }
+    }
+    ~ScopedTrace() {
+        if (name) Trace::record(name, start, Trace::now());
+    }
+};
+
+// ================== Random ==================
+
+// Seed every new game starts from unless told otherwise
+const uint64_t GAME_DEFAULT_SEED = 1;
+
+// SplitMix64 stream for the game rules. Its whole position is one 64-bit
+// state, so a replay log can note it every turn and restore it exactly.
+class GameRandom {
+private:
+    uint64_t state;
+public:
+    GameRandom(uint64_t seed = GAME_DEFAULT_SEED);
+    void seed(uint64_t seed);
+    uint64_t getState() const;
+    void setState(uint64_t state);
+
+    uint64_t next();
+    int nextInt(int bound); // Uniform in [0, bound)
+
+    // The calling thread's stream; game rules draw from it instead of rand()
+    static GameRandom& local();
+};
+
+// ================== Task Graph ==================
+
+// One step of a piece of work, with the state it reads and writes as bit
+// masks. What each bit stands for is up to the graph's owner.
+struct TaskPhase {
+    const char* name;       // Also its trace span
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t after;         // Bit i: runs once phase i has finished
+    uint64_t successors;    // Filled in by TaskGraph::add
+    function<void()> run;
+};
+
+const int TASK_GRAPH_MAX_PHASES = 64;
+
+struct TaskExecutorState; // Worker threads and their job queue, defined in taskgraph.cpp
+
+// Threads that run the phases of task graphs. Several threads may run
+// graphs on the same executor at once.
+class TaskExecutor {
+private:
+    TaskExecutorState* state;
+
+    TaskExecutor(const TaskExecutor&) = delete;
+    TaskExecutor& operator=(const TaskExecutor&) = delete;
+
+    friend class TaskGraph;
+
+public:
+    TaskExecutor(int threads = 0); // 0: one per core, less the caller's
+    ~TaskExecutor();
+    int getThreadCount() const;
+};
+
+// Work declared as phases and the phases each waits for. Phases that do not
+// wait on each other may run at the same time, so they must not touch the
+// same state unless both only read it; debug builds check this before every
+// run. Phases that use state tied to the calling thread (its console, its
+// input, its random stream) name it with setCallerOnly and always run there.
+class TaskGraph {
+private:
+    vector<TaskPhase> phases;
+    uint64_t callerOnly;
+
+    bool validate() const;
+
+public:
+    TaskGraph();
+
+    // Phases can only wait on phases added before them. Returns the new
+    // phase's index for later phases to wait on.
+    int add(const char* name, uint64_t reads, uint64_t writes, uint64_t after, function<void()> run);
+    void setCallerOnly(uint64_t state);
+    size_t size() const;
+
+    // Run every phase, on the executor's threads as well as the caller's, or
+    // in the order added if there is no executor. False if the graph is not
+    // valid (debug builds only), in which case nothing runs.
+    bool run(TaskExecutor* executor);
+};
+
+// ================== Game Session ==================
+
+// Full state of a game at the start of a turn, as a replay log keeps it
+struct GameKeyframe {
+    int turn;
+    uint64_t rngState;
+    KingdomRecord kingdom;
+    vector<LoanRecord> loans;
+    int marchX, marchY;
+    bool marching;
+    TreasuryMonitor::KingdomStats monitor;
+};
+
+// State a turn's phases read and write (see TaskGraph)
+const uint64_t TURN_POPULATION = 1 << 0;
+const uint64_t TURN_ARMY = 1 << 1;
+const uint64_t TURN_ECONOMY = 1 << 2;
+const uint64_t TURN_RESOURCES = 1 << 3;
+const uint64_t TURN_BANK = 1 << 4;      // Includes the treasury monitor every transaction feeds
+const uint64_t TURN_AI = 1 << 5;        // The turn's AIController
+const uint64_t TURN_HISTORY = 1 << 6;   // Also the current turn number
+const uint64_t TURN_TIMELINE = 1 << 7;
+const uint64_t TURN_SPECTATORS = 1 << 8; // Replication and live state
+const uint64_t TURN_METRICS = 1 << 9;   // Gauges and the export; counters go to each thread's shard
+const uint64_t TURN_INPUT = 1 << 11;    // Tied to the calling thread, like the one below
+const uint64_t TURN_RANDOM = 1 << 12;
+const uint64_t TURN_KINGDOM = TURN_POPULATION | TURN_ARMY | TURN_ECONOMY | TURN_RESOURCES;
+
+// One player's game: the kingdom's subsystems and the menu that drives them.
+// A new session reseeds the calling thread's GameRandom.
+class StrongholdGame {
+private:
+    Population population;
+    Army army;
+    Economy economy;
+    ResourceManager resources;
+    Leader* leader;
+    EventManager events;
+    Bank bank;
+    GameSaver saver;
+    HistoryTracker history;
+    PersistentVector<GameKeyframe> timeline; // Start of every turn since the game began or was restored
+    string metricsPath;
+    ReplicationPublisher* publisher;
+    LiveStateWriter* liveState;
+    RivalKingdoms* rivals;  // Started the first time the player looks at them
+    TaskExecutor* turnExecutor;
+    vector<OutputSink*> turnOutput; // Holding sinks for a turn's phases, kept for the next turn
+    int rivalThreads;
+    bool running;
+
+    void advanceTurn();
+    void publishTurn();
+    void showRivals();
+    void applyKeyframe(const GameKeyframe& keyframe);
+
+    StrongholdGame(const StrongholdGame&) = delete;
+    StrongholdGame& operator=(const StrongholdGame&) = delete;
+
+public:
+    StrongholdGame(uint64_t seed = GAME_DEFAULT_SEED, const string& saveFile = "game_save.txt",
+                   const string& scoreFile = "score.txt");
+    ~StrongholdGame();
+
+    // Ask for one menu choice and carry it out; false once the game is over.
+    // Questions asked along the way go to InputProvider::local().
+    bool playChoice(InputProvider& input);
+    void play(InputProvider& input);
+
+    void showOverview() const;
+    void setMetricsPath(const string& path); // Rewritten after every turn
+    void setPublisher(ReplicationPublisher* publisher); // Sent every turn, starting now
+    void setLiveState(LiveStateWriter* liveState);      // Written every turn, starting now
+    void setRivalThreads(int threads);                  // 0 keeps rival kingdoms off
+    void setTurnExecutor(TaskExecutor* executor);       // Without one, a turn's phases run in order
+    void setSaveWorker(SaveWorker* worker);             // Shared writer; without one the first save starts its own
+    int getTurn() const;
+    bool isRunning() const;
+
+    void exportKingdom(KingdomRecord& record) const; // Everything but the bank's loans
+    void captureKeyframe(GameKeyframe& keyframe) const;
+    void restoreKeyframe(const GameKeyframe& keyframe);
+
+    // Go back to the start of an earlier turn (or restart this one); false if
+    // the turn is not on the timeline
+    bool rewind(int turn);
+};
+
+// ================== Replay Log ==================
+
+#define REPLAY_MAGIC "STRHRPLY"
+const uint32_t REPLAY_VERSION = 1;
+const int REPLAY_DEFAULT_KEYFRAME_INTERVAL = 10;
+
+// Passes a provider's answers through to a game and writes a replay log of
+// them: every answer, the random-stream position at the start of each turn,
+// and a full keyframe on the first turn, every `keyframeInterval` after and
+// after every rewind.
+class ReplayRecorder : public InputProvider {
+private:
+    InputProvider& source;
+    const StrongholdGame& game;
+    FILE* file;
+    int keyframeInterval;
+    int firstTurn;
+    int lastTurn;
+
+    void beginTurn();
+
+    ReplayRecorder(const ReplayRecorder&) = delete;
+    ReplayRecorder& operator=(const ReplayRecorder&) = delete;
+
+public:
+    ReplayRecorder(InputProvider& source, const StrongholdGame& game);
+    ~ReplayRecorder();
+    bool open(const string& path, int keyframeInterval = REPLAY_DEFAULT_KEYFRAME_INTERVAL);
+
+    bool readInt(const char* prompt, int& value) override;
+    bool exhausted() const override;
+    bool showsPrompts() const override;
+};
+
+// A recorded campaign read back from a replay log
+class ReplayLog {
+private:
+    struct TurnEntry {
+        int turn;
+        uint64_t rngState;
+        size_t firstAnswer; // Index of the turn's first answer
+    };
+
+    string path;
+    vector<TurnEntry> turns;        // In log order; turns repeat after a rewind
+    vector<InputAnswer> answers;
+    vector<GameKeyframe> keyframes; // In log order
+    vector<size_t> keyframeEntries; // Index in `turns` of each keyframe's turn
+
+    // Helper to replay from keyframe `k` up to the start of turn entry
+    // `endEntry`, checking the recorded random stream; describes any
+    // divergence in `problem`
+    bool replaySegment(StrongholdGame& game, size_t k, size_t endEntry, string& problem) const;
+
+public:
+    bool load(const string& path);
+
+    int getFirstTurn() const;
+    int getLastTurn() const;
+    size_t getKeyframeCount() const;
+
+    // Bring `game` to the start of `turn` (its last visit, if the player
+    // rewound) from the nearest keyframe before it
+    bool seek(StrongholdGame& game, int turn) const;
+
+    // Replay every keyframe-to-keyframe segment on `threads` workers (0 = one
+    // per core), checking each reproduces the recorded random stream and the
+    // next keyframe. Returns the number of segments that diverged.
+    int verify(int threads = 0) const;
+};
+
+// ================== Session Server ==================
+
+// Requests and responses are fixed-size frames in the host's byte order; the
+// server is for clients on the same box.
+const uint8_t SERVER_OPEN = 1;    // values[0]: seed (0 for the default); answers with the new session id
+const uint8_t SERVER_PLAY = 2;    // values[0]: menu choice, values[1..]: answers to the questions it asks
+const uint8_t SERVER_STATUS = 3;
+const uint8_t SERVER_CLOSE = 4;
+
+const int32_t SERVER_OK = 0;
+const int32_t SERVER_NO_SESSION = 1;
+const int32_t SERVER_BAD_REQUEST = 2;
+const int32_t SERVER_GAME_OVER = 3;
+
+const int SERVER_MAX_VALUES = 4;
+
+struct ServerRequest {
+    uint32_t requestId;     // Echoed in the response
+    uint32_t session;
+    uint8_t command;
+    uint8_t valueCount;
+    uint16_t reserved;
+    int32_t values[SERVER_MAX_VALUES];
+};
+
+// Every response carries the session's headline numbers after the command
+struct ServerResponse {
+    uint32_t requestId;
+    uint32_t session;
+    int32_t status;
+    int32_t turn;
+    int32_t population;
+    int32_t treasury;
+    int32_t soldiers;
+    int32_t food;
+};
+
+struct ServerState; // Event loop, sessions and workers, defined in server.cpp
+
+// Hosts independent StrongholdGame sessions behind Unix or loopback TCP
+// sockets. One epoll thread reads and writes every connection; commands run
+// on a worker pool, one at a time per session and in the order they arrived.
+// Linux only.
+class SessionServer {
+private:
+    ServerState* state;
+
+    SessionServer(const SessionServer&) = delete;
+    SessionServer& operator=(const SessionServer&) = delete;
+
+public:
+    // Sessions save to `saveDirectory`/session<id>.save, all through one writer thread
+    SessionServer(int threads = 0, const string& saveDirectory = ".");
+    ~SessionServer();
+
+    bool listenUnix(const string& path);
+    bool listenTcp(int port);
+
+    // Serve until stop(), which is safe to call from a signal handler
+    bool run();
+    void stop();
+
+    size_t getSessionCount() const; // Sessions opened and not closed
+};
+
+// ================== Replication ==================
+
+// A replication stream is a series of frames:
+//
+//   uint32 length of the rest, uint8 type, uint32 sequence, uint32 base
+//   sequence, uint32 game turn, varint kingdom count, varint changed
+//   kingdoms, then per changed kingdom: varint gap from the previous one,
+//   varint mask of changed 8-word groups, one byte per such group marking its
+//   changed words, and per changed word the zigzag varint of (new - old) as
+//   32-bit integers.
+//
+// Every publish gets the next sequence number (game turns can repeat after a
+// rewind). A delta is against the base sequence; a full frame is against
+// all-zero records. Subscribers answer every frame they apply with its
+// sequence (uint32).
+const uint8_t REPLICATION_FULL = 1;
+const uint8_t REPLICATION_DELTA = 2;
+const uint32_t REPLICATION_NEED_FULL = 0xFFFFFFFFu; // Ack asking for a full frame
+const int REPLICATION_HISTORY = 64;                 // Publishes kept on both ends as delta bases
+const int REPLICATION_DEFAULT_FULL_EVERY = 100;     // Frames between full resyncs of a subscriber
+const size_t REPLICATION_MAX_BACKLOG = 4 << 20;     // Unsent bytes before a subscriber skips turns
+
+// Append a frame for `world` against `base` (pass an empty base for a full frame)
+void appendReplicationFrame(string& out, uint8_t type, uint32_t sequence, uint32_t baseSequence,
+                            uint32_t turn, const PersistentVector<KingdomRecord>& base,
+                            const PersistentVector<KingdomRecord>& world);
+
+// Apply the kingdom count and changes of a frame (the bytes after its game
+// turn) to `world`; returns the number of kingdoms changed, or -1 if malformed
+int applyReplicationChanges(const char* data, size_t length, PersistentVector<KingdomRecord>& world);
+
+struct ReplicationState; // Subscribers and the sender thread, defined in replication.cpp
+
+// Serves a world's turns to spectators on a local (Unix domain) socket. Each
+// subscriber gets a delta against the last frame it acknowledged, or a full
+// frame when it joins, falls too far behind or every `fullEvery` frames. A
+// subscriber that cannot keep up skips turns instead of queuing them.
+class ReplicationPublisher {
+private:
+    ReplicationState* state;
+
+    ReplicationPublisher(const ReplicationPublisher&) = delete;
+    ReplicationPublisher& operator=(const ReplicationPublisher&) = delete;
+
+public:
+    ReplicationPublisher(int fullEvery = REPLICATION_DEFAULT_FULL_EVERY);
+    ~ReplicationPublisher();
+
+    bool listen(const string& socketPath);
+
+    // Hand over a turn; O(1) for the caller, the sender thread encodes it
+    void publish(uint32_t turn, const PersistentVector<KingdomRecord>& world);
+
+    size_t getSubscriberCount() const;
+    uint64_t getBytesSent() const;
+};
+
+// Follows a ReplicationPublisher
+class ReplicationSubscriber {
+private:
+    struct Version {
+        uint32_t sequence;
+        uint32_t turn;
+        PersistentVector<KingdomRecord> world;
+    };
+
+    int fd;
+    string inbox;
+    vector<Version> versions; // Recent turns, oldest first, for delta bases
+    bool lastFull;
+    size_t lastBytes;
+    int lastChanged;
+
+    ReplicationSubscriber(const ReplicationSubscriber&) = delete;
+    ReplicationSubscriber& operator=(const ReplicationSubscriber&) = delete;
+
+    bool acknowledge(uint32_t sequence);
+
+public:
+    ReplicationSubscriber();
+    ~ReplicationSubscriber();
+
+    bool connect(const string& socketPath);
+
+    // Wait for the next frame and apply it; false once the publisher is gone
+    bool receive();
+
+    bool hasWorld() const;
+    uint32_t getTurn() const;
+    const PersistentVector<KingdomRecord>& getWorld() const;
+
+    // About the last frame received
+    bool wasFull() const;
+    size_t getFrameBytes() const;
+    int getChangedCount() const;
+};
+
+// ================== Live State ==================
+
+// A POSIX shared-memory segment holding the current state of every kingdom,
+// for monitoring tools outside the process. Layout:
+//
+//   LiveStateHeader, padded to LIVE_STATE_RECORDS_OFFSET bytes
+//   KingdomRecord[capacity]
+//
+// One writer updates it under a seqlock: `sequence` is odd while a turn is
+// being written and even once it is complete. Readers copy what they need,
+// then check the sequence did not move; neither side makes a system call
+// after the segment is mapped.
+
+const uint32_t LIVE_STATE_MAGIC = 0x534C4853; // "SHLS"
+const uint32_t LIVE_STATE_LAYOUT_VERSION = 1;
+const size_t LIVE_STATE_RECORDS_OFFSET = 128;
+const int LIVE_STATE_READ_ATTEMPTS = 1 << 20; // Before a reader assumes the writer died mid-turn
+
+struct LiveStateHeader {
+    uint32_t magic;         // Set last, once the rest is ready
+    uint32_t layoutVersion;
+    uint32_t recordBytes;   // sizeof(KingdomRecord) of the writer
+    uint32_t capacity;      // Kingdom slots in the segment
+    atomic<uint64_t> sequence;
+    // Written under the seqlock
+    uint32_t turn;
+    uint32_t kingdomCount;
+    uint64_t turnsPublished;
+};
+static_assert(sizeof(LiveStateHeader) <= LIVE_STATE_RECORDS_OFFSET, "Live state header overlaps the records");
+static_assert(atomic<uint64_t>::is_always_lock_free, "The seqlock must be lock free to work across processes");
+
+// The simulation's side: creates the segment, unlinked again on destruction
+class LiveStateWriter {
+private:
+    string name;
+    LiveStateHeader* header;
+    KingdomRecord* records;
+    size_t mappedBytes;
+
+    LiveStateWriter(const LiveStateWriter&) = delete;
+    LiveStateWriter& operator=(const LiveStateWriter&) = delete;
+
+public:
+    LiveStateWriter();
+    ~LiveStateWriter();
+
+    // Name is a shared-memory name such as "/stronghold"
+    bool open(const string& name, int capacity);
+
+    // Replace the published state; kingdoms past the capacity are dropped
+    void publish(uint32_t turn, const KingdomRecord* kingdoms, int count);
+    void publish(uint32_t turn, const PersistentVector<KingdomRecord>& kingdoms);
+};
+
+// A monitoring tool's side
+class LiveStateReader {
+private:
+    const LiveStateHeader* header;
+    const KingdomRecord* records;
+    size_t mappedBytes;
+
+    LiveStateReader(const LiveStateReader&) = delete;
+    LiveStateReader& operator=(const LiveStateReader&) = delete;
+
+public:
+    LiveStateReader();
+    ~LiveStateReader();
+
+    bool open(const string& name);
+
+    // Consistent copies of one turn's state; false if the writer never
+    // finished a turn (or stopped halfway through one)
+    bool snapshot(vector<KingdomRecord>& kingdoms, uint32_t& turn) const;
+    bool readKingdom(int kingdom, KingdomRecord& record, uint32_t& turn) const;
+
+    int getCapacity() const;
+};
+
+// ================== Rival Kingdoms ==================
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. Each side caches the other's index and only rereads it when the
+// queue looks full (or empty), so the shared cache lines are rarely touched.
+template<typename T>
+class SpscQueue {
+private:
+    SmallVector<T, 0, 64> slots;     // The block starts on a cache line; small slots share lines
+    size_t mask;
+    alignas(64) atomic<size_t> head; // Next slot to read, written by the consumer
+    size_t cachedTail;
+    alignas(64) atomic<size_t> tail; // Next slot to write, written by the producer
+    size_t cachedHead;
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+public:
+    // Capacity is rounded up to a power of two
+    explicit SpscQueue(size_t capacity) : head(0), cachedTail(0), tail(0), cachedHead(0) {
+        size_t size = 2;
+        while (size < capacity) size *= 2;
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    // Producer only; false if the queue is full
+    bool push(const T& value) {
+        size_t at = tail.load(memory_order_relaxed);
+        if (at - cachedHead > mask) {
+            cachedHead = head.load(memory_order_acquire);
+            if (at - cachedHead > mask) return false;
+        }
+        slots[at & mask] = value;
+        tail.store(at + 1, memory_order_release);
+        return true;
+    }
+
+    // Consumer only; false if the queue is empty
+    bool pop(T& value) {
+        size_t at = head.load(memory_order_relaxed);
+        if (at == cachedTail) {
+            cachedTail = tail.load(memory_order_acquire);
+            if (at == cachedTail) return false;
+        }
+        value = slots[at & mask];
+        head.store(at + 1, memory_order_release);
+        return true;
+    }
+};
+
+const int RIVAL_KINGDOMS = 4;
+const int RIVAL_DEFAULT_THREADS = 2;
+const int RIVAL_TURN_MILLIS = 250;     // Rivals play a turn this often while running
+const int RIVAL_POLL_MILLIS = 5;       // How often a worker checks for commands
+const int RIVAL_REPLY_TIMEOUT_MILLIS = 500;
+
+// What the menu can ask of a worker
+const int RIVAL_SNAPSHOT = 1; // Reply with a snapshot of every kingdom the worker runs
+const int RIVAL_STOP = 2;
+
+struct RivalCommand {
+    int type;
+    uint32_t request; // Echoed in the snapshots that answer it
+};
+
+// One rival kingdom as it stood between two of its turns
+struct RivalSnapshot {
+    uint32_t request;
+    int kingdom;
+    int turn;
+    KingdomRecord record;
+};
+
+struct RivalWorker; // One simulation thread and its queues, defined in rivals.cpp
+
+// AI kingdoms simulated on background threads while the player plays. Each
+// worker owns some of the kingdoms outright; the menu thread talks to it only
+// through a pair of SPSC queues, commands one way and snapshots the other.
+class RivalKingdoms {
+private:
+    SmallVector<RivalWorker*, RIVAL_KINGDOMS> workers;
+    int workerCount;
+    uint32_t nextRequest;
+
+    RivalKingdoms(const RivalKingdoms&) = delete;
+    RivalKingdoms& operator=(const RivalKingdoms&) = delete;
+
+    bool send(int worker, int type, uint32_t request);
+
+public:
+    RivalKingdoms(int threads = RIVAL_DEFAULT_THREADS, uint64_t seed = GAME_DEFAULT_SEED);
+    ~RivalKingdoms();
+
+    // Every kingdom as of its latest finished turn, in kingdom order; false
+    // if a worker did not answer in time
+    bool snapshot(vector<RivalSnapshot>& kingdoms);
+};
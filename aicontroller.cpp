@@ -7,38 +7,20 @@ AIController::AIController() {
     lastTaxCollection = 0;
     lastArmySize = 0;
     conflictLevel = 3; // Start with moderate conflict level
-    
-    // Initialize dynamic arrays using new keyword
-    decisionHistoryCapacity = 10;
-    decisionHistorySize = 0;
-    decisionHistory = new int[decisionHistoryCapacity];
+    autonomous = false;
     
     // Initialize unit strength factors
     unitTypesCount = 5; // Infantry, Cavalry, Archers, Siege, Special
-    unitStrengthFactors = new float[unitTypesCount];
-    for (int i = 0; i < unitTypesCount; i++) {
-        unitStrengthFactors[i] = 1.0f; // Default strength factor
-    }
+    unitStrengthFactors.resize(unitTypesCount, 1.0f); // Default strength factor
     
     // Initialize resource allocation priorities
     resourceTypesCount = 4; // Gold, Food, Wood, Stone
-    resourceAllocation = new int[resourceTypesCount];
-    for (int i = 0; i < resourceTypesCount; i++) {
-        resourceAllocation[i] = 25; // Equal priority by default (25% each)
-    }
+    resourceAllocation.resize(resourceTypesCount, 25); // Equal priority by default (25% each)
 }
 
-// Destructor to clean up dynamically allocated memory
-AIController::~AIController() {
-    // Free all dynamically allocated arrays using delete[] operator
-    delete[] decisionHistory;
-    delete[] unitStrengthFactors;
-    delete[] resourceAllocation;
-    
-    // Set pointers to nullptr to avoid dangling pointers
-    decisionHistory = nullptr;
-    unitStrengthFactors = nullptr;
-    resourceAllocation = nullptr;
+// An autonomous AI runs a kingdom nobody is playing, so it never asks
+void AIController::setAutonomous(bool value) {
+    autonomous = value;
 }
 
 // Helper method to calculate appropriate tax rate based on economic and population factors
@@ -88,25 +70,10 @@ int AIController::assessConflictSeverity(const Population& pop, const Economy& e
 
 // Method to add a decision to the history array
 void AIController::addDecision(int decisionCode) {
-    // Check if we need to resize the array
-    if (decisionHistorySize >= decisionHistoryCapacity) {
-        // Create a new larger array
-        int newCapacity = decisionHistoryCapacity * 2;
-        int* newHistory = new int[newCapacity];
-        
-        // Copy existing elements to the new array
-        for (int i = 0; i < decisionHistorySize; i++) {
-            newHistory[i] = decisionHistory[i];
-        }
-        
-        // Delete the old array and update pointers
-        delete[] decisionHistory;
-        decisionHistory = newHistory;
-        decisionHistoryCapacity = newCapacity;
-    }
-    
-    // Add the new decision to the array
-    decisionHistory[decisionHistorySize++] = decisionCode;
+    Metrics::count(METRIC_AI_DECISIONS);
+
+    // Add the new decision to the array (it spills to the heap past 16)
+    decisionHistory.push_back(decisionCode);
 }
 
 // Method to update the strength factor for a specific unit type
@@ -148,34 +115,36 @@ void AIController::setResourcePriority(int resourceType, int priority) {
 }
 
 // Main decision method for taxation
-string AIController::makeTaxDecision(Economy& eco, Population& pop) {
-    string report = "\n[AI TAX DECISION]\n";
+TurnString AIController::makeTaxDecision(Economy& eco, Population& pop) {
+    ScopedLatency timing(PHASE_AI_TAX);
+    ScopedTrace span("ai.tax");
+    TurnString report = turnString("\n[AI TAX DECISION]\n");
     report += "Analyzing kingdom economic state...\n";
     
     // Calculate optimal tax rate
     float taxRate = calculateTaxRate(eco, pop);
     int treasuryBefore = eco.getTreasury();
     
-    // Create a temporary array for tax rate analysis by population segment
-    float* taxRateBySegment = new float[3]; // 3 segments: peasants, merchants, nobles
+    // Scratch array for tax rate analysis by population segment, freed with the turn
+    float* taxRateBySegment = TurnArena::local().allocate<float>(3); // 3 segments: peasants, merchants, nobles
     taxRateBySegment[0] = taxRate * 0.8f;  // Lower rate for peasants
     taxRateBySegment[1] = taxRate * 1.0f;  // Standard rate for merchants
     taxRateBySegment[2] = taxRate * 1.2f;  // Higher rate for nobles
     
     // Display tax rates by segment
     report += "Tax rate analysis by population segment:\n";
-    report += "  Peasants: " + to_string((int)(taxRateBySegment[0] * 100)) + "%\n";
-    report += "  Merchants: " + to_string((int)(taxRateBySegment[1] * 100)) + "%\n";
-    report += "  Nobles: " + to_string((int)(taxRateBySegment[2] * 100)) + "%\n";
+    appendText(report, "  Peasants: ", (int)(taxRateBySegment[0] * 100), "%\n");
+    appendText(report, "  Merchants: ", (int)(taxRateBySegment[1] * 100), "%\n");
+    appendText(report, "  Nobles: ", (int)(taxRateBySegment[2] * 100), "%\n");
     
     // Apply the tax decision
-    report += "AI Decision: Setting tax rate to " + to_string((int)(taxRate * 100)) + "%\n";
+    appendText(report, "AI Decision: Setting tax rate to ", (int)(taxRate * 100), "%\n");
     report += "Reasoning: Based on population size and economic indicators\n";
     
     // Adjust resource allocation based on expected tax income
     report += "Adjusting resource allocation priorities:\n";
     for (int i = 0; i < resourceTypesCount; i++) {
-        report += "  Resource " + to_string(i) + ": " + to_string(resourceAllocation[i]) + "% priority\n";
+        appendText(report, "  Resource ", i, ": ", resourceAllocation[i], "% priority\n");
     }
     
     // Simulate tax collection
@@ -183,7 +152,7 @@ string AIController::makeTaxDecision(Economy& eco, Population& pop) {
     int treasuryAfter = eco.getTreasury();
     lastTaxCollection = treasuryAfter - treasuryBefore;
     
-    report += "Tax collection complete. Treasury increased by " + to_string(lastTaxCollection) + " gold.\n";
+    appendText(report, "Tax collection complete. Treasury increased by ", lastTaxCollection, " gold.\n");
     
     // Assess impact and provide feedback
     int decisionCode = 0;
@@ -204,32 +173,36 @@ string AIController::makeTaxDecision(Economy& eco, Population& pop) {
     // Record this decision in our history
     addDecision(decisionCode);
     
-    // Clean up dynamically allocated memory
-    delete[] taxRateBySegment;
-    
     return report;
 }
 
 // Main decision method for army management
-string AIController::mobilizeArmy(Army& army, Population& pop, ResourceManager& res) {
-    string report = "\n[AI ARMY DECISION]\n";
+TurnString AIController::mobilizeArmy(Army& army, Population& pop, ResourceManager& res) {
+    ScopedLatency timing(PHASE_AI_ARMY);
+    ScopedTrace span("ai.army");
+    TurnString report = turnString("\n[AI ARMY DECISION]\n");
     report += "Analyzing military needs and resources...\n";
     
     // Store current army size
     int armySizeBefore = army.getSoldiers();
     lastArmySize = armySizeBefore;
     
+    // The army's training is where this turn's tuning starts
+    for (int i = 0; i < unitTypesCount; i++) {
+        unitStrengthFactors[i] = army.getUnitStrength()[i];
+    }
+    
     // Calculate recruitment needs using unit strength factors
     int recruitmentTarget = determineRecruitmentNeeds(army, pop);
     
     // Apply unit strength factors to determine unit type distribution
     report += "Unit strength analysis:\n";
     for (int i = 0; i < unitTypesCount; i++) {
-        report += "  Unit Type " + to_string(i) + ": Strength factor " + to_string(unitStrengthFactors[i]) + "\n";
+        appendText(report, "  Unit Type ", i, ": Strength factor ", unitStrengthFactors[i], "\n");
     }
     
-    // Adjust resource allocation based on army needs
-    int* tempAllocation = new int[resourceTypesCount];
+    // Adjust resource allocation based on army needs (scratch, freed with the turn)
+    int* tempAllocation = TurnArena::local().allocate<int>(resourceTypesCount);
     for (int i = 0; i < resourceTypesCount; i++) {
         // Temporarily increase military resource allocation
         tempAllocation[i] = resourceAllocation[i];
@@ -240,15 +213,19 @@ string AIController::mobilizeArmy(Army& army, Population& pop, ResourceManager&
         }
     }
     
-    report += "AI Decision: Recruiting " + to_string(recruitmentTarget) + " new soldiers\n";
+    appendText(report, "AI Decision: Recruiting ", recruitmentTarget, " new soldiers\n");
     report += "Reasoning: Based on current threats and available population\n";
     
     // Execute recruitment
-    army.recruitAndTrain(pop);
+    if (autonomous) {
+        army.recruit(pop, recruitmentTarget);
+    } else {
+        army.recruitAndTrain(pop);
+    }
     int armySizeAfter = army.getSoldiers();
     int actualRecruitment = armySizeAfter - armySizeBefore;
     
-    report += "Recruitment complete. Army increased by " + to_string(actualRecruitment) + " soldiers.\n";
+    appendText(report, "Recruitment complete. Army increased by ", actualRecruitment, " soldiers.\n");
     
     // Assess results and update unit strength factors based on performance
     if (actualRecruitment >= recruitmentTarget) {
@@ -267,8 +244,10 @@ string AIController::mobilizeArmy(Army& army, Population& pop, ResourceManager&
         updateUnitStrength(0, unitStrengthFactors[0] - 0.05f); // Reduce infantry reliance
     }
     
-    // Clean up temporary allocation array
-    delete[] tempAllocation;
+    // Train the army to the tuned factors, so they carry into its battles
+    for (int i = 0; i < unitTypesCount; i++) {
+        army.setUnitStrength(i, unitStrengthFactors[i]);
+    }
     
     // Record decision
     addDecision(actualRecruitment >= recruitmentTarget ? 10 : 11);
@@ -276,15 +255,41 @@ string AIController::mobilizeArmy(Army& army, Population& pop, ResourceManager&
     return report;
 }
 
+// Army management followed by a march to the rally point on the world map
+TurnString AIController::mobilizeArmy(Army& army, Population& pop, ResourceManager& res,
+                                      PathfindingService& paths, int rallyX, int rallyY) {
+    TurnString report = mobilizeArmy(army, pop, res);
+    
+    // Armies rallying at the same point share one cached flow field
+    appendText(report, "AI Decision: Marching army to rally point (", rallyX, ", ", rallyY, ")\n");
+    army.marchTo(rallyX, rallyY);
+    
+    // Bolder AIs push their armies further each turn
+    int stepsPerTurn = 3 + (int)(riskTolerance * 4);
+    int steps = army.advanceMarch(paths, stepsPerTurn);
+    
+    appendText(report, "Army marched ", steps, " tiles and now stands at (", army.getPositionX(), ", ",
+               army.getPositionY(), ").\n");
+    if (!army.isMarching() && army.getPositionX() == rallyX && army.getPositionY() == rallyY) {
+        report += "Result: Army has reached the rally point.\n";
+    }
+    
+    addDecision(army.isMarching() ? 12 : 13); // Codes for marching / arrived
+    
+    return report;
+}
+
 // Main decision method for handling internal conflicts
-string AIController::handleInternalConflict(Population& pop, Army& army, Economy& eco) {
-    string report = "\n[AI CONFLICT MANAGEMENT]\n";
+TurnString AIController::handleInternalConflict(Population& pop, Army& army, Economy& eco) {
+    ScopedLatency timing(PHASE_AI_CONFLICT);
+    ScopedTrace span("ai.conflict");
+    TurnString report = turnString("\n[AI CONFLICT MANAGEMENT]\n");
     report += "Assessing internal kingdom stability...\n";
     
     // Assess conflict severity
     int severity = assessConflictSeverity(pop, eco);
     
-    report += "Detected conflict level: " + to_string(severity) + "/10\n";
+    appendText(report, "Detected conflict level: ", severity, "/10\n");
     
     // Make decisions based on severity
     int decisionCode = 0;
@@ -311,7 +316,7 @@ string AIController::handleInternalConflict(Population& pop, Army& army, Economy
         conflictLevel -= 2;
         decisionCode = 2; // Code for economic action
         
-        report += "Spent " + to_string(appeasementCost) + " gold on public works and relief.\n";
+        appendText(report, "Spent ", appeasementCost, " gold on public works and relief.\n");
         report += "Conflict reduced through economic means.\n";
     }
     else {
@@ -334,7 +339,7 @@ string AIController::handleInternalConflict(Population& pop, Army& army, Economy
     if (conflictLevel < 0) conflictLevel = 0;
     if (conflictLevel > 10) conflictLevel = 10;
     
-    report += "Current conflict level after actions: " + to_string(conflictLevel) + "/10\n";
+    appendText(report, "Current conflict level after actions: ", conflictLevel, "/10\n");
     
     return report;
-}
\ No newline at end of file
+}
\ No newline at end of file
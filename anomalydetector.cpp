@@ -0,0 +1,232 @@
+#include "Stronghold.h"
+#include <cmath>
+
+// Detector settings
+static const float EWMA_ALPHA = 0.1f;       // Weight of the newest sample
+static const int MIN_SAMPLES = 5;           // Warm-up before anything is flagged
+static const float SPIKE_Z = 4.0f;          // Standard scores beyond this are spikes
+static const float CUSUM_SLACK = 0.5f;      // Drift tolerated per sample
+static const float CUSUM_LIMIT = 5.0f;      // Accumulated drift that raises an alert
+
+// ========== Quantile Sketch (P-square) ==========
+
+void QuantileSketch::reset(float q) {
+    quantile = q;
+    samples = 0;
+    for (int i = 0; i < 5; i++) {
+        heights[i] = 0.0f;
+        positions[i] = (float)(i + 1);
+    }
+    desired[0] = 1.0f;
+    desired[1] = 1.0f + 2.0f * q;
+    desired[2] = 1.0f + 4.0f * q;
+    desired[3] = 3.0f + 2.0f * q;
+    desired[4] = 5.0f;
+}
+
+void QuantileSketch::add(float value) {
+    // The first five samples seed the markers
+    if (samples < 5) {
+        int i = samples++;
+        while (i > 0 && heights[i - 1] > value) {
+            heights[i] = heights[i - 1];
+            i--;
+        }
+        heights[i] = value;
+        return;
+    }
+    samples++;
+
+    // Find the cell the value falls in, stretching the extremes if needed
+    int cell;
+    if (value < heights[0]) {
+        heights[0] = value;
+        cell = 0;
+    } else if (value >= heights[4]) {
+        heights[4] = value;
+        cell = 3;
+    } else {
+        cell = 0;
+        while (cell < 3 && value >= heights[cell + 1]) cell++;
+    }
+
+    for (int i = cell + 1; i < 5; i++) {
+        positions[i] += 1.0f;
+    }
+    float increments[5] = { 0.0f, quantile / 2.0f, quantile, (1.0f + quantile) / 2.0f, 1.0f };
+    for (int i = 0; i < 5; i++) {
+        desired[i] += increments[i];
+    }
+
+    // Nudge the middle markers toward their desired positions
+    for (int i = 1; i < 4; i++) {
+        float offset = desired[i] - positions[i];
+        if ((offset >= 1.0f && positions[i + 1] - positions[i] > 1.0f) ||
+            (offset <= -1.0f && positions[i - 1] - positions[i] < -1.0f)) {
+            float step = offset > 0.0f ? 1.0f : -1.0f;
+
+            // Piecewise-parabolic prediction, linear if it leaves the bracket
+            float parabolic = heights[i] + step / (positions[i + 1] - positions[i - 1]) *
+                ((positions[i] - positions[i - 1] + step) * (heights[i + 1] - heights[i]) / (positions[i + 1] - positions[i]) +
+                 (positions[i + 1] - positions[i] - step) * (heights[i] - heights[i - 1]) / (positions[i] - positions[i - 1]));
+            if (heights[i - 1] < parabolic && parabolic < heights[i + 1]) {
+                heights[i] = parabolic;
+            } else {
+                int neighbour = i + (int)step;
+                heights[i] += step * (heights[neighbour] - heights[i]) / (positions[neighbour] - positions[i]);
+            }
+            positions[i] += step;
+        }
+    }
+}
+
+float QuantileSketch::estimate() const {
+    if (samples == 0) return 0.0f;
+    if (samples < 5) {
+        int index = (int)(quantile * (samples - 1) + 0.5f);
+        return heights[index];
+    }
+    return heights[2];
+}
+
+// ========== Stream Statistics ==========
+
+void StreamStats::reset() {
+    mean = 0.0f;
+    variance = 0.0f;
+    cusumLow = 0.0f;
+    samples = 0;
+    low.reset(0.05f);
+}
+
+float StreamStats::deviation() const {
+    // Floored so a perfectly steady stream neither divides by zero nor
+    // clips every later value to the mean
+    float deviation = sqrt(variance);
+    float floor = 0.05f * fabs(mean);
+    if (floor < 1.0f) floor = 1.0f;
+    return deviation > floor ? deviation : floor;
+}
+
+float StreamStats::zScore(float value) const {
+    return (value - mean) / deviation();
+}
+
+void StreamStats::update(float value) {
+    // The percentile sees every value as it is
+    low.add(value);
+
+    // Winsorize, so one outlier cannot inflate the variance
+    if (samples >= MIN_SAMPLES) {
+        float limit = SPIKE_Z * deviation();
+        if (value > mean + limit) value = mean + limit;
+        if (value < mean - limit) value = mean - limit;
+    }
+
+    if (samples == 0) {
+        mean = value;
+        variance = 0.0f;
+    } else {
+        float difference = value - mean;
+        mean += EWMA_ALPHA * difference;
+        variance = (1.0f - EWMA_ALPHA) * (variance + EWMA_ALPHA * difference * difference);
+    }
+    samples++;
+}
+
+// ========== Treasury Monitor ==========
+
+// Constructor starts every kingdom with empty statistics
+TreasuryMonitor::TreasuryMonitor(int kingdoms) {
+    kingdomCount = kingdoms > 0 ? kingdoms : 1;
+    this->kingdoms.resize(kingdomCount);
+    for (int k = 0; k < kingdomCount; k++) {
+        KingdomStats& stats = this->kingdoms[k];
+        stats.lastTreasury = 0;
+        stats.seen = false;
+        stats.treasuryDeltas.reset();
+        stats.spending.reset();
+        stats.pendingAlerts = 0;
+        stats.worstDrop = 0;
+    }
+}
+
+// Record a treasury change; `spent` is the gold spent by it (0 for income)
+void TreasuryMonitor::observe(int kingdom, int treasury, int spent) {
+    if (kingdom < 0 || kingdom >= kingdomCount) return;
+    KingdomStats& stats = kingdoms[kingdom];
+
+    if (stats.seen) {
+        float delta = (float)(treasury - stats.lastTreasury);
+        StreamStats& deltas = stats.treasuryDeltas;
+
+        if (deltas.samples >= MIN_SAMPLES) {
+            float z = deltas.zScore(delta);
+
+            // Betrayal-like drop: far below both the running mean and the 5th percentile
+            if (delta < 0.0f && z < -SPIKE_Z && delta < deltas.low.estimate()) {
+                stats.pendingAlerts |= ALERT_SUDDEN_DROP;
+                if ((int)-delta > stats.worstDrop) stats.worstDrop = (int)-delta;
+            }
+
+            // Lower CUSUM catches a slow bleed that no single drop gives away
+            // (scores are clipped so one spike alone cannot trip it)
+            if (z < -SPIKE_Z) z = -SPIKE_Z;
+            deltas.cusumLow -= z + CUSUM_SLACK;
+            if (deltas.cusumLow < 0.0f) deltas.cusumLow = 0.0f;
+            if (deltas.cusumLow > CUSUM_LIMIT) {
+                stats.pendingAlerts |= ALERT_SUSTAINED_DRAIN;
+                deltas.cusumLow = 0.0f;
+            }
+        }
+        deltas.update(delta);
+    }
+
+    if (spent > 0) {
+        StreamStats& spending = stats.spending;
+        if (spending.samples >= MIN_SAMPLES && spending.zScore((float)spent) > SPIKE_Z) {
+            stats.pendingAlerts |= ALERT_UNUSUAL_SPENDING;
+        }
+        spending.update((float)spent);
+    }
+
+    stats.lastTreasury = treasury;
+    stats.seen = true;
+}
+
+// Observe the treasury of many kingdoms at once (no spending detail)
+void TreasuryMonitor::observeBatch(const int* treasuries, int count) {
+    if (count > kingdomCount) count = kingdomCount;
+    for (int k = 0; k < count; k++) {
+        observe(k, treasuries[k], 0);
+    }
+}
+
+// Alerts raised since the last call, cleared on read
+int TreasuryMonitor::takeAlerts(int kingdom, int& worstDrop) {
+    worstDrop = 0;
+    if (kingdom < 0 || kingdom >= kingdomCount) return 0;
+
+    KingdomStats& stats = kingdoms[kingdom];
+    int alerts = stats.pendingAlerts;
+    worstDrop = stats.worstDrop;
+    stats.pendingAlerts = 0;
+    stats.worstDrop = 0;
+    return alerts;
+}
+
+// Treat the given treasury as the new starting point without scoring the jump
+void TreasuryMonitor::resetBaseline(int kingdom, int treasury) {
+    if (kingdom < 0 || kingdom >= kingdomCount) return;
+    kingdoms[kingdom].lastTreasury = treasury;
+    kingdoms[kingdom].seen = true;
+}
+
+const TreasuryMonitor::KingdomStats& TreasuryMonitor::getStats(int kingdom) const {
+    return kingdoms[kingdom < 0 || kingdom >= kingdomCount ? 0 : kingdom];
+}
+
+void TreasuryMonitor::setStats(int kingdom, const KingdomStats& stats) {
+    if (kingdom < 0 || kingdom >= kingdomCount) return;
+    kingdoms[kingdom] = stats;
+}
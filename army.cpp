@@ -5,26 +5,46 @@ Army::Army() {
     soldiers = 20;
     morale = 70;       // 0–100 scale
     foodSupply = 100;  // units of food for the army
+
+    // Default composition: Infantry, Cavalry, Archers, Siege, Special
+    unitMix[0] = 0.60f;
+    unitMix[1] = 0.15f;
+    unitMix[2] = 0.20f;
+    unitMix[3] = 0.03f;
+    unitMix[4] = 0.02f;
+    for (int t = 0; t < UNIT_TYPES; t++) {
+        unitStrength[t] = 1.0f;
+    }
+
+    // Stationed at the map origin until told otherwise
+    posX = 0;
+    posY = 0;
+    marchX = 0;
+    marchY = 0;
+    marching = false;
 }
 
 // Recruit and train soldiers from population
 void Army::recruitAndTrain(Population& pop) {
-    cout << "\n--- Army Recruitment & Training ---\n";
+    console() << "\n--- Army Recruitment & Training ---\n";
 
-    int recruitCount;
-    cout << "Enter number of soldiers to recruit: ";
-    cin >> recruitCount;
+    int recruitCount = 0;
+    InputProvider::local().readInt("Enter number of soldiers to recruit: ", recruitCount);
+    recruit(pop, recruitCount);
+}
 
+// Recruit a given number of soldiers without asking; false if none joined
+bool Army::recruit(Population& pop, int recruitCount) {
     if (recruitCount <= 0 || recruitCount > pop.getTotal()) {
-        cout << "Invalid number of recruits. Aborting...\n";
-        return;
+        console() << "Invalid number of recruits. Aborting...\n";
+        return false;
     }
 
     int foodRequired = recruitCount * 2;
     if (foodSupply < foodRequired) {
-        cout << "Not enough food to train " << recruitCount << " soldiers!\n";
+        console() << "Not enough food to train " << recruitCount << " soldiers!\n";
         morale -= 10;
-        return;
+        return false;
     }
 
     pop.decrease(recruitCount); // Decrease population
@@ -38,17 +58,19 @@ void Army::recruitAndTrain(Population& pop) {
     if (morale > 100) morale = 100;
     if (morale < 0) morale = 0;
 
-    cout << recruitCount << " soldiers recruited and trained.\n";
-    cout << "Food used: " << foodRequired << "\n";
-    cout << "Current morale: " << morale << "%\n";
+    console() << recruitCount << " soldiers recruited and trained.\n";
+    console() << "Food used: " << foodRequired << "\n";
+    console() << "Current morale: " << morale << "%\n";
+    return true;
 }
 
 // Display current army stats
 void Army::showStats() const {
-    cout << "\n====== Army Stats ======\n";
-    cout << "Total Soldiers: " << soldiers << endl;
-    cout << "Morale: " << morale << "%\n";
-    cout << "Food Supply: " << foodSupply << " units\n";
+    OutputSink& sink = OutputSink::local();
+    sink.section("Army Stats", this);
+    sink.field("Total Soldiers", soldiers);
+    sink.field("Morale", morale, "%");
+    sink.field("Food Supply", foodSupply, " units");
 }
 
 // Save to file
@@ -63,7 +85,7 @@ void Army::saveToFile() const {
     out << morale << endl;
     out << foodSupply << endl;
     out.close();
-    cout << "Army data saved successfully.\n";
+    console() << "Army data saved successfully.\n";
 }
 
 // Load from file
@@ -76,7 +98,7 @@ void Army::loadFromFile() {
 
     in >> soldiers >> morale >> foodSupply;
     in.close();
-    cout << "Army data loaded successfully.\n";
+    console() << "Army data loaded successfully.\n";
 }
 
 // Lower morale (used by events, economic trouble etc.)
@@ -89,11 +111,134 @@ void Army::lowerMorale(int amount) {
     // Example: gameSaver.logResourceChange("MORALE", oldMorale, morale, "Event impact");
 }
 
+// Split the army into unit types for the battle engine
+BattleSide Army::toBattleSide() const {
+    BattleSide side;
+    for (int t = 0; t < UNIT_TYPES; t++) {
+        side.units[t] = soldiers * unitMix[t];
+    }
+    side.morale = (float)morale;
+    side.foodSupply = (float)foodSupply;
+    return side;
+}
+
+// Set how well one unit type is trained (1.0 is the baseline)
+void Army::setUnitStrength(int unitType, float strength) {
+    if (unitType >= 0 && unitType < UNIT_TYPES) {
+        unitStrength[unitType] = strength;
+    }
+}
+
+// Take back the survivors of a battle (composition follows who survived)
+void Army::applyBattleResult(const BattleSide& survivors) {
+    float remaining = 0.0f;
+    for (int t = 0; t < UNIT_TYPES; t++) {
+        remaining += survivors.units[t];
+    }
+
+    if (remaining > 0.0f) {
+        for (int t = 0; t < UNIT_TYPES; t++) {
+            unitMix[t] = survivors.units[t] / remaining;
+        }
+    }
+
+    trackResourceChange(soldiers, (int)(remaining + 0.5f) - soldiers, "SOLDIERS", "Battle casualties");
+    trackResourceChange(foodSupply, (int)survivors.foodSupply - foodSupply, "FOOD_SUPPLY", "Battle rations");
+    trackResourceChange(morale, (int)survivors.morale - morale, "MORALE", "Battle outcome");
+
+    // Clamp values
+    if (morale > 100) morale = 100;
+    if (morale < 0) morale = 0;
+}
+
+// Station the army on a tile (cancels any march)
+void Army::setPosition(int x, int y) {
+    posX = x;
+    posY = y;
+    marching = false;
+}
+
+// Order the army to march to a tile
+void Army::marchTo(int x, int y) {
+    marchX = x;
+    marchY = y;
+    marching = !(x == posX && y == posY);
+}
+
+// Follow the shared flow field towards the march target
+int Army::advanceMarch(PathfindingService& paths, int maxSteps) {
+    int steps = 0;
+    int rationsPerStep = soldiers / 10 > 0 ? soldiers / 10 : 1;
+
+    while (marching && steps < maxSteps) {
+        if (foodSupply < rationsPerStep) {
+            console() << "The army has run out of food and halts its march.\n";
+            break;
+        }
+
+        TilePosition next;
+        if (!paths.nextStep(posX, posY, marchX, marchY, next)) {
+            console() << "No route to (" << marchX << ", " << marchY << "). March cancelled.\n";
+            marching = false;
+            break;
+        }
+
+        posX = next.x;
+        posY = next.y;
+        trackResourceChange(foodSupply, -rationsPerStep, "FOOD_SUPPLY", "March rations");
+        steps++;
+
+        if (posX == marchX && posY == marchY) {
+            marching = false;
+        }
+    }
+    return steps;
+}
+
 // Helper method to track resource changes
 void Army::trackResourceChange(int& resource, int change, const std::string& resourceType, const std::string& action) {
     int oldValue = resource;
     resource += change;
+    Metrics::count(METRIC_RESOURCE_CHANGES);
     
     // This can be used for logging with GameSaver later
     // Example: gameSaver.logResourceChange(resourceType, oldValue, resource, action);
 }
+
+// Copy the army state into a snapshot record
+void Army::exportState(KingdomRecord& record) const {
+    record.soldiers = soldiers;
+    record.morale = morale;
+    record.armyFood = foodSupply;
+    for (int t = 0; t < UNIT_TYPES; t++) {
+        record.unitMix[t] = unitMix[t];
+        record.unitStrength[t] = unitStrength[t];
+    }
+    record.armyX = posX;
+    record.armyY = posY;
+}
+
+// Restore the army state from a snapshot record (march orders are not saved)
+void Army::importState(const KingdomRecord& record) {
+    soldiers = record.soldiers;
+    morale = record.morale;
+    foodSupply = record.armyFood;
+    for (int t = 0; t < UNIT_TYPES; t++) {
+        unitMix[t] = record.unitMix[t];
+        unitStrength[t] = record.unitStrength[t];
+    }
+    setPosition(record.armyX, record.armyY);
+}
+
+// March order, which the kingdom record does not hold
+void Army::exportMarch(int& targetX, int& targetY, bool& active) const {
+    targetX = marchX;
+    targetY = marchY;
+    active = marching;
+}
+
+void Army::importMarch(int targetX, int targetY, bool active) {
+    marchX = targetX;
+    marchY = targetY;
+    marching = active;
+}
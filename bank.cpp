@@ -4,90 +4,270 @@
 Bank::Bank() {
     loansIssued = 0;
     fraudDetected = 0;
+    defaults = 0;
+    anomalies = 0;
+}
+
+// Feed every transaction of this economy to the treasury monitor
+void Bank::watch(Economy& economy) {
+    economy.attachMonitor(&monitor, 0);
+}
+
+// Helper method: 2% per turn, one tier higher for every fraud case or default
+int Bank::currentRateTier() const {
+    int tier = 1 + fraudDetected + defaults;
+    return tier < LOAN_RATE_TIERS ? tier : LOAN_RATE_TIERS - 1;
 }
 
 // Audit treasury for possible fraud (basic check)
 void Bank::auditTreasury(Economy& economy) {
-    cout << "\nBank Audit in Progress...\n";
+    console() << "\nBank Audit in Progress...\n";
 
     int treasury = economy.getTreasury();
 
     if (treasury < 0) {
-        cout << "Fraud Detected! Treasury has negative balance.\n";
+        console() << "Fraud Detected! Treasury has negative balance.\n";
         fraudDetected++;
     } else if (treasury < 100) {
-        cout << "Low Treasury Warning: Only " << treasury << " gold left.\n";
+        console() << "Low Treasury Warning: Only " << treasury << " gold left.\n";
     } else {
-        cout << "Treasury audit passed. Gold is safe.\n";
+        console() << "Treasury audit passed. Gold is safe.\n";
+    }
+
+    // Report what the streaming monitor flagged since the last audit
+    int worstDrop;
+    int alerts = monitor.takeAlerts(0, worstDrop);
+    if (alerts & ALERT_SUDDEN_DROP) {
+        console() << "Anomaly: sudden loss of " << worstDrop << " gold, far outside normal movements. Possible betrayal!\n";
+        anomalies++;
+    }
+    if (alerts & ALERT_SUSTAINED_DRAIN) {
+        console() << "Anomaly: treasury has been draining steadily.\n";
+        anomalies++;
+    }
+    if (alerts & ALERT_UNUSUAL_SPENDING) {
+        console() << "Anomaly: unusually large spending detected.\n";
+        anomalies++;
     }
 }
 
-// Issue a loan (adds to treasury, increases debt)
-void Bank::issueLoan(Economy& economy, int amount) {
-    cout << "\nIssuing loan of " << amount << " gold...\n";
+// Issue a loan (adds to treasury, records it in the ledger)
+void Bank::issueLoan(Economy& economy, int amount, int termTurns) {
+    console() << "\nIssuing loan of " << amount << " gold...\n";
 
     if (amount <= 0) {
-        cout << "Invalid loan amount.\n";
+        console() << "Invalid loan amount.\n";
+        return;
+    }
+    if (termTurns < 1 || termTurns >= LOAN_MAX_TERM) {
+        console() << "Invalid loan term.\n";
         return;
     }
 
+    int tier = currentRateTier();
+    ledger.issue(0, amount, tier, termTurns);
     economy.receiveLoan(amount); // increase treasury
     loansIssued += amount;
-    cout << "Loan added to treasury. Total loans issued: " << loansIssued << "\n";
+    console() << "Loan added to treasury at " << (tier + 1) << "% interest per turn, due in "
+         << termTurns << " turns. Outstanding debt: " << getOutstandingDebt() << "\n";
 }
 
-// Repay a loan (reduces treasury)
+// Repay loans (reduces treasury), loans closest to maturity first
 void Bank::repayLoan(Economy& economy, int amount) {
-    cout << "\nRepaying loan of " << amount << " gold...\n";
+    console() << "\nRepaying loan of " << amount << " gold...\n";
 
-    if (amount <= 0 || amount > loansIssued) {
-        cout << "Invalid repayment amount.\n";
+    if (amount <= 0 || amount > getOutstandingDebt()) {
+        console() << "Invalid repayment amount.\n";
         return;
     }
 
     int currentTreasury = economy.getTreasury();
     if (amount > currentTreasury) {
-        cout << "Not enough gold to repay loan.\n";
+        console() << "Not enough gold to repay loan.\n";
         return;
     }
 
-    economy.spend(amount);
-    loansIssued -= amount;
-    cout << "Loan repaid. Remaining debt: " << loansIssued << "\n";
+    double remaining = amount;
+    int dueLoans[64];
+    int turn = ledger.getCurrentTurn();
+    for (int t = turn; t < turn + LOAN_MAX_TERM && remaining > 0.0; t++) {
+        int found = ledger.collectDueAt(t, dueLoans, 64);
+        for (int i = 0; i < found && i < 64 && remaining > 0.0; i++) {
+            remaining -= ledger.repay(dueLoans[i], remaining);
+        }
+        if (found > 64) t--; // More loans due this turn than fit, look again
+    }
+
+    economy.spend(amount - (int)remaining);
+    console() << "Loan repaid. Remaining debt: " << getOutstandingDebt() << "\n";
+}
+
+// Let the player take out or pay down a loan
+void Bank::visit(Economy& economy) {
+    InputProvider& input = InputProvider::local();
+    if (input.showsPrompts()) {
+        console() << "\nBank Menu\n";
+        console() << "Outstanding debt: " << getOutstandingDebt() << " gold at "
+                  << (currentRateTier() + 1) << "% interest per turn for new loans\n";
+        console() << "1. Take Out a Loan\n";
+        console() << "2. Repay Loans\n";
+    }
+    int choice = 0;
+    input.readInt(nullptr, choice);
+
+    if (choice == 1) {
+        int amount = 0;
+        int termTurns = 0;
+        input.readInt("Enter loan amount: ", amount);
+        input.readInt("Enter loan term in turns: ", termTurns);
+        issueLoan(economy, amount, termTurns);
+    } else if (choice == 2) {
+        int amount = 0;
+        input.readInt("Enter repayment amount: ", amount);
+        repayLoan(economy, amount);
+    } else {
+        console() << "Invalid choice.\n";
+    }
+}
+
+// Accrue interest and collect the loans that mature this turn
+void Bank::processTurn(Economy& economy) {
+    ScopedLatency timing(PHASE_BANK);
+    ScopedTrace span("bank.turn");
+    ledger.advanceTurn();
+
+    int dueLoans[64];
+    int found;
+    do {
+        found = ledger.collectDue(dueLoans, 64);
+        int batch = found < 64 ? found : 64;
+        for (int i = 0; i < batch; i++) {
+            int owed = (int)(ledger.balance(dueLoans[i]) + 0.5);
+            if (owed <= economy.getTreasury()) {
+                console() << "\nLoan matured. Paying back " << owed << " gold.\n";
+                economy.spend(owed);
+                ledger.repay(dueLoans[i], owed);
+                ledger.writeOff(dueLoans[i]); // Clear rounding leftovers
+            } else {
+                console() << "\nLoan of " << owed << " gold matured but the treasury cannot pay. Loan defaulted!\n";
+                ledger.writeOff(dueLoans[i]);
+                defaults++;
+            }
+        }
+    } while (found > 0);
+}
+
+// Outstanding debt including accrued interest
+int Bank::getOutstandingDebt() const {
+    return (int)(ledger.totalOutstanding() + 0.5);
 }
 
 // Show current banking info
 void Bank::showStats() const {
-    cout << "\n====== Bank Summary ======\n";
-    cout << "Total Loans Issued: " << loansIssued << " gold\n";
-    cout << "Fraud Cases Detected: " << fraudDetected << "\n";
+    OutputSink& sink = OutputSink::local();
+    sink.section("Bank Summary", this);
+    sink.field("Total Loans Issued", loansIssued, " gold");
+    sink.field("Outstanding Debt", getOutstandingDebt(), " gold (", ledger.getActiveCount(), " active loans)");
+    sink.field("Defaulted Loans", defaults);
+    sink.field("Fraud Cases Detected", fraudDetected);
+    sink.field("Treasury Anomalies Flagged", anomalies);
 }
 
 // Save to file
 void Bank::saveToFile() const {
     ofstream out("bank.txt");
     if (!out) {
-        cout << "Error: Could not save bank data.\n";
+        console() << "Error: Could not save bank data.\n";
         return;
     }
 
     out << loansIssued << endl;
     out << fraudDetected << endl;
+    out << defaults << endl;
+
+    // Active loans: balance, rate tier, turns left
+    KingdomRecord record;
+    vector<LoanRecord> loans;
+    exportState(record, loans);
+    out << loans.size() << endl;
+    for (size_t i = 0; i < loans.size(); i++) {
+        out << loans[i].balance << " " << loans[i].rateTier << " " << loans[i].turnsLeft << endl;
+    }
     out.close();
 
-    cout << "Bank data saved successfully.\n";
+    console() << "Bank data saved successfully.\n";
 }
 
 // Load from file
 void Bank::loadFromFile() {
     ifstream in("bank.txt");
     if (!in) {
-        cout << "Error: Could not load bank data.\n";
+        console() << "Error: Could not load bank data.\n";
         return;
     }
 
     in >> loansIssued >> fraudDetected;
+
+    // Older saves stop here
+    ledger.clear();
+    int loanCount = 0;
+    defaults = 0;
+    if (in >> defaults >> loanCount) {
+        for (int i = 0; i < loanCount; i++) {
+            double balance;
+            int tier, turnsLeft;
+            if (!(in >> balance >> tier >> turnsLeft)) break;
+            ledger.issue(0, balance, tier, turnsLeft);
+        }
+    }
     in.close();
 
-    cout << "Bank data loaded successfully.\n";
+    console() << "Bank data loaded successfully.\n";
+}
+
+// Copy the bank state and every active loan (closest to maturity first) into a snapshot
+void Bank::exportState(KingdomRecord& record, vector<LoanRecord>& loans) const {
+    record.loansIssued = loansIssued;
+    record.fraudDetected = fraudDetected;
+    record.defaults = defaults;
+    record.anomalies = anomalies;
+    record.outstandingDebt = getOutstandingDebt();
+
+    int activeLoans = ledger.getActiveCount();
+    SmallVector<int, 64> loanIds((size_t)activeLoans + 1);
+    int turn = ledger.getCurrentTurn();
+    loans.clear();
+    loans.reserve(activeLoans);
+    for (int t = turn; t < turn + LOAN_MAX_TERM && (int)loans.size() < activeLoans; t++) {
+        int found = ledger.collectDueAt(t, loanIds.data(), activeLoans);
+        for (int i = 0; i < found; i++) {
+            LoanRecord loan;
+            loan.balance = ledger.balance(loanIds[i]);
+            loan.rateTier = ledger.getRateTier(loanIds[i]);
+            loan.turnsLeft = t - turn;
+            loans.push_back(loan);
+        }
+    }
+}
+
+// Restore the bank state and its loans from a snapshot
+void Bank::importState(const KingdomRecord& record, const vector<LoanRecord>& loans) {
+    loansIssued = record.loansIssued;
+    fraudDetected = record.fraudDetected;
+    defaults = record.defaults;
+    anomalies = record.anomalies;
+
+    ledger.clear();
+    for (size_t i = 0; i < loans.size(); i++) {
+        ledger.issue(0, loans[i].balance, loans[i].rateTier, loans[i].turnsLeft);
+    }
+}
+
+// What the treasury monitor has learned, which the kingdom record does not hold
+void Bank::exportMonitor(TreasuryMonitor::KingdomStats& stats) const {
+    stats = monitor.getStats(0);
+}
+
+void Bank::importMonitor(const TreasuryMonitor::KingdomStats& stats) {
+    monitor.setStats(0, stats);
 }
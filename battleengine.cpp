@@ -0,0 +1,178 @@
+#include "Stronghold.h"
+
+// Time step and length of one engagement
+static const float BATTLE_DT = 0.05f;
+static const int BATTLE_MAX_ROUNDS = 60;
+// Battles are resolved in chunks small enough to stay in L1 for every round
+static const int BATTLE_CHUNK = 256;
+
+// A side breaks and flees once its morale falls below this value
+static const float ROUT_MORALE = 20.0f;
+// Morale lost per unit of casualty fraction
+static const float MORALE_SHOCK = 150.0f;
+// Food each soldier eats per round
+static const float SUPPLY_PER_ROUND = 0.02f;
+
+// Effectiveness of attacking unit type [row] against target unit type [column]
+// (Infantry, Cavalry, Archers, Siege, Special)
+static const float MATCHUP[UNIT_TYPES][UNIT_TYPES] = {
+    { 1.0f, 1.3f, 0.9f, 1.5f, 0.8f }, // Infantry holds against cavalry
+    { 0.8f, 1.0f, 1.6f, 1.8f, 0.9f }, // Cavalry runs down archers and siege crews
+    { 1.4f, 0.7f, 1.0f, 1.2f, 0.9f }, // Archers shred infantry
+    { 1.2f, 0.5f, 1.0f, 1.0f, 1.0f }, // Siege is slow but breaks formations
+    { 1.2f, 1.2f, 1.2f, 1.2f, 1.0f }  // Special forces are good at everything
+};
+
+// Number of float arrays carved out of the batch storage
+static const int BATTLE_ARRAYS = UNIT_TYPES * 4 + 5;
+
+// Constructor carves every per-battle array out of one allocation
+BattleBatch::BattleBatch(int battles) {
+    const int perLine = (int)(SIMD_ALIGN / sizeof(float));
+    capacity = battles > 0 ? (battles + perLine - 1) / perLine * perLine : perLine;
+    count = battles > 0 ? battles : 0;
+    storage.resize((size_t)BATTLE_ARRAYS * capacity, 0.0f);
+
+    float* next = storage.data();
+    for (int t = 0; t < UNIT_TYPES; t++) {
+        attackerUnits[t] = next; next += capacity;
+        defenderUnits[t] = next; next += capacity;
+        attackerStrength[t] = next; next += capacity;
+        defenderStrength[t] = next; next += capacity;
+    }
+    attackerMorale = next; next += capacity;
+    defenderMorale = next; next += capacity;
+    attackerSupply = next; next += capacity;
+    defenderSupply = next; next += capacity;
+    rounds = next;
+}
+
+void BattleBatch::setAttacker(int battle, const BattleSide& side, const float* strength) {
+    for (int t = 0; t < UNIT_TYPES; t++) {
+        attackerUnits[t][battle] = side.units[t];
+        attackerStrength[t][battle] = strength ? strength[t] : 1.0f;
+    }
+    attackerMorale[battle] = side.morale;
+    attackerSupply[battle] = side.foodSupply;
+    rounds[battle] = 0.0f;
+}
+
+void BattleBatch::setDefender(int battle, const BattleSide& side, const float* strength) {
+    for (int t = 0; t < UNIT_TYPES; t++) {
+        defenderUnits[t][battle] = side.units[t];
+        defenderStrength[t][battle] = strength ? strength[t] : 1.0f;
+    }
+    defenderMorale[battle] = side.morale;
+    defenderSupply[battle] = side.foodSupply;
+    rounds[battle] = 0.0f;
+}
+
+BattleSide BattleBatch::getAttacker(int battle) const {
+    BattleSide side;
+    for (int t = 0; t < UNIT_TYPES; t++) {
+        side.units[t] = attackerUnits[t][battle];
+    }
+    side.morale = attackerMorale[battle];
+    side.foodSupply = attackerSupply[battle];
+    return side;
+}
+
+BattleSide BattleBatch::getDefender(int battle) const {
+    BattleSide side;
+    for (int t = 0; t < UNIT_TYPES; t++) {
+        side.units[t] = defenderUnits[t][battle];
+    }
+    side.morale = defenderMorale[battle];
+    side.foodSupply = defenderSupply[battle];
+    return side;
+}
+
+// The side that still has troops, nerve and the larger remaining force wins
+bool BattleBatch::attackerWon(int battle) const {
+    float attackers = 0.0f, defenders = 0.0f;
+    for (int t = 0; t < UNIT_TYPES; t++) {
+        attackers += attackerUnits[t][battle];
+        defenders += defenderUnits[t][battle];
+    }
+    if (defenderMorale[battle] < ROUT_MORALE && attackerMorale[battle] >= ROUT_MORALE) return true;
+    if (attackerMorale[battle] < ROUT_MORALE) return false;
+    return attackers * attackerMorale[battle] > defenders * defenderMorale[battle];
+}
+
+// Combat modifier from morale (0.5x to 1.0x) and food supply (0.6x to 1.0x)
+static inline float combatModifier(float morale, float supply, float troops) {
+    float needed = troops * SUPPLY_PER_ROUND * BATTLE_MAX_ROUNDS + 1.0f;
+    float supplied = supply / needed;
+    supplied = supplied > 1.0f ? 1.0f : supplied;
+    return (0.5f + morale / 200.0f) * (0.6f + 0.4f * supplied);
+}
+
+// Integrate Lanchester square-law attrition for every battle in the batch.
+// Each round, every unit type of one side fires at the other side; the fire
+// is spread over the target's unit types in proportion to their head count
+// and scaled by the matchup table, strength factors, morale and supply.
+void BattleEngine::resolveBatch(BattleBatch& batch) {
+    for (int start = 0; start < batch.count; start += BATTLE_CHUNK) {
+        int end = start + BATTLE_CHUNK < batch.count ? start + BATTLE_CHUNK : batch.count;
+
+        for (int round = 0; round < BATTLE_MAX_ROUNDS; round++) {
+            float anyActive = 0.0f;
+
+            // Branch-free inner loop across battles (vectorizes)
+            for (int i = start; i < end; i++) {
+                float totalA = 0.0f, totalD = 0.0f;
+                for (int t = 0; t < UNIT_TYPES; t++) {
+                    totalA += batch.attackerUnits[t][i];
+                    totalD += batch.defenderUnits[t][i];
+                }
+
+                float active = (totalA > 0.5f && totalD > 0.5f &&
+                                batch.attackerMorale[i] >= ROUT_MORALE &&
+                                batch.defenderMorale[i] >= ROUT_MORALE) ? 1.0f : 0.0f;
+                anyActive += active;
+
+                float modA = combatModifier(batch.attackerMorale[i], batch.attackerSupply[i], totalA);
+                float modD = combatModifier(batch.defenderMorale[i], batch.defenderSupply[i], totalD);
+                float invA = 1.0f / (totalA > 1.0f ? totalA : 1.0f);
+                float invD = 1.0f / (totalD > 1.0f ? totalD : 1.0f);
+
+                float lossA[UNIT_TYPES], lossD[UNIT_TYPES];
+                for (int u = 0; u < UNIT_TYPES; u++) {
+                    float fireOnA = 0.0f, fireOnD = 0.0f;
+                    for (int t = 0; t < UNIT_TYPES; t++) {
+                        fireOnA += batch.defenderUnits[t][i] * batch.defenderStrength[t][i] * MATCHUP[t][u];
+                        fireOnD += batch.attackerUnits[t][i] * batch.attackerStrength[t][i] * MATCHUP[t][u];
+                    }
+                    lossA[u] = active * BATTLE_DT * modD * fireOnA * batch.attackerUnits[u][i] * invA;
+                    lossD[u] = active * BATTLE_DT * modA * fireOnD * batch.defenderUnits[u][i] * invD;
+                }
+
+                float casualtiesA = 0.0f, casualtiesD = 0.0f;
+                for (int u = 0; u < UNIT_TYPES; u++) {
+                    float a = batch.attackerUnits[u][i] - lossA[u];
+                    float d = batch.defenderUnits[u][i] - lossD[u];
+                    casualtiesA += batch.attackerUnits[u][i] - (a > 0.0f ? a : 0.0f);
+                    casualtiesD += batch.defenderUnits[u][i] - (d > 0.0f ? d : 0.0f);
+                    batch.attackerUnits[u][i] = a > 0.0f ? a : 0.0f;
+                    batch.defenderUnits[u][i] = d > 0.0f ? d : 0.0f;
+                }
+
+                // Casualties shake morale, every active round eats food
+                float moraleA = batch.attackerMorale[i] - MORALE_SHOCK * casualtiesA * invA;
+                float moraleD = batch.defenderMorale[i] - MORALE_SHOCK * casualtiesD * invD;
+                batch.attackerMorale[i] = moraleA > 0.0f ? moraleA : 0.0f;
+                batch.defenderMorale[i] = moraleD > 0.0f ? moraleD : 0.0f;
+
+                float supplyA = batch.attackerSupply[i] - active * totalA * SUPPLY_PER_ROUND;
+                float supplyD = batch.defenderSupply[i] - active * totalD * SUPPLY_PER_ROUND;
+                batch.attackerSupply[i] = supplyA > 0.0f ? supplyA : 0.0f;
+                batch.defenderSupply[i] = supplyD > 0.0f ? supplyD : 0.0f;
+
+                batch.rounds[i] += active;
+            }
+
+            // Stop early once every battle in this chunk has ended
+            if (anyActive == 0.0f) break;
+        }
+    }
+}
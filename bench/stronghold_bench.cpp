@@ -0,0 +1,554 @@
+#include "../Stronghold.h"
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+// Microbenchmarks for the hot operations of every subsystem.
+//
+//   stronghold_bench [--filter text] [--json results.json]
+//                    [--baseline bench/baseline.json] [--tolerance 0.50]
+//
+// Each benchmark runs with the game's console output muted and reports its
+// fastest of several batches. Results are printed as a table and optionally
+// written as JSON; with --baseline, any benchmark slower than
+// baseline * (1 + tolerance) fails the run.
+
+// Batches timed per benchmark; the fastest is reported, as the least disturbed
+static const int SAMPLES = 7;
+
+// A batch is grown until it runs at least this long
+static const double MIN_BATCH_SECONDS = 0.05;
+
+// Scratch files, removed when the suite finishes
+static const char* BENCH_SAVE_FILE = "bench_game_save.txt";
+static const char* BENCH_SCORE_FILE = "bench_score.txt";
+
+struct Benchmark {
+    string name;
+    function<void(long long iterations)> run;   // Performs `iterations` operations
+};
+
+struct BenchResult {
+    string name;
+    double nsPerOp;
+    long long iterations;
+};
+
+// Helper to answer the game's prompts from a script for the rest of a scope
+// (AIController::mobilizeArmy asks how many soldiers to recruit)
+class ScriptedInput {
+public:
+    ScriptedInput(int answer, long long times) : saved(&InputProvider::local()) {
+        for (long long i = 0; i < times; i++) {
+            script.add(answer);
+        }
+        InputProvider::setLocal(&script);
+    }
+    ~ScriptedInput() { InputProvider::setLocal(saved); }
+private:
+    ReplayInput script;
+    InputProvider* saved;
+};
+
+// Helper to time `iterations` operations in seconds
+static double timeBatch(const Benchmark& bench, long long iterations) {
+    MutedOutput muted;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    bench.run(iterations);
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Helper to calibrate a batch size and report the best time per operation
+static BenchResult measure(const Benchmark& bench) {
+    long long iterations = 1;
+    double seconds = timeBatch(bench, iterations);
+    while (seconds < MIN_BATCH_SECONDS && iterations < (1LL << 40)) {
+        double scale = seconds > 0.0 ? MIN_BATCH_SECONDS / seconds * 1.2 : 10.0;
+        if (scale > 10.0) scale = 10.0;
+        if (scale < 2.0) scale = 2.0;
+        iterations = (long long)(iterations * scale);
+        seconds = timeBatch(bench, iterations);
+    }
+
+    double samples[SAMPLES];
+    for (int s = 0; s < SAMPLES; s++) {
+        samples[s] = timeBatch(bench, iterations) * 1e9 / iterations;
+    }
+    sort(samples, samples + SAMPLES);
+
+    BenchResult result;
+    result.name = bench.name;
+    result.nsPerOp = samples[0];
+    result.iterations = iterations;
+    return result;
+}
+
+// Helper to render the four stat blocks case 10 prints, n times, in one
+// output mode; the rendered text is thrown away once drained
+static void renderStats(long long n, OutputMode mode, const Population& pop, const Army& army,
+                        const Economy& eco, const ResourceManager& res) {
+    OutputSink& sink = OutputSink::local();
+    OutputMode saved = sink.getMode();
+    streambuf* screen = cout.rdbuf(nullptr);
+    sink.setMode(mode);
+    for (long long i = 0; i < n; i++) {
+        pop.showStats();
+        army.showStats();
+        eco.showStats();
+        res.showStats();
+    }
+    sink.flush();
+    sink.setMode(saved);
+    cout.rdbuf(screen);
+}
+
+// ========== Benchmarks ==========
+
+static void addBenchmarks(vector<Benchmark>& benches) {
+    // Fresh game state; benchmarks that change state start from copies of it
+    static Population basePop;
+    static Army baseArmy;
+    static Economy baseEco;
+    static ResourceManager baseRes;
+
+    benches.push_back({ "population.simulate", [](long long n) {
+        for (long long i = 0; i < n; i++) {
+            Population pop = basePop;
+            pop.simulate();
+        }
+    } });
+
+    benches.push_back({ "economy.taxPopulation", [](long long n) {
+        for (long long i = 0; i < n; i++) {
+            Economy eco = baseEco;
+            eco.taxPopulation(basePop);
+        }
+    } });
+
+    // Amortized over a tracker's first 1024 snapshots, growth included
+    benches.push_back({ "history.takeSnapshot", [](long long n) {
+        HistoryTracker* tracker = new HistoryTracker();
+        for (long long i = 0; i < n; i++) {
+            if (i % 1024 == 1023) {
+                delete tracker;
+                tracker = new HistoryTracker();
+            }
+            tracker->takeSnapshot(basePop, baseEco, baseArmy, baseRes, "Benchmark turn");
+        }
+        delete tracker;
+    } });
+
+    // One tracker grown from empty to 10240 snapshots
+    benches.push_back({ "history.growTo10240", [](long long n) {
+        for (long long i = 0; i < n; i++) {
+            HistoryTracker tracker;
+            for (int s = 0; s < 10240; s++) {
+                tracker.takeSnapshot(basePop, baseEco, baseArmy, baseRes);
+            }
+        }
+    } });
+
+    benches.push_back({ "saver.logEvent", [](long long n) {
+        GameSaver saver(BENCH_SAVE_FILE, BENCH_SCORE_FILE);
+        for (long long i = 0; i < n; i++) {
+            saver.logEvent("BENCH", "Benchmark event");
+        }
+    } });
+
+    // What the game thread pays: capture and hand-off only
+    benches.push_back({ "saver.saveGame", [](long long n) {
+        GameSaver saver(BENCH_SAVE_FILE, BENCH_SCORE_FILE);
+        Bank bank;
+        for (long long i = 0; i < n; i++) {
+            saver.saveGame(basePop, baseArmy, baseEco, baseRes, bank);
+        }
+        saver.waitForSaves();
+    } });
+
+    // A save that is on disk (fsync and rename) before the next one starts
+    benches.push_back({ "saver.saveGame_durable", [](long long n) {
+        GameSaver saver(BENCH_SAVE_FILE, BENCH_SCORE_FILE);
+        Bank bank;
+        for (long long i = 0; i < n; i++) {
+            saver.saveGame(basePop, baseArmy, baseEco, baseRes, bank);
+            saver.waitForSaves();
+        }
+    } });
+
+    benches.push_back({ "saver.loadGame", [](long long n) {
+        GameSaver saver(BENCH_SAVE_FILE, BENCH_SCORE_FILE);
+        Population pop;
+        Army army;
+        Economy eco;
+        ResourceManager res;
+        Bank bank;
+        saver.saveGame(pop, army, eco, res, bank);
+        for (long long i = 0; i < n; i++) {
+            saver.loadGame(pop, army, eco, res, bank);
+        }
+    } });
+
+    benches.push_back({ "ai.makeTaxDecision", [](long long n) {
+        AIController ai;
+        for (long long i = 0; i < n; i++) {
+            Economy eco = baseEco;
+            Population pop = basePop;
+            ai.makeTaxDecision(eco, pop);
+            TurnArena::local().reset(); // As the end of a turn does
+        }
+    } });
+
+    benches.push_back({ "ai.mobilizeArmy", [](long long n) {
+        AIController ai;
+        ScriptedInput recruits(5, n);
+        for (long long i = 0; i < n; i++) {
+            Army army = baseArmy;
+            Population pop = basePop;
+            ResourceManager res = baseRes;
+            ai.mobilizeArmy(army, pop, res);
+            TurnArena::local().reset(); // As the end of a turn does
+        }
+    } });
+
+    // Mobilize and march to a rally point across a 128x128 map (cached flow field)
+    benches.push_back({ "ai.mobilizeArmy_march", [](long long n) {
+        WorldMap map(128, 128);
+        PathfindingService paths(map);
+        AIController ai;
+        ScriptedInput recruits(5, n);
+        for (long long i = 0; i < n; i++) {
+            Army army = baseArmy;
+            Population pop = basePop;
+            ResourceManager res = baseRes;
+            ai.mobilizeArmy(army, pop, res, paths, 100, 100);
+            TurnArena::local().reset(); // As the end of a turn does
+        }
+    } });
+
+    benches.push_back({ "ai.handleInternalConflict", [](long long n) {
+        AIController ai;
+        for (long long i = 0; i < n; i++) {
+            Population pop = basePop;
+            Army army = baseArmy;
+            Economy eco = baseEco;
+            ai.handleInternalConflict(pop, army, eco);
+            TurnArena::local().reset(); // As the end of a turn does
+        }
+    } });
+
+    // Border changes on a crowded map: each move leaves one cell's member list for another
+    benches.push_back({ "world.moveKingdom_10000", [](long long n) {
+        static WorldMap map(1024, 1024);
+        static bool ready = false;
+        uint32_t state = 12345;
+        auto next = [&]() { state = state * 1664525u + 1013904223u; return (int)(state >> 22); };
+        if (!ready) {
+            for (int k = 0; k < 10000; k++) map.addKingdom(next(), next());
+            ready = true;
+        }
+        for (long long i = 0; i < n; i++) {
+            map.moveKingdom((int)(i % 10000), next(), next());
+        }
+    } });
+
+    // Larger-scale kernels, per batch
+    benches.push_back({ "battle.resolveBatch_1024", [](long long n) {
+        BattleBatch batch(1024);
+        BattleSide attacker = baseArmy.toBattleSide();
+        BattleSide defender = baseArmy.toBattleSide();
+        defender.morale = 50.0f;
+        for (long long i = 0; i < n; i++) {
+            for (int b = 0; b < 1024; b++) {
+                batch.setAttacker(b, attacker, nullptr);
+                batch.setDefender(b, defender, nullptr);
+            }
+            BattleEngine::resolveBatch(batch);
+        }
+    } });
+
+    benches.push_back({ "cohort.projectBatch_1024", [](long long n) {
+        vector<float> start(1024 * COHORT_SIZE, 10.0f);
+        vector<float> states;
+        vector<int> conditions(1024);
+        for (int k = 0; k < 1024; k++) {
+            conditions[k] = k % COHORT_CONDITIONS;
+        }
+        for (long long i = 0; i < n; i++) {
+            states = start; // Projecting the same states forever drifts into denormals
+            CohortModel::shared().projectBatch(conditions.data(), states.data(), 1024);
+        }
+    } });
+
+    benches.push_back({ "market.clear_10000", [](long long n) {
+        TradeMarket market(10000, 16, 1);
+        for (long long i = 0; i < n; i++) {
+            for (int k = 0; k < 10000; k++) {
+                market.setRegion(k, k % 16);
+                market.postOrders(k, baseRes, basePop, baseArmy, baseEco);
+            }
+            market.clear();
+        }
+    } });
+
+    benches.push_back({ "metrics.count", [](long long n) {
+        Metrics::setEnabled(true);
+        for (long long i = 0; i < n; i++) {
+            Metrics::count(METRIC_RESOURCE_CHANGES);
+        }
+        Metrics::setEnabled(false);
+    } });
+
+    benches.push_back({ "metrics.recordLatency", [](long long n) {
+        Metrics::setEnabled(true);
+        for (long long i = 0; i < n; i++) {
+            Metrics::recordLatency(PHASE_BANK, (unsigned long long)(i & 0xFFFFF));
+        }
+        Metrics::setEnabled(false);
+    } });
+
+    benches.push_back({ "metrics.scopedLatency", [](long long n) {
+        Metrics::setEnabled(true);
+        for (long long i = 0; i < n; i++) {
+            ScopedLatency timing(PHASE_BANK);
+        }
+        Metrics::setEnabled(false);
+    } });
+
+    benches.push_back({ "output.showStats_buffered", [](long long n) {
+        renderStats(n, OUTPUT_BUFFERED, basePop, baseArmy, baseEco, baseRes);
+    } });
+
+    benches.push_back({ "output.showStats_diff", [](long long n) {
+        renderStats(n, OUTPUT_DIFF, basePop, baseArmy, baseEco, baseRes);
+    } });
+
+    benches.push_back({ "trace.span_disabled", [](long long n) {
+        for (long long i = 0; i < n; i++) {
+            ScopedTrace span("bench");
+        }
+    } });
+
+    benches.push_back({ "scenario.parse_10000", [](long long n) {
+        string text;
+        KingdomRecord record;
+        basePop.exportState(record);
+        baseArmy.exportState(record);
+        baseEco.exportState(record);
+        baseRes.exportState(record);
+        Bank bank;
+        vector<LoanRecord> loans;
+        bank.exportState(record, loans);
+        for (int k = 0; k < 10000; k++) {
+            appendKingdomText(text, k, record, nullptr, 0);
+        }
+
+        ScenarioLoader loader(1);
+        KingdomTable table;
+        for (long long i = 0; i < n; i++) {
+            loader.parse(text.data(), text.size(), table);
+        }
+    } });
+
+    // What-if branch of a 100000-kingdom world that changes one kingdom
+    benches.push_back({ "world.forkEdit_100000", [](long long n) {
+        static KingdomTable world;
+        if (world.getKingdomCount() == 0) world.reset(100000);
+        for (long long i = 0; i < n; i++) {
+            KingdomTable branch = world;
+            branch.get((int)(i % 100000)).treasury += 100;
+        }
+    } });
+
+    // Delta frame for a 100000-kingdom world where 1% of kingdoms changed
+    benches.push_back({ "replication.encodeDelta_100000_1pct", [](long long n) {
+        static KingdomTable base;
+        static KingdomTable world;
+        if (base.getKingdomCount() == 0) {
+            base.reset(100000);
+            world = base;
+            for (int k = 0; k < 100000; k += 100) world.get(k).treasury += 100;
+        }
+        string frame;
+        for (long long i = 0; i < n; i++) {
+            frame.clear();
+            appendReplicationFrame(frame, REPLICATION_DELTA, 2, 1, 1, base.getRecords(), world.getRecords());
+        }
+    } });
+
+    // Scheduling cost of a turn-shaped graph of empty phases: a chain of
+    // seven, then a fork of three with one pinned to the caller
+    auto turnShape = [](TaskExecutor* executor, long long n) {
+        for (long long i = 0; i < n; i++) {
+            TaskGraph graph;
+            int last = -1;
+            for (int p = 0; p < 7; p++) {
+                last = graph.add("bench.chain", 1, 2, last < 0 ? 0 : 1ULL << last, []() {});
+            }
+            int history = last;
+            graph.add("bench.metrics", 1, 4, 1ULL << (history - 1), []() {});
+            graph.add("bench.keyframe", 1, 8 | 16, 1ULL << history, []() {});
+            graph.add("bench.publish", 1, 32, 1ULL << history, []() {});
+            graph.setCallerOnly(16);
+            graph.run(executor);
+        }
+    };
+    benches.push_back({ "taskGraph.turnShape_inOrder", [turnShape](long long n) {
+        turnShape(nullptr, n);
+    } });
+    benches.push_back({ "taskGraph.turnShape_executor", [turnShape](long long n) {
+        static TaskExecutor executor(2);
+        turnShape(&executor, n);
+    } });
+
+    // Menu thread to rival worker and back, without the other thread
+    benches.push_back({ "rivals.queuePushPop", [](long long n) {
+        static SpscQueue<RivalCommand> queue(64);
+        RivalCommand command = { RIVAL_SNAPSHOT, 0 };
+        for (long long i = 0; i < n; i++) {
+            command.request = (uint32_t)i;
+            queue.push(command);
+            queue.pop(command);
+        }
+    } });
+
+#ifndef _WIN32
+    // A monitor reading one kingdom out of shared memory
+    benches.push_back({ "liveState.readKingdom", [](long long n) {
+        static LiveStateWriter writer;
+        static LiveStateReader reader;
+        static bool ready = false;
+        if (!ready) {
+            string name = "/stronghold_bench_" + to_string(getpid());
+            KingdomRecord records[16];
+            memset(records, 0, sizeof(records));
+            ready = writer.open(name, 16);
+            writer.publish(1, records, 16);
+            ready = ready && reader.open(name);
+        }
+        KingdomRecord record;
+        uint32_t turn;
+        for (long long i = 0; i < n; i++) {
+            reader.readKingdom((int)(i & 15), record, turn);
+        }
+    } });
+#endif
+}
+
+// ========== Reporting ==========
+
+static void writeJson(const vector<BenchResult>& results, ostream& out) {
+    out << "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        char line[256];
+        snprintf(line, sizeof(line), "    { \"name\": \"%s\", \"ns_per_op\": %.1f, \"iterations\": %lld }%s\n",
+                 results[i].name.c_str(), results[i].nsPerOp, results[i].iterations,
+                 i + 1 < results.size() ? "," : "");
+        out << line;
+    }
+    out << "  ]\n}\n";
+}
+
+// Helper to read the name/ns_per_op pairs back from a results file
+static bool readBaseline(const string& path, vector<BenchResult>& baseline) {
+    ifstream in(path);
+    if (!in) return false;
+    stringstream buffer;
+    buffer << in.rdbuf();
+    string text = buffer.str();
+
+    size_t at = 0;
+    while ((at = text.find("\"name\"", at)) != string::npos) {
+        size_t open = text.find('"', text.find(':', at) + 1);
+        size_t close = text.find('"', open + 1);
+        size_t value = text.find("\"ns_per_op\"", close);
+        if (open == string::npos || close == string::npos || value == string::npos) break;
+
+        BenchResult entry;
+        entry.name = text.substr(open + 1, close - open - 1);
+        entry.nsPerOp = atof(text.c_str() + text.find(':', value) + 1);
+        entry.iterations = 0;
+        baseline.push_back(entry);
+        at = value;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    string filter, jsonPath, baselinePath;
+    double tolerance = 0.50;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        if (arg == "--filter") filter = argv[i + 1];
+        else if (arg == "--json") jsonPath = argv[i + 1];
+        else if (arg == "--baseline") baselinePath = argv[i + 1];
+        else if (arg == "--tolerance") tolerance = atof(argv[i + 1]);
+        else {
+            cerr << "Usage: stronghold_bench [--filter text] [--json file] [--baseline file] [--tolerance 0.50]\n";
+            return 1;
+        }
+    }
+
+    // Nothing may wait on the terminal; unscripted prompts find no answers
+    ReplayInput noInput;
+    InputProvider::setLocal(&noInput);
+
+    vector<Benchmark> benches;
+    addBenchmarks(benches);
+
+    vector<BenchResult> baseline;
+    if (!baselinePath.empty() && !readBaseline(baselinePath, baseline)) {
+        cerr << "Error: Could not read baseline " << baselinePath << ".\n";
+        return 1;
+    }
+
+    vector<BenchResult> results;
+    int regressions = 0;
+    printf("%-44s %14s %12s  %s\n", "benchmark", "ns/op", "iterations", baseline.empty() ? "" : "vs baseline");
+    for (size_t b = 0; b < benches.size(); b++) {
+        if (!filter.empty() && benches[b].name.find(filter) == string::npos) continue;
+
+        BenchResult result = measure(benches[b]);
+        results.push_back(result);
+
+        string verdict;
+        for (size_t i = 0; i < baseline.size(); i++) {
+            if (baseline[i].name != result.name || baseline[i].nsPerOp <= 0.0) continue;
+            double ratio = result.nsPerOp / baseline[i].nsPerOp;
+            char text[64];
+            snprintf(text, sizeof(text), "%+.0f%%", (ratio - 1.0) * 100.0);
+            verdict = text;
+            if (ratio > 1.0 + tolerance) {
+                verdict += " REGRESSION";
+                regressions++;
+            }
+        }
+        if (!baseline.empty() && verdict.empty()) verdict = "new";
+        printf("%-44s %14.1f %12lld  %s\n", result.name.c_str(), result.nsPerOp, result.iterations, verdict.c_str());
+        fflush(stdout);
+    }
+
+    remove(BENCH_SAVE_FILE);
+    remove(BENCH_SCORE_FILE);
+
+    if (!jsonPath.empty()) {
+        ofstream out(jsonPath);
+        if (!out) {
+            cerr << "Error: Could not write " << jsonPath << ".\n";
+            return 1;
+        }
+        writeJson(results, out);
+    }
+
+    if (regressions > 0) {
+        printf("%d benchmark(s) regressed by more than %.0f%%\n", regressions, tolerance * 100.0);
+        return 1;
+    }
+    return 0;
+}
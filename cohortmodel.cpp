@@ -0,0 +1,189 @@
+#include "Stronghold.h"
+
+// Base per-turn rates for each age bucket (0-9, 10-19, 20-34, 35-49, 50-64, 65+)
+static const float BASE_FERTILITY[COHORT_AGE_BUCKETS] = { 0.0f, 0.02f, 0.22f, 0.10f, 0.01f, 0.0f };
+static const float BASE_SURVIVAL[COHORT_AGE_BUCKETS]  = { 0.99f, 0.995f, 0.995f, 0.99f, 0.97f, 0.85f };
+static const float AGEING_RATE[COHORT_AGE_BUCKETS]    = { 0.1f, 0.1f, 0.0667f, 0.0667f, 0.0667f, 0.0f };
+
+// Only adults (20+) move between social classes
+static const int FIRST_ADULT_BUCKET = 2;
+
+// Constructor precomputes one projection matrix per food/happiness condition
+CohortModel::CohortModel() {
+    projections.resize(COHORT_CONDITIONS * COHORT_SIZE * COHORT_SIZE);
+    for (int f = 0; f < COHORT_FOOD_LEVELS; f++) {
+        for (int h = 0; h < COHORT_HAPPINESS_LEVELS; h++) {
+            int condition = f * COHORT_HAPPINESS_LEVELS + h;
+            buildProjection(f, h, projections.data() + condition * COHORT_SIZE * COHORT_SIZE);
+        }
+    }
+}
+
+// Model shared by every Population in the process
+const CohortModel& CohortModel::shared() {
+    static const CohortModel model;
+    return model;
+}
+
+// Map a food ratio (available / required) and happiness (0-100) to a condition
+int CohortModel::conditionIndex(float foodRatio, float happiness) {
+    // Food levels step by 0.2: 0.0, 0.2, ... 1.4 (anything above counts as 1.4)
+    int foodLevel = (int)(foodRatio * 5.0f + 0.5f);
+    if (foodLevel < 0) foodLevel = 0;
+    if (foodLevel >= COHORT_FOOD_LEVELS) foodLevel = COHORT_FOOD_LEVELS - 1;
+
+    // Happiness levels step by 10 points
+    int happinessLevel = (int)(happiness / 10.0f + 0.5f);
+    if (happinessLevel < 0) happinessLevel = 0;
+    if (happinessLevel >= COHORT_HAPPINESS_LEVELS) happinessLevel = COHORT_HAPPINESS_LEVELS - 1;
+
+    return foodLevel * COHORT_HAPPINESS_LEVELS + happinessLevel;
+}
+
+// Helper method to fill the matrix for one food/happiness condition
+void CohortModel::buildProjection(int foodLevel, int happinessLevel, float* matrix) const {
+    float fed = foodLevel * 0.2f;
+    if (fed > 1.0f) fed = 1.0f;
+    float mood = happinessLevel / 10.0f;
+
+    // Starvation lowers survival, hunger and unhappiness lower fertility
+    float survivalModifier = 1.0f - 0.5f * (1.0f - fed);
+    float fertilityModifier = fed * (0.5f + mood);
+
+    // Happy kingdoms let people climb the social ladder, unhappy ones push them down
+    float up = 0.005f + 0.01f * mood;
+    float down = 0.005f + 0.01f * (1.0f - mood);
+    float mobility[COHORT_CLASSES][COHORT_CLASSES] = {
+        { 1.0f - up,  up,                        0.0f        },
+        { down,       1.0f - down - up * 0.5f,   up * 0.5f   },
+        { 0.0f,       down,                      1.0f - down }
+    };
+
+    for (int i = 0; i < COHORT_SIZE * COHORT_SIZE; i++) {
+        matrix[i] = 0.0f;
+    }
+
+    for (int age = 0; age < COHORT_AGE_BUCKETS; age++) {
+        float survival = BASE_SURVIVAL[age] * survivalModifier;
+        bool lastBucket = age == COHORT_AGE_BUCKETS - 1;
+        float moving = lastBucket ? 0.0f : survival * AGEING_RATE[age];
+        float staying = survival - moving;
+
+        for (int cls = 0; cls < COHORT_CLASSES; cls++) {
+            int from = age * COHORT_CLASSES + cls;
+
+            // Survivors either stay in their age bucket or move up one
+            int targetAges[2] = { age, age + 1 };
+            float weights[2] = { staying, moving };
+            for (int t = 0; t < 2; t++) {
+                if (weights[t] == 0.0f) continue;
+                int targetAge = targetAges[t];
+                if (targetAge >= FIRST_ADULT_BUCKET) {
+                    for (int toClass = 0; toClass < COHORT_CLASSES; toClass++) {
+                        int to = targetAge * COHORT_CLASSES + toClass;
+                        matrix[to * COHORT_SIZE + from] += weights[t] * mobility[cls][toClass];
+                    }
+                } else {
+                    int to = targetAge * COHORT_CLASSES + cls;
+                    matrix[to * COHORT_SIZE + from] += weights[t];
+                }
+            }
+
+            // Newborns join the youngest bucket of their parents' class
+            matrix[cls * COHORT_SIZE + from] += BASE_FERTILITY[age] * fertilityModifier;
+        }
+    }
+}
+
+// Advance `count` contiguous state vectors that share one condition (in-place allowed)
+void CohortModel::projectBlock(int condition, const float* in, float* out, int count) const {
+    const float* matrix = projections.data() + condition * COHORT_SIZE * COHORT_SIZE;
+
+    // Kingdoms are transposed into small column blocks so the inner loop runs
+    // across kingdoms and the whole working set stays in L1
+    float blockIn[COHORT_SIZE][COHORT_BLOCK];
+    float blockOut[COHORT_SIZE][COHORT_BLOCK];
+
+    for (int start = 0; start < count; start += COHORT_BLOCK) {
+        int n = count - start < COHORT_BLOCK ? count - start : COHORT_BLOCK;
+
+        for (int k = 0; k < n; k++) {
+            const float* state = in + (start + k) * COHORT_SIZE;
+            for (int j = 0; j < COHORT_SIZE; j++) {
+                blockIn[j][k] = state[j];
+            }
+        }
+
+        for (int i = 0; i < COHORT_SIZE; i++) {
+            for (int k = 0; k < n; k++) {
+                blockOut[i][k] = 0.0f;
+            }
+            const float* row = matrix + i * COHORT_SIZE;
+            for (int j = 0; j < COHORT_SIZE; j++) {
+                float m = row[j];
+                if (m == 0.0f) continue; // Leslie matrices are mostly zeros
+                for (int k = 0; k < n; k++) {
+                    blockOut[i][k] += m * blockIn[j][k];
+                }
+            }
+        }
+
+        for (int k = 0; k < n; k++) {
+            float* state = out + (start + k) * COHORT_SIZE;
+            for (int i = 0; i < COHORT_SIZE; i++) {
+                state[i] = blockOut[i][k];
+            }
+        }
+    }
+}
+
+// Advance a batch of kingdoms with mixed conditions, in place
+void CohortModel::projectBatch(const int* conditions, float* states, int count) const {
+    if (count <= 0) return;
+
+    // Counting sort kingdoms by condition so each group runs through one matrix
+    int groupStart[COHORT_CONDITIONS + 1];
+    for (int c = 0; c <= COHORT_CONDITIONS; c++) {
+        groupStart[c] = 0;
+    }
+    for (int k = 0; k < count; k++) {
+        groupStart[conditions[k] + 1]++;
+    }
+    for (int c = 0; c < COHORT_CONDITIONS; c++) {
+        groupStart[c + 1] += groupStart[c];
+    }
+
+    SmallVector<int, COHORT_BLOCK> order;
+    order.resizeForOverwrite(count);
+    int fill[COHORT_CONDITIONS];
+    for (int c = 0; c < COHORT_CONDITIONS; c++) {
+        fill[c] = groupStart[c];
+    }
+    for (int k = 0; k < count; k++) {
+        order[fill[conditions[k]]++] = k;
+    }
+
+    // Gather, project each group, scatter back
+    SmallVector<float, 0, SIMD_ALIGN> grouped;
+    grouped.resizeForOverwrite((size_t)count * COHORT_SIZE);
+    for (int g = 0; g < count; g++) {
+        const float* src = states + order[g] * COHORT_SIZE;
+        for (int j = 0; j < COHORT_SIZE; j++) {
+            grouped[g * COHORT_SIZE + j] = src[j];
+        }
+    }
+
+    for (int c = 0; c < COHORT_CONDITIONS; c++) {
+        int n = groupStart[c + 1] - groupStart[c];
+        if (n == 0) continue;
+        float* group = grouped.data() + groupStart[c] * COHORT_SIZE;
+        projectBlock(c, group, group, n);
+    }
+
+    for (int g = 0; g < count; g++) {
+        float* dst = states + order[g] * COHORT_SIZE;
+        for (int j = 0; j < COHORT_SIZE; j++) {
+            dst[j] = grouped[g * COHORT_SIZE + j];
+        }
+    }
+}
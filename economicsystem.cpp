@@ -5,21 +5,38 @@ Economy::Economy() {
     treasury = 1000;
     taxRate = 5;          // Integer-based percentage
     inflation = 100;      // Represented as a multiplier: 100 = 1.00, 105 = 1.05
+    monitor = nullptr;
+    monitorKingdom = 0;
+}
+
+// Connect a treasury monitor that sees every transaction
+void Economy::attachMonitor(TreasuryMonitor* detector, int kingdom) {
+    monitor = detector;
+    monitorKingdom = kingdom;
+    recordTransaction(0); // Baseline observation
+}
+
+// Helper method to report a treasury change to the monitor
+void Economy::recordTransaction(int spent) {
+    if (monitor) {
+        monitor->observe(monitorKingdom, treasury, spent);
+    }
 }
 
 // Collect taxes based on population and inflation
 void Economy::taxPopulation(const Population& pop) {
-    cout << "\n--- Tax Collection ---\n";
+    console() << "\n--- Tax Collection ---\n";
 
     int populationSize = pop.getTotal();
     int baseCollection = (populationSize * taxRate) / 100;
     int adjustedCollection = (baseCollection * inflation) / 100;
 
     treasury += adjustedCollection;
+    recordTransaction(0);
 
-    cout << "Taxed " << populationSize << " people at " << taxRate << "% rate.\n";
-    cout << "Collected: " << adjustedCollection << " gold\n";
-    cout << "New Treasury: " << treasury << " gold\n";
+    console() << "Taxed " << populationSize << " people at " << taxRate << "% rate.\n";
+    console() << "Collected: " << adjustedCollection << " gold\n";
+    console() << "New Treasury: " << treasury << " gold\n";
 
     // Simulate inflation increasing gradually
     inflation += 5;
@@ -28,35 +45,37 @@ void Economy::taxPopulation(const Population& pop) {
 
 // Spend gold from treasury
 void Economy::spend(int amount) {
-    cout << "\n--- Spending Gold ---\n";
+    console() << "\n--- Spending Gold ---\n";
 
     if (amount <= 0) {
-        cout << "Invalid amount. Must be greater than 0.\n";
+        console() << "Invalid amount. Must be greater than 0.\n";
         return;
     }
 
     if (amount > treasury) {
-        cout << "Insufficient treasury. Available: " << treasury << " gold.\n";
+        console() << "Insufficient treasury. Available: " << treasury << " gold.\n";
         return;
     }
 
     treasury -= amount;
-    cout << "Spent: " << amount << " gold. Remaining Treasury: " << treasury << " gold\n";
+    recordTransaction(amount);
+    console() << "Spent: " << amount << " gold. Remaining Treasury: " << treasury << " gold\n";
 }
 
 // Show current economic status
 void Economy::showStats() const {
-    cout << "\n====== Economy Stats ======\n";
-    cout << "Treasury: " << treasury << " gold\n";
-    cout << "Tax Rate: " << taxRate << "%\n";
-    cout << "Inflation: " << inflation << " (x" << inflation / 100.0 << ")\n";
+    OutputSink& sink = OutputSink::local();
+    sink.section("Economy Stats", this);
+    sink.field("Treasury", treasury, " gold");
+    sink.field("Tax Rate", taxRate, "%");
+    sink.field("Inflation", inflation, " (x", inflation / 100.0, ")");
 }
 
 // Save economic state to file
 void Economy::saveToFile() const {
     ofstream out("economy.txt");
     if (!out) {
-        cout << "Error: Unable to open file for saving economy.\n";
+        console() << "Error: Unable to open file for saving economy.\n";
         return;
     }
 
@@ -65,21 +84,21 @@ void Economy::saveToFile() const {
     out << inflation << endl;
     out.close();
 
-    cout << "Economy saved to file.\n";
+    console() << "Economy saved to file.\n";
 }
 
 // Load economic state from file
 void Economy::loadFromFile() {
     ifstream in("economy.txt");
     if (!in) {
-        cout << "Error: Unable to open file for loading economy.\n";
+        console() << "Error: Unable to open file for loading economy.\n";
         return;
     }
 
     in >> treasury >> taxRate >> inflation;
     in.close();
 
-    cout << "Economy loaded from file.\n";
+    console() << "Economy loaded from file.\n";
 }
 
 // Getter for treasury value
@@ -88,5 +107,31 @@ int Economy::getTreasury() const {
 }
 void Economy::receiveLoan(int amount) {
     treasury += amount;
+    recordTransaction(0);
+}
+
+// Apply the net gold of this turn's market trades
+void Economy::settleTrade(int gold) {
+    treasury += gold;
+    if (treasury < 0) treasury = 0;
+    recordTransaction(gold < 0 ? -gold : 0);
+}
+
+// Copy the economy state into a snapshot record
+void Economy::exportState(KingdomRecord& record) const {
+    record.treasury = treasury;
+    record.taxRate = taxRate;
+    record.inflation = inflation;
 }
 
+// Restore the economy state from a snapshot record
+void Economy::importState(const KingdomRecord& record) {
+    treasury = record.treasury;
+    taxRate = record.taxRate;
+    inflation = record.inflation;
+
+    // A loaded treasury is a new baseline, not a transaction
+    if (monitor) {
+        monitor->resetBaseline(monitorKingdom, treasury);
+    }
+}
@@ -7,15 +7,20 @@ EventManager::EventManager() {
 
 // Trigger an event manually chosen by the user
 void EventManager::trigger(Population& pop, Army& army, Economy& eco, ResourceManager& res) {
-    cout << "\nEvent Trigger Menu\n";
-    cout << "Choose an event to trigger:\n";
-    cout << "1. Famine\n";
-    cout << "2. Disease Outbreak\n";
-    cout << "3. War Attack\n";
-    cout << "4. Betrayal by Nobles\n";
-    cout << "5. Earthquake (Stone Loss)\n";
-    int choice;
-    cin >> choice;
+    ScopedLatency timing(PHASE_EVENT);
+    ScopedTrace span("event");
+    InputProvider& input = InputProvider::local();
+    if (input.showsPrompts()) {
+        console() << "\nEvent Trigger Menu\n";
+        console() << "Choose an event to trigger:\n";
+        console() << "1. Famine\n";
+        console() << "2. Disease Outbreak\n";
+        console() << "3. War Attack\n";
+        console() << "4. Betrayal by Nobles\n";
+        console() << "5. Earthquake (Stone Loss)\n";
+    }
+    int choice = 0;
+    input.readInt(nullptr, choice);
 
     if (choice == 1) {
         famine(res, pop);
@@ -28,35 +33,68 @@ void EventManager::trigger(Population& pop, Army& army, Economy& eco, ResourceMa
     } else if (choice == 5) {
         earthquake(res);
     } else {
-        cout << "Invalid choice.\n";
+        console() << "Invalid choice.\n";
     }
 }
 
 // ========== Event Implementations ==========
 
 void EventManager::famine(ResourceManager& res, Population& pop) {
-    cout << "Famine hits the land! Food reduced by 100.\n";
+    console() << "Famine hits the land! Food reduced by 100.\n";
+    Metrics::count(METRIC_EVENTS_FIRED);
     res.consumeFixed("food", 100);
     pop.decrease(10);
 }
 
 void EventManager::disease(Population& pop) {
-    cout << "A deadly disease spreads! 15 people lost.\n";
+    console() << "A deadly disease spreads! 15 people lost.\n";
+    Metrics::count(METRIC_EVENTS_FIRED);
     pop.decrease(15);
 }
 
 void EventManager::war(Army& army, Economy& eco) {
-    cout << "War erupts! Army loses morale and treasury suffers.\n";
-    army.lowerMorale(20);
+    console() << "War erupts! An invading army marches on the kingdom.\n";
+    Metrics::count(METRIC_EVENTS_FIRED);
+
+    // Invaders are roughly a match for the defending army
+    BattleSide defenders = army.toBattleSide();
+    BattleSide invaders = defenders;
+    float invaderScale = (80 + GameRandom::local().nextInt(41)) / 100.0f;
+    for (int t = 0; t < UNIT_TYPES; t++) {
+        invaders.units[t] *= invaderScale;
+    }
+    invaders.morale = (float)(60 + GameRandom::local().nextInt(31));
+    invaders.foodSupply = 100.0f;
+
+    BattleBatch battle(1);
+    // Invaders fight at baseline strength; the defenders bring their training
+    battle.setAttacker(0, invaders, nullptr);
+    battle.setDefender(0, defenders, army.getUnitStrength());
+    BattleEngine::resolveBatch(battle);
+
+    BattleSide survivors = battle.getDefender(0);
+    bool repelled = !battle.attackerWon(0);
+    if (repelled) {
+        survivors.morale += 10;
+    } else {
+        survivors.morale -= 20;
+    }
+    army.applyBattleResult(survivors);
+
+    console() << "Battle lasted " << (int)battle.rounds[0] << " rounds. "
+         << (repelled ? "The invaders were repelled!\n" : "The army was defeated!\n");
+    console() << "Soldiers remaining: " << army.getSoldiers() << ", morale: " << army.getMorale() << "%\n";
     eco.spend(200);
 }
 
 void EventManager::betrayal(Economy& eco) {
-    cout << "Noble betrayal! 300 gold stolen from treasury.\n";
+    console() << "Noble betrayal! 300 gold stolen from treasury.\n";
+    Metrics::count(METRIC_EVENTS_FIRED);
     eco.spend(300);
 }
 
 void EventManager::earthquake(ResourceManager& res) {
-    cout << "Earthquake shakes the kingdom! Stone supply drops.\n";
+    console() << "Earthquake shakes the kingdom! Stone supply drops.\n";
+    Metrics::count(METRIC_EVENTS_FIRED);
     res.consumeFixed("stone", 50);
 }
@@ -0,0 +1,412 @@
+#include "Stronghold.h"
+#include <cstring>
+
+// Constructor sets up a fresh kingdom and restarts the thread's random stream
+StrongholdGame::StrongholdGame(uint64_t seed, const string& saveFile, const string& scoreFile)
+    : saver(saveFile, scoreFile) {
+    leader = new King();  // Polymorphic leader
+    bank.watch(economy);  // Stream every transaction to the bank's treasury monitor
+    running = true;
+    publisher = nullptr;
+    liveState = nullptr;
+    rivals = nullptr;
+    rivalThreads = RIVAL_DEFAULT_THREADS;
+    turnExecutor = nullptr;
+    GameRandom::local().seed(seed);
+
+    GameKeyframe start;
+    captureKeyframe(start);
+    timeline.push_back(start);
+}
+
+// Destructor frees the leader and the turn's sinks, and stops the rivals
+StrongholdGame::~StrongholdGame() {
+    delete leader;
+    delete rivals;
+    for (size_t i = 0; i < turnOutput.size(); i++) {
+        delete turnOutput[i];
+    }
+}
+
+void StrongholdGame::setMetricsPath(const string& path) {
+    metricsPath = path;
+}
+
+int StrongholdGame::getTurn() const {
+    return history.getCurrentTurn();
+}
+
+bool StrongholdGame::isRunning() const {
+    return running;
+}
+
+// Show every subsystem's stats
+void StrongholdGame::showOverview() const {
+    population.showStats();
+    army.showStats();
+    economy.showStats();
+    resources.showStats();
+    bank.showStats();
+}
+
+// Play until the player exits or input runs out
+void StrongholdGame::play(InputProvider& input) {
+    while (playChoice(input)) {
+    }
+}
+
+bool StrongholdGame::playChoice(InputProvider& input) {
+    if (!running) return false;
+
+    if (input.showsPrompts()) {
+        console() << "\n================ STRONGHOLD MENU ================\n";
+        console() << "1. View Kingdom Overview\n";
+        console() << "2. Simulate Population Changes\n";
+        console() << "3. Recruit and Train Army\n";
+        console() << "4. Manage Economy (Taxation, Treasury)\n";
+        console() << "5. Handle Resource Operations\n";
+        console() << "6. Trigger Random Event\n";
+        console() << "7. Save Game to File\n";
+        console() << "8. Load Game from File\n";
+        console() << "9. View Kingdom History Report\n";
+        console() << "10. Advance to Next Turn\n";
+        console() << "11. View Rival AI Kingdoms\n";
+        console() << "12. Exit\n";
+        console() << "13. Rewind to an Earlier Turn\n";
+        console() << "14. Visit the Bank (Loans)\n";
+        console() << "=================================================\n";
+    }
+    int choice = 0;
+    if (!input.readInt("Enter your choice: ", choice) && input.exhausted()) {
+        running = false; // Nobody left to ask
+        return false;
+    }
+
+    // Input validation
+    if (choice < 1 || choice > 14) {
+        console() << "Invalid input! Please enter a number between 1 and 14.\n";
+        return true;
+    }
+
+    // Action handling
+    switch (choice) {
+        case 1:
+            showOverview();
+            break;
+
+        case 2:
+            population.simulate();
+            // Take a snapshot after population changes
+            history.takeSnapshot(population, economy, army, resources, "Population simulation");
+            break;
+
+        case 3:
+            army.recruitAndTrain(population);
+            // Take a snapshot after army recruitment
+            history.takeSnapshot(population, economy, army, resources, "Army recruitment");
+            break;
+
+        case 4:
+            economy.taxPopulation(population);
+            bank.auditTreasury(economy);
+            // Take a snapshot after economic changes
+            history.takeSnapshot(population, economy, army, resources, "Tax collection");
+            break;
+
+        case 5:
+            resources.manage();
+            break;
+
+        case 6:
+            events.trigger(population, army, economy, resources);
+            bank.auditTreasury(economy);
+            break;
+
+        case 7:
+            // Use GameSaver to save all game state to a single file
+            if (saver.saveGame(population, army, economy, resources, bank)) {
+                console() << "Game state captured; the save finishes in the background\n";
+            } else {
+                console() << "Failed to save game state\n";
+            }
+            break;
+
+        case 8:
+            // Use GameSaver to load all game state from a single file
+            if (saver.loadGame(population, army, economy, resources, bank)) {
+                console() << "Game loaded successfully from game_save.txt\n";
+                publishTurn();
+            } else {
+                console() << "Failed to load game state\n";
+            }
+            break;
+
+        case 9:
+            // Display the kingdom history report
+            history.displayProgressionReport();
+            break;
+
+        case 10:
+            advanceTurn();
+            break;
+
+        case 11:
+            showRivals();
+            break;
+
+        case 12:
+            // Exit the game
+            running = false;
+            break;
+
+        case 13: {
+            int turn = 0;
+            if (!input.readInt("Rewind to the start of which turn? ", turn) || !rewind(turn)) {
+                console() << "That turn cannot be rewound to; turns " << timeline[0].turn
+                          << " to " << getTurn() << " can.\n";
+            } else {
+                console() << "Rewound to the start of turn " << turn << "\n";
+            }
+            break;
+        }
+
+        case 14:
+            bank.visit(economy);
+            bank.auditTreasury(economy);
+            break;
+    }
+    return running;
+}
+
+// Let the AI run the kingdom for a turn, then move to the next one
+void StrongholdGame::advanceTurn() {
+    ScopedLatency turnTiming(PHASE_TURN);
+    ScopedTrace turnSpan("turn");
+    AIController ai;
+
+    // Each phase names what it touches; phases that do not wait on each
+    // other may run at the same time on the turn executor. Every phase that
+    // prints renders into a holding sink of its own, shown on this thread in
+    // the order the phases were added once the turn is over.
+    OutputMode mode = OutputSink::local().getMode();
+    size_t sinks = 0;
+    auto held = [&](function<void()> body) {
+        if (sinks == turnOutput.size()) turnOutput.push_back(new OutputSink(true));
+        OutputSink* sink = turnOutput[sinks++];
+        sink->setMode(mode);
+        return function<void()>([sink, body]() {
+            RedirectedOutput into(*sink);
+            body();
+        });
+    };
+
+    TaskGraph turn;
+    int populationBefore = turn.add("turn.before.population", TURN_POPULATION, 0, 0, held([&]() {
+        console() << "\n=========== Kingdom State Before AI Actions ===========\n";
+        population.showStats();
+    }));
+    int armyBefore = turn.add("turn.before.army", TURN_ARMY, 0, 0, held([&]() {
+        army.showStats();
+    }));
+    int economyBefore = turn.add("turn.before.economy", TURN_ECONOMY, 0, 0, held([&]() {
+        economy.showStats();
+    }));
+    turn.add("turn.before.resources", TURN_RESOURCES, 0, 0, held([&]() {
+        resources.showStats();
+        console() << "\n============= AI Decision Making Process =============\n";
+    }));
+
+    // Show AI tax management decision and effects
+    int tax = turn.add("turn.aiTax", TURN_POPULATION, TURN_ECONOMY | TURN_BANK | TURN_AI, 1ULL << economyBefore,
+                       held([&]() {
+        console() << ai.makeTaxDecision(economy, population);
+    }));
+
+    // Show AI army management decision and effects
+    int mobilize = turn.add("turn.aiArmy", TURN_RESOURCES, TURN_POPULATION | TURN_ARMY | TURN_AI | TURN_INPUT,
+                            (1ULL << populationBefore) | (1ULL << armyBefore) | (1ULL << tax), held([&]() {
+        console() << ai.mobilizeArmy(army, population, resources);
+    }));
+
+    // Show AI conflict management decision and effects
+    int conflict = turn.add("turn.aiConflict", 0,
+                            TURN_POPULATION | TURN_ARMY | TURN_ECONOMY | TURN_BANK | TURN_AI, 1ULL << mobilize,
+                            held([&]() {
+        console() << ai.handleInternalConflict(population, army, economy);
+    }));
+
+    turn.add("turn.after.population", TURN_POPULATION, 0, 1ULL << conflict, held([&]() {
+        console() << "\n=========== Kingdom State After AI Actions ===========\n";
+        population.showStats();
+    }));
+    turn.add("turn.after.army", TURN_ARMY, 0, 1ULL << conflict, held([&]() {
+        army.showStats();
+    }));
+    int economyAfter = turn.add("turn.after.economy", TURN_ECONOMY, 0, 1ULL << conflict, held([&]() {
+        economy.showStats();
+    }));
+    // Nothing in a turn changes the stores, so their block waits on no phase
+    turn.add("turn.after.resources", TURN_RESOURCES, 0, 0, held([&]() {
+        resources.showStats();
+    }));
+
+    // Accrue loan interest and collect maturing loans
+    int loans = turn.add("turn.bank", 0, TURN_ECONOMY | TURN_BANK, 1ULL << economyAfter, held([&]() {
+        bank.processTurn(economy);
+    }));
+
+    // Take a snapshot after AI actions, then advance to the next turn
+    int snapshot = turn.add("turn.history", TURN_KINGDOM, TURN_HISTORY, 1ULL << loans, held([&]() {
+        history.takeSnapshot(population, economy, army, resources, "AI turn actions");
+        history.nextTurn();
+    }));
+    turn.add("turn.keyframe", TURN_KINGDOM | TURN_BANK | TURN_HISTORY | TURN_RANDOM, TURN_TIMELINE,
+             1ULL << snapshot, [&]() {
+        GameKeyframe start;
+        captureKeyframe(start);
+        timeline.push_back(start);
+    });
+    turn.add("turn.publish", TURN_KINGDOM | TURN_BANK | TURN_HISTORY, TURN_SPECTATORS, 1ULL << snapshot, [&]() {
+        publishTurn();
+    });
+
+    // Metrics go out once every phase that counts something has run
+    turn.add("turn.metrics", TURN_POPULATION | TURN_ARMY | TURN_ECONOMY, TURN_METRICS, 1ULL << snapshot, [&]() {
+        Metrics::count(METRIC_TURNS);
+        Metrics::setGauge(METRIC_TREASURY, economy.getTreasury());
+        Metrics::setGauge(METRIC_POPULATION, population.getTotal());
+        Metrics::setGauge(METRIC_SOLDIERS, army.getSoldiers());
+        if (!metricsPath.empty()) {
+            Metrics::writePrometheus(metricsPath);
+        }
+    });
+
+    turn.setCallerOnly(TURN_INPUT | TURN_RANDOM);
+    turn.run(turnExecutor);
+    for (size_t i = 0; i < sinks; i++) {
+        turnOutput[i]->replayInto(OutputSink::local());
+    }
+    TurnArena::local().reset(); // The AI's reports are printed and gone
+}
+
+// Show where the rival AI kingdoms stand. They are started on the first
+// look and keep playing their own turns in the background from then on.
+void StrongholdGame::showRivals() {
+    console() << "\n============= Rival AI Kingdoms =============\n";
+    if (rivalThreads == 0) {
+        console() << "Rival kingdoms are not available in this game.\n";
+        return;
+    }
+    if (!rivals) {
+        rivals = new RivalKingdoms(rivalThreads, GameRandom::local().getState());
+        console() << RIVAL_KINGDOMS << " rival kingdoms have been founded. Their AI rulers will play on\n"
+                  << "while you rule; check back here to see how they fare.\n";
+    }
+
+    vector<RivalSnapshot> kingdoms;
+    if (!rivals->snapshot(kingdoms)) {
+        console() << "The rivals' messengers did not arrive in time. Try again shortly.\n";
+        return;
+    }
+    for (size_t k = 0; k < kingdoms.size(); k++) {
+        const KingdomRecord& record = kingdoms[k].record;
+        console() << "Rival " << k + 1 << " (turn " << kingdoms[k].turn << "): population " << record.total
+                  << ", soldiers " << record.soldiers << ", morale " << record.morale << "%, treasury "
+                  << record.treasury << " gold, tax " << (int)record.taxRate << "%\n";
+    }
+}
+
+// ========== Keyframes ==========
+
+void StrongholdGame::exportKingdom(KingdomRecord& record) const {
+    memset(&record, 0, sizeof(KingdomRecord));
+    population.exportState(record);
+    army.exportState(record);
+    economy.exportState(record);
+    resources.exportState(record);
+}
+
+// Capture everything needed to resume from this point
+void StrongholdGame::captureKeyframe(GameKeyframe& keyframe) const {
+    exportKingdom(keyframe.kingdom);
+    bank.exportState(keyframe.kingdom, keyframe.loans);
+    army.exportMarch(keyframe.marchX, keyframe.marchY, keyframe.marching);
+    bank.exportMonitor(keyframe.monitor);
+    keyframe.turn = history.getCurrentTurn();
+    keyframe.rngState = GameRandom::local().getState();
+}
+
+// Resume from a captured keyframe. The history report and the rewind
+// timeline start over from here.
+void StrongholdGame::restoreKeyframe(const GameKeyframe& keyframe) {
+    applyKeyframe(keyframe);
+    timeline.clear();
+    timeline.push_back(keyframe);
+    publishTurn();
+}
+
+bool StrongholdGame::rewind(int turn) {
+    int first = timeline[0].turn;
+    if (turn < first || turn > getTurn()) return false;
+
+    // Dropping the later turns only shortens the timeline
+    size_t index = (size_t)(turn - first);
+    applyKeyframe(timeline[index]);
+    timeline.resize(index + 1);
+    history.rewindTo(turn);
+    publishTurn();
+    return true;
+}
+
+void StrongholdGame::setPublisher(ReplicationPublisher* newPublisher) {
+    publisher = newPublisher;
+    publishTurn();
+}
+
+void StrongholdGame::setTurnExecutor(TaskExecutor* executor) {
+    turnExecutor = executor;
+}
+
+void StrongholdGame::setSaveWorker(SaveWorker* worker) {
+    saver.setWorker(worker);
+}
+
+void StrongholdGame::setRivalThreads(int threads) {
+    rivalThreads = threads < 0 ? 0 : threads;
+}
+
+void StrongholdGame::setLiveState(LiveStateWriter* newLiveState) {
+    liveState = newLiveState;
+    publishTurn();
+}
+
+// Helper to hand the kingdom as it stands to spectators and monitors
+void StrongholdGame::publishTurn() {
+    if (!publisher && !liveState) return;
+    KingdomRecord record;
+    vector<LoanRecord> loans;
+    exportKingdom(record);
+    bank.exportState(record, loans);
+    if (liveState) {
+        liveState->publish((uint32_t)getTurn(), &record, 1);
+    }
+    if (publisher) {
+        PersistentVector<KingdomRecord> world;
+        world.push_back(record);
+        publisher->publish((uint32_t)getTurn(), world);
+    }
+}
+
+// Helper to put every subsystem back as a keyframe holds it
+void StrongholdGame::applyKeyframe(const GameKeyframe& keyframe) {
+    population.importState(keyframe.kingdom);
+    army.importState(keyframe.kingdom);
+    economy.importState(keyframe.kingdom);
+    resources.importState(keyframe.kingdom);
+    bank.importState(keyframe.kingdom, keyframe.loans);
+    army.importMarch(keyframe.marchX, keyframe.marchY, keyframe.marching);
+    bank.importMonitor(keyframe.monitor); // After the economy, which resets its baseline
+    history.setCurrentTurn(keyframe.turn);
+    GameRandom::local().setState(keyframe.rngState);
+    running = true;
+}
@@ -0,0 +1,143 @@
+#include "Stronghold.h"
+#include <charconv>
+
+static thread_local InputProvider* localProvider = nullptr;
+
+InputProvider& InputProvider::local() {
+    static thread_local TerminalInput terminal;
+    return localProvider ? *localProvider : terminal;
+}
+
+void InputProvider::setLocal(InputProvider* provider) {
+    localProvider = provider;
+}
+
+// ========== Terminal ==========
+
+TerminalInput::TerminalInput(istream& in) : in(in) {}
+
+bool TerminalInput::readInt(const char* prompt, int& value) {
+    if (prompt) console() << prompt;
+    if (in >> value) return true;
+    if (!in.eof()) {
+        // Not a number: skip the rest of the line so the next question starts clean
+        in.clear();
+        in.ignore(10000, '\n');
+    }
+    return false;
+}
+
+bool TerminalInput::exhausted() const {
+    return in.eof();
+}
+
+bool TerminalInput::showsPrompts() const {
+    return true;
+}
+
+// ========== Recording ==========
+
+RecordingInput::RecordingInput(InputProvider& source) : source(source) {}
+
+// Start a new recording at `path`; must succeed before answers are recorded
+bool RecordingInput::open(const string& path) {
+    log.open(path, ios::trunc);
+    if (!log) {
+        cerr << "Error: Could not open " << path << " to record input.\n";
+        return false;
+    }
+    log << "# Stronghold input recording: one answer per line, x for an answer that was not a number\n";
+    return true;
+}
+
+bool RecordingInput::readInt(const char* prompt, int& value) {
+    bool valid = source.readInt(prompt, value);
+    if (valid) {
+        log << value << "\n";
+    } else if (!source.exhausted()) {
+        log << "x\n";
+    }
+    log.flush(); // Keep every answer if the game is killed
+    return valid;
+}
+
+bool RecordingInput::exhausted() const {
+    return source.exhausted();
+}
+
+bool RecordingInput::showsPrompts() const {
+    return source.showsPrompts();
+}
+
+// ========== Replay ==========
+
+ReplayInput::ReplayInput() {
+    next = 0;
+}
+
+// Load a recording made by RecordingInput, replacing any answers held
+bool ReplayInput::load(const string& path) {
+    ifstream in(path);
+    if (!in) {
+        cerr << "Error: Could not open input recording " << path << ".\n";
+        return false;
+    }
+
+    answers.clear();
+    next = 0;
+    string line;
+    int lineNumber = 0;
+    while (getline(in, line)) {
+        lineNumber++;
+        size_t start = line.find_first_not_of(" \t\r");
+        if (start == string::npos || line[start] == '#') continue;
+        size_t end = line.find_last_not_of(" \t\r") + 1;
+
+        InputAnswer answer = { 0, false };
+        if (!(end - start == 1 && line[start] == 'x')) {
+            from_chars_result result = from_chars(line.data() + start, line.data() + end, answer.value);
+            if (result.ec != errc() || result.ptr != line.data() + end) {
+                cerr << "Error: " << path << " line " << lineNumber << " is not a recorded answer.\n";
+                answers.clear();
+                return false;
+            }
+            answer.valid = true;
+        }
+        answers.push_back(answer);
+    }
+    return true;
+}
+
+void ReplayInput::add(int value) {
+    InputAnswer answer = { value, true };
+    answers.push_back(answer);
+}
+
+void ReplayInput::add(const InputAnswer& answer) {
+    answers.push_back(answer);
+}
+
+// Start again from the first answer
+void ReplayInput::rewind() {
+    next = 0;
+}
+
+size_t ReplayInput::getAnswerCount() const {
+    return answers.size();
+}
+
+bool ReplayInput::readInt(const char* prompt, int& value) {
+    (void)prompt;
+    if (next >= answers.size()) return false;
+    const InputAnswer& answer = answers[next++];
+    if (answer.valid) value = answer.value;
+    return answer.valid;
+}
+
+bool ReplayInput::exhausted() const {
+    return next >= answers.size();
+}
+
+bool ReplayInput::showsPrompts() const {
+    return false;
+}
@@ -12,7 +12,7 @@ string Leader::getName() const {
 
 // Default imposePolicy (does nothing)
 void Leader::imposePolicy(Economy& economy, Army& army) {
-    cout << name << " has not imposed any specific policy.\n";
+    console() << name << " has not imposed any specific policy.\n";
 }
 
 // ======== King Subclass ========
@@ -20,7 +20,7 @@ void Leader::imposePolicy(Economy& economy, Army& army) {
 King::King() : Leader("King") {}
 
 void King::imposePolicy_King(Economy& economy, Army& army) {
-    cout << "The King enacts a peace policy.\n";
+    console() << "The King enacts a peace policy.\n";
     economy.spend(100); // Invest in public happiness
     army.lowerMorale(5); // Soldiers bored without war
 }
@@ -30,7 +30,7 @@ void King::imposePolicy_King(Economy& economy, Army& army) {
 Tyrant::Tyrant() : Leader("Tyrant") {}
 
 void Tyrant::imposePolicy_Tyrant(Economy& economy, Army& army) {
-    cout << "The Tyrant enforces harsh military rules.\n";
+    console() << "The Tyrant enforces harsh military rules.\n";
     economy.spend(50);       // Spend less
     army.lowerMorale(-10);   // Increase morale (aggressive spirit)
 }
@@ -0,0 +1,197 @@
+#include "Stronghold.h"
+#include <cstring>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Both sides copy the records with plain memcpy between the fences; a reader
+// that raced the writer throws its copy away when the sequence moved.
+
+// ========== Writer ==========
+
+LiveStateWriter::LiveStateWriter() {
+    header = nullptr;
+    records = nullptr;
+    mappedBytes = 0;
+}
+
+LiveStateWriter::~LiveStateWriter() {
+#ifndef _WIN32
+    if (header) {
+        munmap(header, mappedBytes);
+        shm_unlink(name.c_str()); // Readers that still have it mapped keep the last turn
+    }
+#endif
+}
+
+bool LiveStateWriter::open(const string& segmentName, int capacity) {
+#ifdef _WIN32
+    (void)segmentName;
+    (void)capacity;
+    cerr << "Error: Shared-memory live state is not supported on this platform.\n";
+    return false;
+#else
+    if (header || capacity < 1) return false;
+
+    size_t bytes = LIVE_STATE_RECORDS_OFFSET + (size_t)capacity * sizeof(KingdomRecord);
+    shm_unlink(segmentName.c_str()); // A segment left over from a crash may have another layout
+    int fd = shm_open(segmentName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0 || ftruncate(fd, (off_t)bytes) != 0) {
+        if (fd >= 0) {
+            close(fd);
+            shm_unlink(segmentName.c_str());
+        }
+        cerr << "Error: Could not create shared memory " << segmentName << ".\n";
+        return false;
+    }
+    void* mapped = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        shm_unlink(segmentName.c_str());
+        cerr << "Error: Could not map shared memory " << segmentName << ".\n";
+        return false;
+    }
+
+    // The segment starts zeroed; the magic number goes in last
+    name = segmentName;
+    mappedBytes = bytes;
+    header = new (mapped) LiveStateHeader();
+    records = (KingdomRecord*)((char*)mapped + LIVE_STATE_RECORDS_OFFSET);
+    header->layoutVersion = LIVE_STATE_LAYOUT_VERSION;
+    header->recordBytes = (uint32_t)sizeof(KingdomRecord);
+    header->capacity = (uint32_t)capacity;
+    header->sequence.store(0, memory_order_relaxed);
+    header->turn = 0;
+    header->kingdomCount = 0;
+    header->turnsPublished = 0;
+    atomic_thread_fence(memory_order_release);
+    header->magic = LIVE_STATE_MAGIC;
+    return true;
+#endif
+}
+
+void LiveStateWriter::publish(uint32_t turn, const KingdomRecord* kingdoms, int count) {
+    if (!header) return;
+    if (count > (int)header->capacity) count = (int)header->capacity;
+
+    uint64_t sequence = header->sequence.load(memory_order_relaxed);
+    header->sequence.store(sequence + 1, memory_order_relaxed); // Odd: readers retry
+    atomic_thread_fence(memory_order_release);
+    header->turn = turn;
+    header->kingdomCount = (uint32_t)count;
+    header->turnsPublished++;
+    memcpy(records, kingdoms, (size_t)count * sizeof(KingdomRecord));
+    header->sequence.store(sequence + 2, memory_order_release);
+}
+
+void LiveStateWriter::publish(uint32_t turn, const PersistentVector<KingdomRecord>& kingdoms) {
+    if (!header) return;
+    int count = (int)min(kingdoms.size(), (size_t)header->capacity);
+
+    uint64_t sequence = header->sequence.load(memory_order_relaxed);
+    header->sequence.store(sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    header->turn = turn;
+    header->kingdomCount = (uint32_t)count;
+    header->turnsPublished++;
+    for (int k = 0; k < count; k++) {
+        records[k] = kingdoms[(size_t)k];
+    }
+    header->sequence.store(sequence + 2, memory_order_release);
+}
+
+// ========== Reader ==========
+
+LiveStateReader::LiveStateReader() {
+    header = nullptr;
+    records = nullptr;
+    mappedBytes = 0;
+}
+
+LiveStateReader::~LiveStateReader() {
+#ifndef _WIN32
+    if (header) munmap((void*)header, mappedBytes);
+#endif
+}
+
+bool LiveStateReader::open(const string& segmentName) {
+#ifdef _WIN32
+    (void)segmentName;
+    cerr << "Error: Shared-memory live state is not supported on this platform.\n";
+    return false;
+#else
+    if (header) return false;
+
+    int fd = shm_open(segmentName.c_str(), O_RDONLY, 0);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0 || (size_t)info.st_size < LIVE_STATE_RECORDS_OFFSET) {
+        if (fd >= 0) close(fd);
+        cerr << "Error: No live state at " << segmentName << ".\n";
+        return false;
+    }
+    void* mapped = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        cerr << "Error: Could not map shared memory " << segmentName << ".\n";
+        return false;
+    }
+
+    const LiveStateHeader* candidate = (const LiveStateHeader*)mapped;
+    bool ready = candidate->magic == LIVE_STATE_MAGIC;
+    atomic_thread_fence(memory_order_acquire);
+    if (!ready || candidate->layoutVersion != LIVE_STATE_LAYOUT_VERSION ||
+        candidate->recordBytes != sizeof(KingdomRecord) ||
+        LIVE_STATE_RECORDS_OFFSET + (size_t)candidate->capacity * sizeof(KingdomRecord) > (size_t)info.st_size) {
+        munmap(mapped, (size_t)info.st_size);
+        cerr << "Error: " << segmentName << " is not a live state segment this build can read.\n";
+        return false;
+    }
+    header = candidate;
+    records = (const KingdomRecord*)((const char*)mapped + LIVE_STATE_RECORDS_OFFSET);
+    mappedBytes = (size_t)info.st_size;
+    return true;
+#endif
+}
+
+bool LiveStateReader::snapshot(vector<KingdomRecord>& kingdoms, uint32_t& turn) const {
+    if (!header) return false;
+    kingdoms.reserve(header->capacity); // So the retry loop never allocates
+    for (int attempt = 0; attempt < LIVE_STATE_READ_ATTEMPTS; attempt++) {
+        uint64_t before = header->sequence.load(memory_order_acquire);
+        if (before == 0) return false; // Nothing published yet
+        if (before & 1) continue;
+
+        uint32_t count = min(header->kingdomCount, header->capacity);
+        kingdoms.resize(count);
+        memcpy(kingdoms.data(), records, (size_t)count * sizeof(KingdomRecord));
+        turn = header->turn;
+
+        atomic_thread_fence(memory_order_acquire);
+        if (header->sequence.load(memory_order_relaxed) == before) return true;
+    }
+    return false;
+}
+
+bool LiveStateReader::readKingdom(int kingdom, KingdomRecord& record, uint32_t& turn) const {
+    if (!header || kingdom < 0 || kingdom >= (int)header->capacity) return false;
+    for (int attempt = 0; attempt < LIVE_STATE_READ_ATTEMPTS; attempt++) {
+        uint64_t before = header->sequence.load(memory_order_acquire);
+        if (before == 0) return false;
+        if (before & 1) continue;
+
+        bool present = (uint32_t)kingdom < header->kingdomCount;
+        record = records[kingdom];
+        turn = header->turn;
+
+        atomic_thread_fence(memory_order_acquire);
+        if (header->sequence.load(memory_order_relaxed) == before) return present;
+    }
+    return false;
+}
+
+int LiveStateReader::getCapacity() const {
+    return header ? (int)header->capacity : 0;
+}
@@ -0,0 +1,180 @@
+#include "Stronghold.h"
+
+// Constructor allocates the loan pool and starts every tier index at 1.0
+LoanLedger::LoanLedger(int initialCapacity) {
+    capacity = 0;
+    grow(initialCapacity > 0 ? initialCapacity : 1);
+
+    for (int t = 0; t < LOAN_RATE_TIERS; t++) {
+        tierRate[t] = (t + 1) / 100.0;
+    }
+    clear();
+}
+
+// Drop every loan and restart at turn 0 (tier rates are kept)
+void LoanLedger::clear() {
+    used = 0;
+    freeHead = -1;
+    activeCount = 0;
+    currentTurn = 0;
+    for (int t = 0; t < LOAN_RATE_TIERS; t++) {
+        tierIndex[t] = 1.0;
+        tierNormalizedTotal[t] = 0.0;
+    }
+    for (int i = 0; i < LOAN_MAX_TERM; i++) {
+        dueHead[i] = -1;
+    }
+}
+
+// Helper method to resize the loan pool (each array is moved with one memcpy)
+void LoanLedger::grow(int newCapacity) {
+    borrower.resize(newCapacity);
+    normalizedBalance.resize(newCapacity);
+    rateTier.resize(newCapacity);
+    dueTurn.resize(newCapacity);
+    dueNext.resize(newCapacity);
+    duePrev.resize(newCapacity);
+    active.resize(newCapacity);
+    capacity = newCapacity;
+}
+
+// Helper method to add a loan to the list for its due turn
+void LoanLedger::linkDue(int loan) {
+    int bucket = dueTurn[loan] % LOAN_MAX_TERM;
+    duePrev[loan] = -1;
+    dueNext[loan] = dueHead[bucket];
+    if (dueHead[bucket] >= 0) duePrev[dueHead[bucket]] = loan;
+    dueHead[bucket] = loan;
+}
+
+// Helper method to take a loan out of its due-turn list
+void LoanLedger::unlinkDue(int loan) {
+    int bucket = dueTurn[loan] % LOAN_MAX_TERM;
+    if (duePrev[loan] >= 0) dueNext[duePrev[loan]] = dueNext[loan];
+    else dueHead[bucket] = dueNext[loan];
+    if (dueNext[loan] >= 0) duePrev[dueNext[loan]] = duePrev[loan];
+}
+
+// Helper method to close a loan and put its slot on the free list
+void LoanLedger::release(int loan) {
+    unlinkDue(loan);
+    tierNormalizedTotal[rateTier[loan]] -= normalizedBalance[loan];
+    normalizedBalance[loan] = 0.0;
+    active[loan] = false;
+    activeCount--;
+
+    dueNext[loan] = freeHead;
+    freeHead = loan;
+}
+
+// Record a new loan; returns its id
+int LoanLedger::issue(int borrowerId, double amount, int tier, int termTurns) {
+    if (tier < 0) tier = 0;
+    if (tier >= LOAN_RATE_TIERS) tier = LOAN_RATE_TIERS - 1;
+    if (termTurns < 1) termTurns = 1;
+    if (termTurns >= LOAN_MAX_TERM) termTurns = LOAN_MAX_TERM - 1;
+
+    int loan;
+    if (freeHead >= 0) {
+        loan = freeHead;
+        freeHead = dueNext[loan];
+    } else {
+        if (used >= capacity) grow(capacity * 2);
+        loan = used++;
+    }
+
+    borrower[loan] = borrowerId;
+    rateTier[loan] = (unsigned char)tier;
+    normalizedBalance[loan] = amount / tierIndex[tier];
+    tierNormalizedTotal[tier] += normalizedBalance[loan];
+    dueTurn[loan] = currentTurn + termTurns;
+    active[loan] = true;
+    activeCount++;
+    linkDue(loan);
+    return loan;
+}
+
+bool LoanLedger::isActive(int loanId) const {
+    return loanId >= 0 && loanId < used && active[loanId];
+}
+
+// Current balance including accrued interest
+double LoanLedger::balance(int loanId) const {
+    if (!isActive(loanId)) return 0.0;
+    return normalizedBalance[loanId] * tierIndex[rateTier[loanId]];
+}
+
+// Pay down a loan; returns the amount actually applied
+double LoanLedger::repay(int loanId, double amount) {
+    if (!isActive(loanId) || amount <= 0.0) return 0.0;
+
+    double owed = balance(loanId);
+    double applied = amount < owed ? amount : owed;
+    double reduction = applied / tierIndex[rateTier[loanId]];
+    normalizedBalance[loanId] -= reduction;
+    tierNormalizedTotal[rateTier[loanId]] -= reduction;
+
+    // Anything under half a gold piece counts as paid off
+    if (owed - applied < 0.5) {
+        release(loanId);
+    }
+    return applied;
+}
+
+// Close a loan without payment (default)
+void LoanLedger::writeOff(int loanId) {
+    if (isActive(loanId)) release(loanId);
+}
+
+// Change a tier's rate from this turn on (earlier interest is kept)
+void LoanLedger::setTierRate(int tier, double ratePerTurn) {
+    if (tier < 0 || tier >= LOAN_RATE_TIERS) return;
+    tierRate[tier] = ratePerTurn > 0.0 ? ratePerTurn : 0.0;
+}
+
+// Helper method to fold a tier's index into its loans and restart it at 1.0
+void LoanLedger::rebaseTier(int tier) {
+    double index = tierIndex[tier];
+    double total = 0.0;
+    for (int loan = 0; loan < used; loan++) {
+        if (!active[loan] || rateTier[loan] != tier) continue;
+        normalizedBalance[loan] *= index;
+        total += normalizedBalance[loan];
+    }
+    tierIndex[tier] = 1.0;
+    tierNormalizedTotal[tier] = total;
+}
+
+// Move to the next turn (O(tiers), no loan is touched unless a tier is rebased)
+void LoanLedger::advanceTurn() {
+    currentTurn++;
+    for (int t = 0; t < LOAN_RATE_TIERS; t++) {
+        tierIndex[t] *= 1.0 + tierRate[t];
+        if (tierIndex[t] > LOAN_INDEX_REBASE) rebaseTier(t);
+    }
+}
+
+// Loans that mature this turn
+int LoanLedger::collectDue(int* loanIds, int maxLoans) const {
+    return collectDueAt(currentTurn, loanIds, maxLoans);
+}
+
+// Loans that mature on the given turn; only that turn's list is walked
+int LoanLedger::collectDueAt(int turn, int* loanIds, int maxLoans) const {
+    int found = 0;
+    for (int loan = dueHead[turn % LOAN_MAX_TERM]; loan >= 0; loan = dueNext[loan]) {
+        if (dueTurn[loan] != turn) continue;
+        if (found < maxLoans) loanIds[found] = loan;
+        found++;
+    }
+    return found;
+}
+
+// Sum of every balance, from the per-tier totals
+double LoanLedger::totalOutstanding() const {
+    double total = 0.0;
+    for (int t = 0; t < LOAN_RATE_TIERS; t++) {
+        total += tierNormalizedTotal[t] * tierIndex[t];
+    }
+    return total > 0.0 ? total : 0.0;
+}
@@ -1,196 +1,145 @@
 #include <iostream>
+#include <cstdlib>
+#include <chrono>
 #include "Stronghold.h"  // Your header with all class declarations
 
 
 using namespace std;
 
-int main() {
-    // Initialize core systems (basic object instantiations)
-    Population populationSystem;
-    Army armySystem;
-    Economy economySystem;
-    ResourceManager resourceSystem;
-    Leader* currentLeader = new King();  // Polymorphic leader
-    EventManager eventSystem;
-    Bank bankSystem;
-    GameSaver gameSaver;  // Initialize the GameSaver for unified saving/loading
-    HistoryTracker historyTracker;  // Initialize the HistoryTracker for recording game history
+// Usage: stronghold [--record file | --replay file [--repeat n]] [--replay-log file [--keyframe-every k]] [--replicate socket]
+//                   [--turn-threads n]
+//   --record      saves every answer typed so the session can be replayed
+//   --replay      plays a recording back without prompts, as fast as it goes
+//   --repeat      replays the recording n times, each from a fresh kingdom
+//   --replay-log  writes a seekable replay log of the campaign (see stronghold_replay)
+//   --replicate   streams every turn to spectators on a local socket (see stronghold_spectate)
+//   --turn-threads runs a turn's independent phases on n extra threads; worth it
+//                 only when phases are long, such as a slow metrics file
+int main(int argc, char** argv) {
+    string recordPath;
+    string replayPath;
+    string replayLogPath;
+    string replicatePath;
+    int turnThreads = 0;
+    int repeat = 1;
+    int keyframeEvery = REPLAY_DEFAULT_KEYFRAME_INTERVAL;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--record" && i + 1 < argc) recordPath = argv[++i];
+        else if (arg == "--replay" && i + 1 < argc) replayPath = argv[++i];
+        else if (arg == "--repeat" && i + 1 < argc) repeat = atoi(argv[++i]);
+        else if (arg == "--replay-log" && i + 1 < argc) replayLogPath = argv[++i];
+        else if (arg == "--keyframe-every" && i + 1 < argc) keyframeEvery = atoi(argv[++i]);
+        else if (arg == "--replicate" && i + 1 < argc) replicatePath = argv[++i];
+        else if (arg == "--turn-threads" && i + 1 < argc) turnThreads = atoi(argv[++i]);
+        else {
+            cerr << "Usage: stronghold [--record file | --replay file [--repeat n]] [--replay-log file [--keyframe-every k]] "
+                    "[--replicate socket] [--turn-threads n]\n";
+            return 1;
+        }
+    }
+    if ((!recordPath.empty() && !replayPath.empty()) || repeat < 1 || (repeat > 1 && replayPath.empty())) {
+        cerr << "Error: Use either --record or --replay, and --repeat (at least 1) only with --replay.\n";
+        return 1;
+    }
+    if (!replayLogPath.empty() && (repeat > 1 || keyframeEvery < 1)) {
+        cerr << "Error: --replay-log records a single session with --keyframe-every at least 1.\n";
+        return 1;
+    }
 
-    int choice;
-    bool running = true;
+    // Answers come from the terminal unless a recording is being made or replayed
+    TerminalInput terminal;
+    RecordingInput recorder(terminal);
+    ReplayInput replay;
+    InputProvider* input = &terminal;
+    if (!replayPath.empty()) {
+        if (!replay.load(replayPath)) return 1;
+        input = &replay;
+    } else if (!recordPath.empty()) {
+        if (!recorder.open(recordPath)) return 1;
+        input = &recorder;
+    }
+    InputProvider::setLocal(input);
+
+    // Console text is buffered and written out before each read from the player.
+    // STRONGHOLD_OUTPUT=quiet drops it all, =diff prints only stats that changed.
+    OutputSink& sink = OutputSink::local();
+    const char* outputMode = getenv("STRONGHOLD_OUTPUT");
+    if (outputMode && string(outputMode) == "quiet") {
+        sink.setMode(OUTPUT_QUIET);
+    } else if (outputMode && string(outputMode) == "diff") {
+        sink.setMode(OUTPUT_DIFF);
+    } else if (outputMode && string(outputMode) != "buffered") {
+        cerr << "Error: Unknown STRONGHOLD_OUTPUT mode " << outputMode << "; using buffered.\n";
+    }
+    cin.tie(&sink.text());
+    cerr.tie(&sink.text());
+
+    // Metrics are collected only when asked for: STRONGHOLD_METRICS names a file
+    // rewritten every turn, STRONGHOLD_METRICS_SOCKET a local socket to serve them on
+    const char* metricsFile = getenv("STRONGHOLD_METRICS");
+    const char* metricsSocket = getenv("STRONGHOLD_METRICS_SOCKET");
+    if (metricsFile || metricsSocket) {
+        Metrics::setEnabled(true);
+    }
+    if (metricsSocket) {
+        Metrics::servePrometheus(metricsSocket);
+    }
 
-    while (running) {
-        cout << "\n================ STRONGHOLD MENU ================\n";
-        cout << "1. View Kingdom Overview\n";
-        cout << "2. Simulate Population Changes\n";
-        cout << "3. Recruit and Train Army\n";
-        cout << "4. Manage Economy (Taxation, Treasury)\n";
-        cout << "5. Handle Resource Operations\n";
-        cout << "6. Trigger Random Event\n";
-        cout << "7. Save Game to File\n";
-        cout << "8. Load Game from File\n";
-        cout << "9. View Kingdom History Report\n";
-        cout << "10. Advance to Next Turn\n";
-        cout << "11. Let AI Control Non-Player Kingdom\n";
-        cout << "12. Exit\n";
-        cout << "=================================================\n";
-        cout << "Enter your choice: ";
-        cin >> choice;
+    // STRONGHOLD_LIVE_STATE names a shared-memory segment (such as /stronghold)
+    // holding the kingdom as of the latest turn, for stronghold_live to read
+    const char* liveStateName = getenv("STRONGHOLD_LIVE_STATE");
+    LiveStateWriter liveState;
+    if (liveStateName && !liveState.open(liveStateName, 1)) return 1;
+
+    // STRONGHOLD_TRACE names a Chrome trace file written on exit
+    const char* traceFile = getenv("STRONGHOLD_TRACE");
+    if (traceFile) {
+        Trace::setThreadName("game");
+        Trace::setEnabled(true);
+    }
 
-        // Input validation
-        if (cin.fail() || choice < 1 || choice > 12) {
-            cin.clear();
-            cin.ignore(10000, '\n');
-            cout << "Invalid input! Please enter a number between 1 and 12.\n";
+    ReplicationPublisher publisher;
+    if (!replicatePath.empty() && !publisher.listen(replicatePath)) return 1;
+
+    // At most three of a turn's phases are ever ready together, one of them the caller's
+    TaskExecutor* turnExecutor = turnThreads > 0 ? new TaskExecutor(min(turnThreads, 2)) : nullptr;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int run = 0; run < repeat; run++) {
+        replay.rewind();
+        StrongholdGame game;
+        if (metricsFile) game.setMetricsPath(metricsFile);
+        if (!replicatePath.empty()) game.setPublisher(&publisher);
+        if (liveStateName) game.setLiveState(&liveState);
+        game.setTurnExecutor(turnExecutor);
+        if (replayLogPath.empty()) {
+            game.play(*input);
             continue;
         }
 
-        // Action handling
-        switch (choice) {
-            case 1:
-                populationSystem.showStats();
-                armySystem.showStats();
-                economySystem.showStats();
-                resourceSystem.showStats();
-                bankSystem.showStats();
-                break;
-
-            case 2:
-                populationSystem.simulate();
-                // Take a snapshot after population changes
-                historyTracker.takeSnapshot(populationSystem, economySystem, armySystem, resourceSystem, "Population simulation");
-                break;
-
-            case 3:
-                armySystem.recruitAndTrain(populationSystem);
-                // Take a snapshot after army recruitment
-                historyTracker.takeSnapshot(populationSystem, economySystem, armySystem, resourceSystem, "Army recruitment");
-                break;
-
-            case 4:
-                economySystem.taxPopulation(populationSystem);
-                bankSystem.auditTreasury(economySystem);
-                // Take a snapshot after economic changes
-                historyTracker.takeSnapshot(populationSystem, economySystem, armySystem, resourceSystem, "Tax collection");
-                break;
-
-            case 5:
-                resourceSystem.manage();
-                break;
-
-            case 6:
-                eventSystem.trigger(populationSystem, armySystem, economySystem, resourceSystem);
-                break;
-
-            case 7:
-                // Use GameSaver to save all game state to a single file
-                if (gameSaver.saveGame(populationSystem, armySystem, economySystem, resourceSystem, bankSystem)) {
-                    cout << "Game saved successfully to game_save.txt\n";
-                } else {
-                    cout << "Failed to save game state\n";
-                }
-                break;
-
-            case 8:
-                // Use GameSaver to load all game state from a single file
-                if (gameSaver.loadGame(populationSystem, armySystem, economySystem, resourceSystem, bankSystem)) {
-                    cout << "Game loaded successfully from game_save.txt\n";
-                } else {
-                    cout << "Failed to load game state\n";
-                }
-                break;
-
-            case 9:
-                // Display the kingdom history report
-                historyTracker.displayProgressionReport();
-                break;
-            case 10: {
-                cout << "\n=========== Kingdom State Before AI Actions ===========\n";
-                populationSystem.showStats();
-                armySystem.showStats();
-                economySystem.showStats();
-                resourceSystem.showStats();
-
-                cout << "\n============= AI Decision Making Process =============\n";
-                AIController ai;
-                
-                // Show AI tax management decision and effects
-                string taxReport = ai.makeTaxDecision(economySystem, populationSystem);
-                cout << taxReport;
-                
-                // Show AI army management decision and effects
-                string armyReport = ai.mobilizeArmy(armySystem, populationSystem, resourceSystem);
-                cout << armyReport;
-                
-                // Show AI conflict management decision and effects
-                string conflictReport = ai.handleInternalConflict(populationSystem, armySystem, economySystem);
-                cout << conflictReport;
-
-                cout << "\n=========== Kingdom State After AI Actions ===========\n";
-                populationSystem.showStats();
-                armySystem.showStats();
-                economySystem.showStats();
-                resourceSystem.showStats();
-                
-                // Take a snapshot after AI actions
-                historyTracker.takeSnapshot(populationSystem, economySystem, armySystem, resourceSystem, "AI turn actions");
-                // Advance to next turn
-                historyTracker.nextTurn();
-                break;
-            }
-            
-            case 11: {
-                cout << "\n============= AI Kingdom Control =============\n";
-                cout << "AI is now controlling a non-player kingdom...";
-                
-                // Create a separate AI-controlled kingdom
-                Population aiPopulation;
-                Army aiArmy;
-                Economy aiEconomy;
-                ResourceManager aiResources;
-                AIController aiController;
-                
-                // Show initial state of AI kingdom
-                cout << "\n=========== AI Kingdom Initial State ===========\n";
-                aiPopulation.showStats();
-                aiArmy.showStats();
-                aiEconomy.showStats();
-                aiResources.showStats();
-                
-                // AI makes decisions for its kingdom
-                cout << "\n============= AI Kingdom Actions =============\n";
-                
-                // AI manages taxes
-                string taxReport = aiController.makeTaxDecision(aiEconomy, aiPopulation);
-                cout << taxReport;
-                
-                // AI manages army
-                string armyReport = aiController.mobilizeArmy(aiArmy, aiPopulation, aiResources);
-                cout << armyReport;
-                
-                // AI handles internal conflicts
-                string conflictReport = aiController.handleInternalConflict(aiPopulation, aiArmy, aiEconomy);
-                cout << conflictReport;
-                
-                // Show final state of AI kingdom
-                cout << "\n=========== AI Kingdom Final State ===========\n";
-                aiPopulation.showStats();
-                aiArmy.showStats();
-                aiEconomy.showStats();
-                aiResources.showStats();
-                
-                cout << "\nAI kingdom simulation complete.\n";
-                break;
-            }
-            
-            case 12:
-                // Exit the game
-                running = false;
-                break;
+        ReplayRecorder logger(*input, game);
+        if (logger.open(replayLogPath, keyframeEvery)) {
+            InputProvider::setLocal(&logger);
+            game.play(logger);
+            InputProvider::setLocal(input);
         }
     }
-
-    delete currentLeader;  // clean-up if not using smart pointers
-    cout << "\nGame exited successfully. Long live the kingdom!\n";
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    delete turnExecutor;
+    InputProvider::setLocal(nullptr);
+    if (metricsFile) {
+        Metrics::writePrometheus(metricsFile);
+    }
+    Metrics::stopServing();
+    if (traceFile) {
+        Trace::writeChromeTrace(traceFile);
+    }
+    console() << "\nGame exited successfully. Long live the kingdom!\n";
+    sink.flush();
+    if (!replayPath.empty()) {
+        cout << "Replayed " << repeat << " session(s) of " << replay.getAnswerCount() << " answers in "
+             << seconds << " s (" << repeat / seconds << " sessions/s)\n";
+    }
     return 0;
 }
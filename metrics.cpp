@@ -0,0 +1,360 @@
+#include "Stronghold.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+// Names as exported, in enum order
+static const char* COUNTER_NAMES[METRIC_COUNTER_COUNT] = {
+    "stronghold_turns_total",
+    "stronghold_snapshots_taken_total",
+    "stronghold_resource_changes_total",
+    "stronghold_ai_decisions_total",
+    "stronghold_events_fired_total",
+    "stronghold_saves_total",
+    "stronghold_loads_total",
+    "stronghold_log_lines_total"
+};
+
+static const char* COUNTER_HELP[METRIC_COUNTER_COUNT] = {
+    "Turns played.",
+    "History snapshots taken.",
+    "Resource and army stock changes tracked.",
+    "Decisions recorded by AI controllers.",
+    "Random events fired.",
+    "Saves requested.",
+    "Saves loaded.",
+    "Lines appended to the score log."
+};
+
+static const char* GAUGE_NAMES[METRIC_GAUGE_COUNT] = {
+    "stronghold_treasury_gold",
+    "stronghold_population",
+    "stronghold_soldiers"
+};
+
+static const char* GAUGE_HELP[METRIC_GAUGE_COUNT] = {
+    "Treasury at the end of the last turn.",
+    "Population at the end of the last turn.",
+    "Soldiers at the end of the last turn."
+};
+
+static const char* PHASE_NAMES[METRIC_PHASE_COUNT] = {
+    "turn", "ai_tax", "ai_army", "ai_conflict", "bank", "snapshot",
+    "event", "save_capture", "save_write", "load", "log"
+};
+
+// Prometheus buckets are exported at powers of two from 256 ns to about 69 s
+static const int EXPORT_FIRST_EXPONENT = 8;
+static const int EXPORT_LAST_EXPONENT = 36;
+
+// One thread's share of every counter and histogram. Only the owning
+// thread writes, so relaxed load + store is enough and never contends.
+struct MetricsShard {
+    atomic<uint64_t> counters[METRIC_COUNTER_COUNT];
+    atomic<uint64_t> buckets[METRIC_PHASE_COUNT][METRIC_BUCKETS];
+    atomic<uint64_t> sums[METRIC_PHASE_COUNT];
+    MetricsShard* next;
+    bool inUse;
+};
+
+static atomic<bool> metricsEnabled(false);
+static atomic<int64_t> gauges[METRIC_GAUGE_COUNT];
+
+// Every shard ever created; shards of finished threads are reused, and
+// their totals stay in the export
+static mutex registryLock;
+static MetricsShard* registry = nullptr;
+
+// Helper to give a thread a shard, reusing one a finished thread left behind
+static MetricsShard* acquireShard() {
+    lock_guard<mutex> guard(registryLock);
+    for (MetricsShard* shard = registry; shard; shard = shard->next) {
+        if (!shard->inUse) {
+            shard->inUse = true;
+            return shard;
+        }
+    }
+
+    MetricsShard* shard = new MetricsShard();
+    for (int c = 0; c < METRIC_COUNTER_COUNT; c++) {
+        shard->counters[c].store(0, memory_order_relaxed);
+    }
+    for (int p = 0; p < METRIC_PHASE_COUNT; p++) {
+        for (int b = 0; b < METRIC_BUCKETS; b++) {
+            shard->buckets[p][b].store(0, memory_order_relaxed);
+        }
+        shard->sums[p].store(0, memory_order_relaxed);
+    }
+    shard->inUse = true;
+    shard->next = registry;
+    registry = shard;
+    return shard;
+}
+
+// Returns the thread's shard to the registry when the thread ends
+struct ShardHandle {
+    MetricsShard* shard = nullptr;
+    ~ShardHandle() {
+        if (shard) {
+            lock_guard<mutex> guard(registryLock);
+            shard->inUse = false;
+        }
+    }
+};
+
+static thread_local ShardHandle localShard;
+
+static inline MetricsShard* shard() {
+    MetricsShard* current = localShard.shard;
+    if (!current) {
+        current = acquireShard();
+        localShard.shard = current;
+    }
+    return current;
+}
+
+// Helper for a single-writer relaxed increment
+static inline void bump(atomic<uint64_t>& value, uint64_t amount) {
+    value.store(value.load(memory_order_relaxed) + amount, memory_order_relaxed);
+}
+
+static inline uint64_t nowNanoseconds() {
+    return (uint64_t)chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// ========== Recording ==========
+
+void Metrics::setEnabled(bool enabled) {
+    metricsEnabled.store(enabled, memory_order_relaxed);
+}
+
+bool Metrics::isEnabled() {
+    return metricsEnabled.load(memory_order_relaxed);
+}
+
+void Metrics::count(MetricCounter counter, uint64_t amount) {
+    if (!metricsEnabled.load(memory_order_relaxed)) return;
+    bump(shard()->counters[counter], amount);
+}
+
+void Metrics::setGauge(MetricGauge gauge, int64_t value) {
+    if (!metricsEnabled.load(memory_order_relaxed)) return;
+    gauges[gauge].store(value, memory_order_relaxed);
+}
+
+void Metrics::recordLatency(MetricPhase phase, uint64_t nanoseconds) {
+    if (!metricsEnabled.load(memory_order_relaxed)) return;
+    MetricsShard* current = shard();
+    bump(current->buckets[phase][bucketFor(nanoseconds)], 1);
+    bump(current->sums[phase], nanoseconds);
+}
+
+// Bucket of a latency: exact below 8 ns, then 8 linear steps per power of two
+int Metrics::bucketFor(uint64_t nanoseconds) {
+    if (nanoseconds < (uint64_t)METRIC_SUB_BUCKETS) return (int)nanoseconds;
+#ifdef _MSC_VER
+    unsigned long highest;
+    _BitScanReverse64(&highest, nanoseconds);
+    int exponent = (int)highest;
+#else
+    int exponent = 63 - __builtin_clzll(nanoseconds);
+#endif
+    int sub = (int)(nanoseconds >> (exponent - 3)) & (METRIC_SUB_BUCKETS - 1);
+    int bucket = METRIC_SUB_BUCKETS + (exponent - 3) * METRIC_SUB_BUCKETS + sub;
+    return bucket < METRIC_BUCKETS ? bucket : METRIC_BUCKETS - 1;
+}
+
+uint64_t Metrics::bucketLowerBound(int bucket) {
+    if (bucket < METRIC_SUB_BUCKETS) return (uint64_t)bucket;
+    int exponent = (bucket - METRIC_SUB_BUCKETS) / METRIC_SUB_BUCKETS + 3;
+    int sub = bucket % METRIC_SUB_BUCKETS;
+    return (uint64_t)(METRIC_SUB_BUCKETS + sub) << (exponent - 3);
+}
+
+ScopedLatency::ScopedLatency(MetricPhase phase) : phase(phase) {
+    active = metricsEnabled.load(memory_order_relaxed);
+    start = active ? nowNanoseconds() : 0;
+}
+
+ScopedLatency::~ScopedLatency() {
+    if (active) {
+        Metrics::recordLatency(phase, nowNanoseconds() - start);
+    }
+}
+
+// ========== Export ==========
+
+// Prometheus text exposition format
+string Metrics::renderPrometheus() {
+    uint64_t counters[METRIC_COUNTER_COUNT] = {};
+    uint64_t sums[METRIC_PHASE_COUNT] = {};
+    SmallVector<uint64_t, 0> buckets(METRIC_PHASE_COUNT * METRIC_BUCKETS);
+    {
+        lock_guard<mutex> guard(registryLock);
+        for (MetricsShard* s = registry; s; s = s->next) {
+            for (int c = 0; c < METRIC_COUNTER_COUNT; c++) {
+                counters[c] += s->counters[c].load(memory_order_relaxed);
+            }
+            for (int p = 0; p < METRIC_PHASE_COUNT; p++) {
+                sums[p] += s->sums[p].load(memory_order_relaxed);
+                for (int b = 0; b < METRIC_BUCKETS; b++) {
+                    buckets[p * METRIC_BUCKETS + b] += s->buckets[p][b].load(memory_order_relaxed);
+                }
+            }
+        }
+    }
+
+    string out;
+    char line[256];
+    for (int c = 0; c < METRIC_COUNTER_COUNT; c++) {
+        snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s counter\n%s %llu\n",
+                 COUNTER_NAMES[c], COUNTER_HELP[c], COUNTER_NAMES[c], COUNTER_NAMES[c],
+                 (unsigned long long)counters[c]);
+        out += line;
+    }
+    for (int g = 0; g < METRIC_GAUGE_COUNT; g++) {
+        snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s gauge\n%s %lld\n",
+                 GAUGE_NAMES[g], GAUGE_HELP[g], GAUGE_NAMES[g], GAUGE_NAMES[g],
+                 (long long)gauges[g].load(memory_order_relaxed));
+        out += line;
+    }
+
+    out += "# HELP stronghold_phase_duration_seconds Time spent in each phase of play.\n";
+    out += "# TYPE stronghold_phase_duration_seconds histogram\n";
+    for (int p = 0; p < METRIC_PHASE_COUNT; p++) {
+        const uint64_t* counts = buckets.data() + p * METRIC_BUCKETS;
+        uint64_t cumulative = 0;
+        int b = 0;
+        for (int exponent = EXPORT_FIRST_EXPONENT; exponent <= EXPORT_LAST_EXPONENT; exponent++) {
+            // Buckets never straddle a power of two, so these counts are exact
+            int firstAbove = METRIC_SUB_BUCKETS + (exponent - 3) * METRIC_SUB_BUCKETS;
+            for (; b < firstAbove; b++) {
+                cumulative += counts[b];
+            }
+            snprintf(line, sizeof(line), "stronghold_phase_duration_seconds_bucket{phase=\"%s\",le=\"%.9g\"} %llu\n",
+                     PHASE_NAMES[p], (double)(1ULL << exponent) * 1e-9, (unsigned long long)cumulative);
+            out += line;
+        }
+        for (; b < METRIC_BUCKETS; b++) {
+            cumulative += counts[b];
+        }
+        snprintf(line, sizeof(line),
+                 "stronghold_phase_duration_seconds_bucket{phase=\"%s\",le=\"+Inf\"} %llu\n"
+                 "stronghold_phase_duration_seconds_sum{phase=\"%s\"} %.9f\n"
+                 "stronghold_phase_duration_seconds_count{phase=\"%s\"} %llu\n",
+                 PHASE_NAMES[p], (unsigned long long)cumulative,
+                 PHASE_NAMES[p], sums[p] * 1e-9,
+                 PHASE_NAMES[p], (unsigned long long)cumulative);
+        out += line;
+    }
+
+    return out;
+}
+
+// Write the export to a file (temporary file + rename, so scrapers never see half)
+bool Metrics::writePrometheus(const string& path) {
+    string text = renderPrometheus();
+    string tempPath = path + ".tmp";
+    FILE* file = fopen(tempPath.c_str(), "wb");
+    if (!file) {
+        cerr << "Error: Could not open " << tempPath << " for metrics.\n";
+        return false;
+    }
+    bool written = fwrite(text.data(), 1, text.size(), file) == text.size();
+    written = fclose(file) == 0 && written;
+#ifdef _WIN32
+    remove(path.c_str()); // rename() does not replace there; elsewhere it swaps the file in atomically
+#endif
+    if (!written || rename(tempPath.c_str(), path.c_str()) != 0) {
+        cerr << "Error: Could not write metrics to " << path << ".\n";
+        remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+// ========== Socket Export ==========
+
+static atomic<bool> serving(false);
+static thread* server = nullptr;
+
+// Serve the text on a local (Unix domain) socket until stopServing()
+bool Metrics::servePrometheus(const string& socketPath) {
+#ifdef _WIN32
+    cerr << "Error: Metrics sockets are not supported on this platform; use writePrometheus.\n";
+    return false;
+#else
+    if (server) return false;
+
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        cerr << "Error: Metrics socket path is too long.\n";
+        return false;
+    }
+    strcpy(address.sun_path, socketPath.c_str());
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socketPath.c_str());
+    if (listener < 0 || bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 8) != 0) {
+        if (listener >= 0) close(listener);
+        cerr << "Error: Could not listen for metrics on " << socketPath << ".\n";
+        return false;
+    }
+
+    // Every connection gets one plain HTTP response, so curl --unix-socket works
+    serving = true;
+    server = new thread([listener, socketPath]() {
+        while (serving) {
+            pollfd waiting = { listener, POLLIN, 0 };
+            if (poll(&waiting, 1, 200) <= 0) continue;
+            int client = accept(listener, nullptr, nullptr);
+            if (client < 0) continue;
+
+            // Drain the request if the client sends one
+            pollfd request = { client, POLLIN, 0 };
+            char discard[1024];
+            if (poll(&request, 1, 50) > 0) {
+                ssize_t ignored = read(client, discard, sizeof(discard));
+                (void)ignored;
+            }
+
+            string body = renderPrometheus();
+            string response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                              to_string(body.size()) + "\r\n\r\n" + body;
+            size_t sent = 0;
+            while (sent < response.size()) {
+                ssize_t n = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+                if (n <= 0) break;
+                sent += (size_t)n;
+            }
+            close(client);
+        }
+        close(listener);
+        unlink(socketPath.c_str());
+    });
+    return true;
+#endif
+}
+
+void Metrics::stopServing() {
+    if (!server) return;
+    serving = false;
+    server->join();
+    delete server;
+    server = nullptr;
+}
@@ -0,0 +1,202 @@
+#include "Stronghold.h"
+#include <sstream>
+#include <map>
+
+// Holds console text until it is worth a write. Drains into cout, so a
+// caller that mutes cout still mutes the sink.
+class OutputBuffer : public streambuf {
+public:
+    OutputBuffer() : held(nullptr) {
+        setp(data, data + OUTPUT_BUFFER_BYTES);
+    }
+
+    // Drains into `text` instead of cout from now on
+    void holdIn(string* text) {
+        held = text;
+    }
+
+    void drain() {
+        if (pptr() > pbase()) {
+            if (held) {
+                held->append(pbase(), pptr() - pbase());
+            } else {
+                cout.write(pbase(), pptr() - pbase());
+            }
+        }
+        setp(data, data + OUTPUT_BUFFER_BYTES);
+    }
+
+protected:
+    int overflow(int c) override {
+        drain();
+        if (c != traits_type::eof()) {
+            *pptr() = (char)c;
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    int sync() override {
+        drain();
+        if (!held) cout.flush();
+        return 0;
+    }
+
+private:
+    char data[OUTPUT_BUFFER_BYTES];
+    string* held;
+};
+
+// A section or field a holding sink keeps, with the text written before it
+struct HeldEntry {
+    string text;
+    bool isSection;
+    string name;        // Section title or field label
+    string value;       // Fields only
+    const void* owner;  // Sections only
+};
+
+struct OutputState {
+    OutputBuffer buffer;
+    ostream stream;
+    ostringstream value;
+
+    // Current stat block
+    string title;
+    const void* owner;
+    bool titleShown;
+
+    // Last rendered value of every field, for diff mode
+    map<pair<const void*, string>, string> lastValues;
+
+    // What a holding sink keeps for replayInto()
+    bool holding;
+    string heldText;
+    vector<HeldEntry> held;
+
+    OutputState() : stream(&buffer), owner(nullptr), titleShown(false), holding(false) {}
+};
+
+// The sink local() hands out instead of the thread's own, if any
+static thread_local OutputSink* redirected = nullptr;
+
+// Helper to keep a section or field of a holding sink, after the text before it
+static void holdEntry(OutputState& state, bool isSection, const string& name, const string& value) {
+    state.buffer.drain();
+    HeldEntry entry = { state.heldText, isSection, name, value, state.owner };
+    state.held.push_back(entry);
+    state.heldText.clear();
+}
+
+// Constructor starts in buffered mode
+OutputSink::OutputSink(bool holds) {
+    state = new OutputState();
+    mode = OUTPUT_BUFFERED;
+    if (holds) {
+        state->holding = true;
+        state->buffer.holdIn(&state->heldText);
+    }
+}
+
+// Destructor writes out whatever is left and hands any stream tied to the
+// sink back to cout
+OutputSink::~OutputSink() {
+    flush();
+    if (cin.tie() == &state->stream) cin.tie(&cout);
+    if (cerr.tie() == &state->stream) cerr.tie(&cout);
+    delete state;
+}
+
+OutputSink& OutputSink::local() {
+    static thread_local OutputSink sink;
+    return redirected ? *redirected : sink;
+}
+
+OutputSink* OutputSink::redirect(OutputSink* sink) {
+    OutputSink* before = redirected;
+    redirected = sink;
+    return before;
+}
+
+void OutputSink::setMode(OutputMode mode) {
+    this->mode = mode;
+    // A stream without a buffer drops writes before formatting them
+    state->stream.rdbuf(mode == OUTPUT_QUIET ? nullptr : &state->buffer);
+}
+
+OutputMode OutputSink::getMode() const {
+    return mode;
+}
+
+ostream& OutputSink::text() {
+    return state->stream;
+}
+
+void OutputSink::flush() {
+    state->buffer.pubsync();
+}
+
+void OutputSink::replayInto(OutputSink& target) {
+    state->buffer.drain();
+    for (size_t i = 0; i < state->held.size(); i++) {
+        const HeldEntry& entry = state->held[i];
+        target.text() << entry.text;
+        if (entry.isSection) {
+            target.section(entry.name.c_str(), entry.owner);
+        } else {
+            target.field(entry.name.c_str(), entry.value);
+        }
+    }
+    target.text() << state->heldText;
+    state->held.clear();
+    state->heldText.clear();
+}
+
+void OutputSink::section(const char* title, const void* owner) {
+    state->title = title;
+    state->owner = owner;
+    state->titleShown = false;
+    if (state->holding) {
+        if (mode != OUTPUT_QUIET) holdEntry(*state, true, state->title, "");
+        return;
+    }
+    if (mode == OUTPUT_BUFFERED) {
+        state->stream << "\n====== " << title << " ======\n";
+        state->titleShown = true;
+    }
+}
+
+// Helper for field(): hands out the scratch stream the value is formatted into
+ostream& OutputSink::beginField() {
+    state->value.str("");
+    state->value.clear();
+    return state->value;
+}
+
+// Helper for field(): renders the formatted value, or skips it in diff mode
+void OutputSink::endField(const char* label) {
+    string value = state->value.str();
+    if (state->holding) {
+        holdEntry(*state, false, label, value);
+        return;
+    }
+    if (mode == OUTPUT_BUFFERED) {
+        state->stream << label << ": " << value << "\n";
+        return;
+    }
+
+    string& last = state->lastValues[make_pair(state->owner, state->title + "/" + label)];
+    bool firstRender = last.empty();
+    if (!firstRender && last == value) return;
+
+    if (!state->titleShown) {
+        state->stream << "\n====== " << state->title << " ======\n";
+        state->titleShown = true;
+    }
+    state->stream << label << ": " << value;
+    if (!firstRender) {
+        state->stream << " (was " << last << ")";
+    }
+    state->stream << "\n";
+    last = value;
+}
@@ -0,0 +1,207 @@
+#include "Stronghold.h"
+#include <queue>
+#include <vector>
+
+// The 8 neighbour offsets; odd directions are diagonal
+static const int STEP_X[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+static const int STEP_Y[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+static const unsigned char NO_DIRECTION = 255;
+static const unsigned int UNREACHABLE = 0xFFFFFFFFu;
+
+// Cost of entering a tile; 0 means it cannot be entered
+static unsigned int enterCost(unsigned int terrain, int owner, int destinationOwner, bool diagonal) {
+    if (terrain == 0) return 0;
+    unsigned int cost = terrain * (diagonal ? 14u : 10u);
+    // Crossing land held by someone other than the destination's owner is slow
+    if (owner >= 0 && owner != destinationOwner) cost *= 2;
+    return cost;
+}
+
+// Constructor covers the same tiles as the world map, all open plains
+PathfindingService::PathfindingService(const WorldMap& map, int cacheCapacity) {
+    width = map.getWidth();
+    height = map.getHeight();
+    terrainCost.resize((size_t)width * height, 1);
+    tileOwner.resize((size_t)width * height, -1);
+
+    this->cacheCapacity = cacheCapacity > 0 ? cacheCapacity : 1;
+    cache.resize(this->cacheCapacity);
+    cacheSize = 0;
+    useClock = 0;
+    fieldsBuilt = 0;
+}
+
+// Helper method: cost of stepping onto `tile` in the given direction
+unsigned int PathfindingService::stepCost(int tile, int direction, int destinationOwner) const {
+    return enterCost(terrainCost[tile], tileOwner[tile], destinationOwner, (direction & 1) != 0);
+}
+
+// Helper method to run Dijkstra outward from the destination
+void PathfindingService::buildField(FlowField& field) {
+    int tiles = width * height;
+    for (int i = 0; i < tiles; i++) {
+        field.distance[i] = UNREACHABLE;
+        field.direction[i] = NO_DIRECTION;
+    }
+    field.destinationOwner = tileOwner[field.destination];
+    field.distance[field.destination] = 0;
+
+    typedef pair<unsigned int, int> QueueEntry; // (distance, tile)
+    priority_queue<QueueEntry, vector<QueueEntry>, greater<QueueEntry> > open;
+    open.push(QueueEntry(0, field.destination));
+
+    while (!open.empty()) {
+        QueueEntry top = open.top();
+        open.pop();
+        int tile = top.second;
+        if (top.first != field.distance[tile]) continue;
+        // Impassable tiles get a way out but nobody routes through them
+        if (tile != field.destination && terrainCost[tile] == 0) continue;
+
+        int x = tile % width, y = tile / width;
+        for (int d = 0; d < 8; d++) {
+            int nx = x + STEP_X[d], ny = y + STEP_Y[d];
+            if (nx < 0 || ny < 0 || nx >= width || ny >= height) continue;
+
+            // The neighbour would walk back along the opposite direction
+            int neighbour = ny * width + nx;
+            int back = (d + 4) & 7;
+            unsigned int cost = stepCost(tile, back, field.destinationOwner);
+            if (cost == 0) continue;
+
+            unsigned int candidate = top.first + cost;
+            if (candidate < field.distance[neighbour]) {
+                field.distance[neighbour] = candidate;
+                field.direction[neighbour] = (unsigned char)back;
+                open.push(QueueEntry(candidate, neighbour));
+            }
+        }
+    }
+
+    field.stale = false;
+    fieldsBuilt++;
+}
+
+// Helper method to find (or build) the field for a destination
+FlowField& PathfindingService::fieldFor(int destination) {
+    useClock++;
+    for (int i = 0; i < cacheSize; i++) {
+        if (cache[i].destination == destination) {
+            if (cache[i].stale) buildField(cache[i]);
+            cache[i].lastUsed = useClock;
+            return cache[i];
+        }
+    }
+
+    // Not cached: take a free slot or evict the least recently used field
+    FlowField* slot;
+    if (cacheSize < cacheCapacity) {
+        slot = &cache[cacheSize++];
+        slot->distance.resize((size_t)width * height);
+        slot->direction.resize((size_t)width * height);
+    } else {
+        slot = &cache[0];
+        for (int i = 1; i < cacheSize; i++) {
+            if (cache[i].lastUsed < slot->lastUsed) slot = &cache[i];
+        }
+    }
+
+    slot->destination = destination;
+    buildField(*slot);
+    slot->lastUsed = useClock;
+    return *slot;
+}
+
+// Helper method to mark only the fields whose routes a tile edit can change
+void PathfindingService::invalidateAround(int tile, unsigned int oldTerrain, int oldOwner) {
+    int x = tile % width, y = tile / width;
+    int newOwner = tileOwner[tile];
+
+    for (int i = 0; i < cacheSize; i++) {
+        FlowField& field = cache[i];
+        if (field.stale) continue;
+
+        // The destination changing hands changes every cost in the field
+        if (tile == field.destination && newOwner != field.destinationOwner) {
+            field.stale = true;
+            continue;
+        }
+
+        for (int d = 0; d < 8 && !field.stale; d++) {
+            int nx = x + STEP_X[d], ny = y + STEP_Y[d];
+            if (nx < 0 || ny < 0 || nx >= width || ny >= height) continue;
+
+            int neighbour = ny * width + nx;
+            int back = (d + 4) & 7;
+            bool diagonal = (back & 1) != 0;
+            unsigned int oldCost = enterCost(oldTerrain, oldOwner, field.destinationOwner, diagonal);
+            unsigned int newCost = enterCost(terrainCost[tile], newOwner, field.destinationOwner, diagonal);
+            if (oldCost == newCost) continue;
+
+            // Routes that pass through the tile now cost something else
+            if (field.direction[neighbour] == back) {
+                field.stale = true;
+            }
+            // A cheaper tile can offer a neighbour a shorter route
+            else if (newCost != 0 && (oldCost == 0 || newCost < oldCost) &&
+                     field.distance[tile] != UNREACHABLE &&
+                     field.distance[tile] + newCost < field.distance[neighbour]) {
+                field.stale = true;
+            }
+        }
+    }
+}
+
+// Change the cost of entering a tile (0 = impassable)
+void PathfindingService::setTerrainCost(int x, int y, int cost) {
+    if (x < 0 || y < 0 || x >= width || y >= height) return;
+    if (cost < 0) cost = 0;
+    if (cost > 255) cost = 255;
+
+    int tile = y * width + x;
+    unsigned int oldTerrain = terrainCost[tile];
+    if ((int)oldTerrain == cost) return;
+    terrainCost[tile] = (unsigned char)cost;
+    invalidateAround(tile, oldTerrain, tileOwner[tile]);
+}
+
+// Change which kingdom owns a tile (-1 = unclaimed)
+void PathfindingService::setOwner(int x, int y, int kingdomId) {
+    if (x < 0 || y < 0 || x >= width || y >= height) return;
+
+    int tile = y * width + x;
+    int oldOwner = tileOwner[tile];
+    if (oldOwner == kingdomId) return;
+    tileOwner[tile] = kingdomId;
+    invalidateAround(tile, terrainCost[tile], oldOwner);
+}
+
+// Next tile on the way from (x, y) to the destination
+bool PathfindingService::nextStep(int x, int y, int destX, int destY, TilePosition& next) {
+    if (x < 0 || y < 0 || x >= width || y >= height) return false;
+    if (destX < 0 || destY < 0 || destX >= width || destY >= height) return false;
+
+    int tile = y * width + x;
+    int destination = destY * width + destX;
+    next.x = x;
+    next.y = y;
+    if (tile == destination) return true;
+
+    FlowField& field = fieldFor(destination);
+    if (field.distance[tile] == UNREACHABLE) return false;
+
+    int d = field.direction[tile];
+    next.x = x + STEP_X[d];
+    next.y = y + STEP_Y[d];
+    return true;
+}
+
+// Travel cost from (x, y) to the destination (-1 if unreachable)
+int PathfindingService::travelCost(int x, int y, int destX, int destY) {
+    if (x < 0 || y < 0 || x >= width || y >= height) return -1;
+    if (destX < 0 || destY < 0 || destX >= width || destY >= height) return -1;
+
+    FlowField& field = fieldFor(destY * width + destX);
+    unsigned int distance = field.distance[y * width + x];
+    return distance == UNREACHABLE ? -1 : (int)distance;
+}
@@ -9,33 +9,67 @@ Population::Population()
     nobles = 15;
     happiness = 70.0; // 0 to 100 scale
     foodStock = 300.0;
+    seedCohorts();
+}
+
+// Spread the class counters over the age buckets using a typical age profile
+void Population::seedCohorts()
+{
+    static const float ageProfile[COHORT_AGE_BUCKETS] = { 0.20f, 0.18f, 0.25f, 0.20f, 0.12f, 0.05f };
+    int classCounts[COHORT_CLASSES] = { peasants, merchants, nobles };
+
+    for (int age = 0; age < COHORT_AGE_BUCKETS; age++)
+    {
+        for (int cls = 0; cls < COHORT_CLASSES; cls++)
+        {
+            cohorts[age * COHORT_CLASSES + cls] = classCounts[cls] * ageProfile[age];
+        }
+    }
+}
+
+// Rebuild the class counters (and total) from the cohort head counts
+void Population::recountFromCohorts()
+{
+    float classTotals[COHORT_CLASSES] = { 0.0f, 0.0f, 0.0f };
+    for (int age = 0; age < COHORT_AGE_BUCKETS; age++)
+    {
+        for (int cls = 0; cls < COHORT_CLASSES; cls++)
+        {
+            classTotals[cls] += cohorts[age * COHORT_CLASSES + cls];
+        }
+    }
+
+    peasants = (int)(classTotals[0] + 0.5f);
+    merchants = (int)(classTotals[1] + 0.5f);
+    nobles = (int)(classTotals[2] + 0.5f);
+    total = peasants + merchants + nobles;
 }
 
 // Simulate changes in population (growth, illness, revolt)
 void Population::simulate()
 {
-    cout << "\n--- Simulating Population Changes ---\n";
+    console() << "\n--- Simulating Population Changes ---\n";
 
     int foodConsumptionPerPerson = 2; // each person eats 2 units
     int requiredFood = total * foodConsumptionPerPerson;
 
-    cout << "Total population: " << total << endl;
-    cout << "Food required: " << requiredFood << endl;
-    cout << "Food available: " << foodStock << endl;
+    console() << "Total population: " << total << "\n";
+    console() << "Food required: " << requiredFood << "\n";
+    console() << "Food available: " << foodStock << "\n";
+
+    // Share of the food requirement that can actually be met this turn
+    float foodRatio = requiredFood > 0 ? (float)foodStock / requiredFood : 1.0f;
 
     if (foodStock >= requiredFood)
     {
-        cout << "Everyone is well-fed. Population is growing.\n";
+        console() << "Everyone is well-fed. Population is growing.\n";
         foodStock -= requiredFood;
-        total += 10;
         happiness += 5;
     }
     else
     {
         int shortage = requiredFood - foodStock;
-        cout << "Food shortage of " << shortage << " units! People are starving.\n";
-        int deaths = shortage / foodConsumptionPerPerson;
-        total -= deaths;
+        console() << "Food shortage of " << shortage << " units! People are starving.\n";
         happiness -= 10;
         foodStock = 0;
     }
@@ -45,32 +79,34 @@ void Population::simulate()
         happiness = 100;
     if (happiness < 0)
         happiness = 0;
-    if (total < 0)
-        total = 0;
 
-    // Recalculate class distribution
-    peasants = total * 0.6;
-    merchants = total * 0.25;
-    nobles = total * 0.15;
+    // Advance every age bucket and class one turn through the projection matrix
+    const CohortModel& model = CohortModel::shared();
+    model.projectBlock(CohortModel::conditionIndex(foodRatio, happiness), cohorts, cohorts, 1);
+
+    int before = total;
+    recountFromCohorts();
+    console() << "Births and deaths this turn: " << (total - before >= 0 ? "+" : "") << (total - before) << " people.\n";
 
     if (happiness < 30)
     {
-        cout << "Revolt risk! Citizens are angry.\n";
-        int revoltLoss = rand() % 10;
-        total -= revoltLoss;
-        cout << revoltLoss << " people lost in revolt.\n";
+        console() << "Revolt risk! Citizens are angry.\n";
+        int revoltLoss = GameRandom::local().nextInt(10);
+        decrease(revoltLoss);
+        console() << revoltLoss << " people lost in revolt.\n";
     }
 }
 
 // Display population stats
 void Population::showStats() const
 {
-    cout << "\n====== Population Stats ======\n";
-    cout << "Total Population: " << total << endl;
-    cout << " Peasants: " << peasants << endl;
-    cout << " Merchants: " << merchants << endl;
-    cout << " Nobles: " << nobles << endl;
-    cout << " Happiness: " << happiness << "%\n";
+    OutputSink& sink = OutputSink::local();
+    sink.section("Population Stats", this);
+    sink.field("Total Population", total);
+    sink.field(" Peasants", peasants);
+    sink.field(" Merchants", merchants);
+    sink.field(" Nobles", nobles);
+    sink.field(" Happiness", happiness, "%");
 }
 
 // Save to file
@@ -89,7 +125,7 @@ void Population::saveToFile() const
     out << nobles << endl;
     out << happiness << endl;
     out.close();
-    cout << "Population data saved successfully.\n";
+    console() << "Population data saved successfully.\n";
 }
 
 // Load from file
@@ -104,7 +140,8 @@ void Population::loadFromFile()
 
     in >> total >> peasants >> merchants >> nobles >> happiness;
     in.close();
-    cout << "Population data loaded successfully.\n";
+    seedCohorts();
+    console() << "Population data loaded successfully.\n";
 }
 
 // Get total population
@@ -113,16 +150,58 @@ int Population::getTotal() const
     return total;
 }
 
-// Decrease population
+// Decrease population (removed evenly across every age bucket and class)
 void Population::decrease(int amount)
 {
-    total -= amount;
-    if (total < 0)
+    if (amount <= 0 || total <= 0)
     {
-        total = 0;
+        return;
     }
 
-    peasants = total * 0.6;
-    merchants = total * 0.25;
-    nobles = total * 0.15;
+    float keep = amount >= total ? 0.0f : (float)(total - amount) / total;
+    for (int i = 0; i < COHORT_SIZE; i++)
+    {
+        cohorts[i] *= keep;
+    }
+
+    recountFromCohorts();
+}
+
+// Copy the population state into a snapshot record
+void Population::exportState(KingdomRecord& record) const
+{
+    record.total = total;
+    record.peasants = peasants;
+    record.merchants = merchants;
+    record.nobles = nobles;
+    record.foodStock = foodStock;
+    record.happiness = happiness;
+    for (int i = 0; i < COHORT_SIZE; i++)
+    {
+        record.cohorts[i] = cohorts[i];
+    }
+}
+
+// Restore the population state from a snapshot record
+void Population::importState(const KingdomRecord& record)
+{
+    total = record.total;
+    peasants = record.peasants;
+    merchants = record.merchants;
+    nobles = record.nobles;
+    foodStock = record.foodStock;
+    happiness = record.happiness;
+
+    float cohortTotal = 0.0f;
+    for (int i = 0; i < COHORT_SIZE; i++)
+    {
+        cohorts[i] = record.cohorts[i];
+        cohortTotal += cohorts[i];
+    }
+
+    // Records without age data get the default age profile
+    if (cohortTotal <= 0.0f && total > 0)
+    {
+        seedCohorts();
+    }
 }
@@ -0,0 +1,38 @@
+#include "Stronghold.h"
+
+// Constructor starts the stream at `seed`
+GameRandom::GameRandom(uint64_t seed) {
+    state = seed;
+}
+
+void GameRandom::seed(uint64_t seed) {
+    state = seed;
+}
+
+uint64_t GameRandom::getState() const {
+    return state;
+}
+
+void GameRandom::setState(uint64_t state) {
+    this->state = state;
+}
+
+// SplitMix64 step
+uint64_t GameRandom::next() {
+    state += 0x9E3779B97F4A7C15ULL;
+    uint64_t z = state;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Multiply-shift keeps the draw unbiased enough for game rules without a loop
+int GameRandom::nextInt(int bound) {
+    if (bound <= 0) return 0;
+    return (int)(((next() >> 32) * (uint64_t)bound) >> 32);
+}
+
+GameRandom& GameRandom::local() {
+    static thread_local GameRandom stream;
+    return stream;
+}
@@ -0,0 +1,394 @@
+#include "Stronghold.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+// A replay log is a header followed by tagged records:
+//
+//   header    REPLAY_MAGIC, version, keyframe interval, sizeof(KingdomRecord)
+//   TURN      turn, random-stream state as the turn starts
+//   KEYFRAME  full GameKeyframe (follows the TURN record of its turn)
+//   ANSWER    value, valid
+//
+// Fields are written in the writer's byte order, like binary scenarios.
+const unsigned char REPLAY_TAG_TURN = 1;
+const unsigned char REPLAY_TAG_ANSWER = 2;
+const unsigned char REPLAY_TAG_KEYFRAME = 3;
+
+template<typename T>
+static void appendValue(string& out, const T& value) {
+    out.append((const char*)&value, sizeof(T));
+}
+
+template<typename T>
+static bool readValue(FILE* file, T& value) {
+    return fread(&value, sizeof(T), 1, file) == 1;
+}
+
+// Helper to serialize a keyframe; also used to compare two keyframes byte for byte
+static void appendKeyframe(string& out, const GameKeyframe& keyframe) {
+    appendValue(out, (int32_t)keyframe.turn);
+    appendValue(out, keyframe.rngState);
+    appendValue(out, keyframe.kingdom);
+    appendValue(out, (uint32_t)keyframe.loans.size());
+    for (size_t i = 0; i < keyframe.loans.size(); i++) {
+        appendValue(out, keyframe.loans[i]);
+    }
+    appendValue(out, (int32_t)keyframe.marchX);
+    appendValue(out, (int32_t)keyframe.marchY);
+    appendValue(out, (int32_t)keyframe.marching);
+
+    const TreasuryMonitor::KingdomStats& monitor = keyframe.monitor;
+    appendValue(out, (int32_t)monitor.lastTreasury);
+    appendValue(out, (int32_t)monitor.seen);
+    appendValue(out, monitor.treasuryDeltas);
+    appendValue(out, monitor.spending);
+    appendValue(out, (int32_t)monitor.pendingAlerts);
+    appendValue(out, (int32_t)monitor.worstDrop);
+}
+
+// Helper to read a keyframe written by appendKeyframe
+static bool readKeyframe(FILE* file, GameKeyframe& keyframe) {
+    int32_t turn, marchX, marchY, marching;
+    uint32_t loanCount;
+    if (!readValue(file, turn) || !readValue(file, keyframe.rngState) ||
+        !readValue(file, keyframe.kingdom) || !readValue(file, loanCount)) {
+        return false;
+    }
+    keyframe.loans.resize(loanCount);
+    for (uint32_t i = 0; i < loanCount; i++) {
+        if (!readValue(file, keyframe.loans[i])) return false;
+    }
+    if (!readValue(file, marchX) || !readValue(file, marchY) || !readValue(file, marching)) {
+        return false;
+    }
+
+    TreasuryMonitor::KingdomStats& monitor = keyframe.monitor;
+    int32_t lastTreasury, seen, pendingAlerts, worstDrop;
+    if (!readValue(file, lastTreasury) || !readValue(file, seen) ||
+        !readValue(file, monitor.treasuryDeltas) || !readValue(file, monitor.spending) ||
+        !readValue(file, pendingAlerts) || !readValue(file, worstDrop)) {
+        return false;
+    }
+    keyframe.turn = turn;
+    keyframe.marchX = marchX;
+    keyframe.marchY = marchY;
+    keyframe.marching = marching != 0;
+    monitor.lastTreasury = lastTreasury;
+    monitor.seen = seen != 0;
+    monitor.pendingAlerts = pendingAlerts;
+    monitor.worstDrop = worstDrop;
+    return true;
+}
+
+// ========== Recording ==========
+
+ReplayRecorder::ReplayRecorder(InputProvider& source, const StrongholdGame& game)
+    : source(source), game(game) {
+    file = nullptr;
+    keyframeInterval = REPLAY_DEFAULT_KEYFRAME_INTERVAL;
+    firstTurn = -1;
+    lastTurn = -1;
+}
+
+ReplayRecorder::~ReplayRecorder() {
+    if (file) fclose(file);
+}
+
+// Start a new log at `path`; must succeed before anything is recorded
+bool ReplayRecorder::open(const string& path, int keyframeInterval) {
+    if (file) fclose(file);
+    file = fopen(path.c_str(), "wb");
+    if (!file) {
+        cerr << "Error: Could not open " << path << " for the replay log.\n";
+        return false;
+    }
+
+    string header(REPLAY_MAGIC, 8);
+    appendValue(header, REPLAY_VERSION);
+    appendValue(header, (int32_t)keyframeInterval);
+    appendValue(header, (uint32_t)sizeof(KingdomRecord));
+    fwrite(header.data(), 1, header.size(), file);
+
+    this->keyframeInterval = keyframeInterval;
+    firstTurn = -1;
+    lastTurn = -1;
+    return true;
+}
+
+// Helper to note the start of a turn, with a keyframe every interval and
+// after a rewind
+void ReplayRecorder::beginTurn() {
+    int turn = game.getTurn();
+    bool rewound = turn < lastTurn;
+    lastTurn = turn;
+    if (firstTurn < 0) firstTurn = turn;
+
+    string record;
+    record += (char)REPLAY_TAG_TURN;
+    appendValue(record, (int32_t)turn);
+    appendValue(record, GameRandom::local().getState());
+
+    if (rewound || (turn - firstTurn) % keyframeInterval == 0) {
+        GameKeyframe keyframe;
+        game.captureKeyframe(keyframe);
+        record += (char)REPLAY_TAG_KEYFRAME;
+        appendKeyframe(record, keyframe);
+    }
+    fwrite(record.data(), 1, record.size(), file);
+}
+
+bool ReplayRecorder::readInt(const char* prompt, int& value) {
+    if (file && game.getTurn() != lastTurn) beginTurn();
+
+    bool valid = source.readInt(prompt, value);
+    if (file && (valid || !source.exhausted())) {
+        string record;
+        record += (char)REPLAY_TAG_ANSWER;
+        appendValue(record, (int32_t)(valid ? value : 0));
+        appendValue(record, (unsigned char)valid);
+        fwrite(record.data(), 1, record.size(), file);
+        fflush(file); // Keep every answer if the game is killed
+    }
+    return valid;
+}
+
+bool ReplayRecorder::exhausted() const {
+    return source.exhausted();
+}
+
+bool ReplayRecorder::showsPrompts() const {
+    return source.showsPrompts();
+}
+
+// ========== Reading ==========
+
+// Load a log written by ReplayRecorder, replacing anything held. A record cut
+// short at the end (the game was killed mid-write) is dropped with a warning.
+bool ReplayLog::load(const string& path) {
+    this->path = path;
+    turns.clear();
+    answers.clear();
+    keyframes.clear();
+    keyframeEntries.clear();
+
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        cerr << "Error: Could not open replay log " << path << ".\n";
+        return false;
+    }
+
+    char magic[8];
+    uint32_t version, recordSize;
+    int32_t interval;
+    if (fread(magic, 1, 8, file) != 8 || memcmp(magic, REPLAY_MAGIC, 8) != 0 ||
+        !readValue(file, version) || !readValue(file, interval) || !readValue(file, recordSize)) {
+        cerr << "Error: " << path << " is not a replay log.\n";
+        fclose(file);
+        return false;
+    }
+    if (version != REPLAY_VERSION || recordSize != sizeof(KingdomRecord)) {
+        cerr << "Error: " << path << " was written by a different version of the game.\n";
+        fclose(file);
+        return false;
+    }
+
+    bool complete = true;
+    unsigned char tag;
+    while (complete && readValue(file, tag)) {
+        if (tag == REPLAY_TAG_TURN) {
+            int32_t turn;
+            uint64_t rngState;
+            complete = readValue(file, turn) && readValue(file, rngState);
+            if (complete) {
+                TurnEntry entry = { turn, rngState, answers.size() };
+                turns.push_back(entry);
+            }
+        } else if (tag == REPLAY_TAG_ANSWER) {
+            int32_t value;
+            unsigned char valid;
+            complete = readValue(file, value) && readValue(file, valid);
+            if (complete) {
+                InputAnswer answer = { value, valid != 0 };
+                answers.push_back(answer);
+            }
+        } else if (tag == REPLAY_TAG_KEYFRAME) {
+            GameKeyframe keyframe;
+            complete = readKeyframe(file, keyframe);
+            if (complete && (turns.empty() || turns.back().turn != keyframe.turn)) {
+                cerr << "Error: " << path << " holds a keyframe outside its turn.\n";
+                fclose(file);
+                return false;
+            }
+            if (complete) {
+                keyframes.push_back(keyframe);
+                keyframeEntries.push_back(turns.size() - 1);
+            }
+        } else {
+            cerr << "Error: " << path << " holds an unknown record.\n";
+            fclose(file);
+            return false;
+        }
+    }
+    fclose(file);
+
+    if (!complete) {
+        cerr << "Warning: " << path << " ends part way through a record; the rest was dropped.\n";
+    }
+    if (keyframes.empty()) {
+        cerr << "Error: " << path << " holds no keyframes.\n";
+        return false;
+    }
+    return true;
+}
+
+int ReplayLog::getFirstTurn() const {
+    return turns.empty() ? 0 : turns.front().turn;
+}
+
+int ReplayLog::getLastTurn() const {
+    return turns.empty() ? 0 : turns.back().turn;
+}
+
+size_t ReplayLog::getKeyframeCount() const {
+    return keyframes.size();
+}
+
+// ========== Replay ==========
+
+bool ReplayLog::replaySegment(StrongholdGame& game, size_t k, size_t endEntry, string& problem) const {
+    size_t entry = keyframeEntries[k];
+    ReplayInput input;
+    for (size_t i = turns[entry].firstAnswer; i < turns[endEntry].firstAnswer; i++) {
+        input.add(answers[i]);
+    }
+
+    // Replay quietly; answers asked for mid-turn come from the log too
+    OutputSink& sink = OutputSink::local();
+    OutputMode mode = sink.getMode();
+    sink.setMode(OUTPUT_QUIET);
+    InputProvider* previous = &InputProvider::local();
+    InputProvider::setLocal(&input);
+
+    // The log notes a turn when the first answer of it is asked for, which is
+    // when playChoice returns having changed the turn. A restored game cannot
+    // rewind to before its keyframe, so a segment ending in such a rewind
+    // stops once its answers are used up.
+    game.restoreKeyframe(keyframes[k]);
+    bool endsInRewind = endEntry > 0 && turns[endEntry].turn < turns[endEntry - 1].turn;
+    bool ok = true;
+    while (ok && entry < endEntry) {
+        if (!game.playChoice(input)) {
+            if (endsInRewind && input.exhausted()) break;
+            problem = "the game ended before turn " + to_string(turns[endEntry].turn);
+            ok = false;
+            break;
+        }
+
+        int turn = game.getTurn();
+        if (turn == turns[entry].turn) continue;
+        entry++;
+        if (turns[entry].turn != turn) {
+            problem = "the replay moved to turn " + to_string(turn) + " where the log moved to turn " +
+                      to_string(turns[entry].turn);
+            ok = false;
+        } else if (GameRandom::local().getState() != turns[entry].rngState) {
+            problem = "the random stream differs at the start of turn " + to_string(turn);
+            ok = false;
+        }
+    }
+
+    InputProvider::setLocal(previous);
+    sink.setMode(mode);
+    return ok;
+}
+
+bool ReplayLog::seek(StrongholdGame& game, int turn) const {
+    size_t endEntry = turns.size();
+    while (endEntry > 0 && turns[endEntry - 1].turn != turn) endEntry--;
+    if (endEntry == 0) {
+        cerr << "Error: " << path << " never reaches turn " << turn << ".\n";
+        return false;
+    }
+    endEntry--;
+
+    size_t k = keyframes.size() - 1;
+    while (k > 0 && keyframeEntries[k] > endEntry) k--;
+    if (keyframeEntries[k] > endEntry) {
+        cerr << "Error: " << path << " has no keyframe before turn " << turn << ".\n";
+        return false;
+    }
+
+    string problem;
+    if (!replaySegment(game, k, endEntry, problem)) {
+        cerr << "Error: Replay of " << path << " diverged: " << problem << ".\n";
+        return false;
+    }
+    return true;
+}
+
+int ReplayLog::verify(int threads) const {
+    // Segment i runs from keyframe i to the next keyframe, or to the last turn
+    int segments = (int)keyframes.size();
+    int threadCount = threads > 0 ? threads : (int)thread::hardware_concurrency();
+    if (threadCount < 1) threadCount = 1;
+    int workers = threadCount < segments ? threadCount : segments;
+
+    atomic<int> nextSegment(0);
+    atomic<int> diverged(0);
+    mutex reportLock;
+    auto worker = [&]() {
+        int segment;
+        while ((segment = nextSegment.fetch_add(1)) < segments) {
+            ScopedTrace span("replay.segment");
+            bool last = segment + 1 == segments;
+            size_t endEntry = last ? turns.size() - 1 : keyframeEntries[segment + 1];
+
+            // Each segment saves to its own files so "Save" and "Load" stay apart
+            string savePath = path + ".segment" + to_string(segment) + ".save";
+            string scorePath = path + ".segment" + to_string(segment) + ".score";
+            string problem;
+            bool ok;
+            {
+                StrongholdGame game(GAME_DEFAULT_SEED, savePath, scorePath);
+                game.setRivalThreads(0); // Rivals never touch the player's kingdom
+                ok = replaySegment(game, segment, endEntry, problem);
+                // Only the random stream is checked when the segment stopped short of a rewind
+                if (ok && !last && game.getTurn() == keyframes[segment + 1].turn) {
+                    GameKeyframe reached;
+                    game.captureKeyframe(reached);
+                    string expected, actual;
+                    appendKeyframe(expected, keyframes[segment + 1]);
+                    appendKeyframe(actual, reached);
+                    if (actual != expected) {
+                        problem = "the kingdom at turn " + to_string(turns[endEntry].turn) + " differs from its keyframe";
+                        ok = false;
+                    }
+                }
+            }
+            remove(savePath.c_str());
+            remove(scorePath.c_str());
+
+            if (!ok) {
+                diverged.fetch_add(1);
+                lock_guard<mutex> guard(reportLock);
+                cerr << "Turns " << keyframes[segment].turn << " to " << turns[endEntry].turn
+                     << " diverged: " << problem << ".\n";
+            }
+        }
+    };
+
+    SmallVector<thread, INLINE_THREADS> pool((size_t)(workers > 1 ? workers - 1 : 0));
+    for (int t = 0; t < workers - 1; t++) {
+        pool[t] = thread([&]() {
+            Trace::setThreadName("replay verifier");
+            worker();
+        });
+    }
+    worker();
+    for (int t = 0; t < workers - 1; t++) {
+        pool[t].join();
+    }
+    return diverged.load();
+}
@@ -0,0 +1,580 @@
+#include "Stronghold.h"
+#include <cstring>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+// Records are compared and sent as 32-bit words
+const int RECORD_WORDS = (int)(sizeof(KingdomRecord) / sizeof(uint32_t));
+const int RECORD_GROUPS = (RECORD_WORDS + 7) / 8;
+static_assert(sizeof(KingdomRecord) % sizeof(uint32_t) == 0, "KingdomRecord must be whole words");
+static_assert(RECORD_GROUPS <= 64, "Group mask must fit a 64-bit varint");
+
+// Frame header: length, type, sequence, base sequence, turn
+const size_t FRAME_HEADER_BYTES = 4 + 1 + 4 + 4 + 4;
+
+// ========== Encoding ==========
+
+static void appendVarint(string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += (char)(value | 0x80);
+        value >>= 7;
+    }
+    out += (char)value;
+}
+
+static bool readVarint(const char*& cursor, const char* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && cursor < end; shift += 7) {
+        unsigned char byte = (unsigned char)*cursor++;
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+template<typename T>
+static void appendValue(string& out, const T& value) {
+    out.append((const char*)&value, sizeof(T));
+}
+
+// Helper to append one kingdom's changed words; false if nothing changed
+static bool appendKingdomChanges(string& out, const uint32_t* before, const uint32_t* after) {
+    uint64_t groups = 0;
+    unsigned char masks[RECORD_GROUPS];
+    memset(masks, 0, sizeof(masks));
+    for (int w = 0; w < RECORD_WORDS; w++) {
+        if (before[w] != after[w]) {
+            masks[w / 8] |= (unsigned char)(1 << (w % 8));
+            groups |= (uint64_t)1 << (w / 8);
+        }
+    }
+    if (groups == 0) return false;
+
+    appendVarint(out, groups);
+    for (int g = 0; g < RECORD_GROUPS; g++) {
+        if (masks[g]) out += (char)masks[g];
+    }
+    for (int w = 0; w < RECORD_WORDS; w++) {
+        if (before[w] == after[w]) continue;
+        int32_t delta = (int32_t)(after[w] - before[w]);
+        appendVarint(out, ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31)); // Zigzag
+    }
+    return true;
+}
+
+void appendReplicationFrame(string& out, uint8_t type, uint32_t sequence, uint32_t baseSequence,
+                            uint32_t turn, const PersistentVector<KingdomRecord>& base,
+                            const PersistentVector<KingdomRecord>& world) {
+    size_t start = out.size();
+    appendValue(out, (uint32_t)0); // Length, filled in below
+    out += (char)type;
+    appendValue(out, sequence);
+    appendValue(out, baseSequence);
+    appendValue(out, turn);
+    appendVarint(out, world.size());
+
+    // Changes go after the count, which is only known at the end
+    string changes;
+    size_t changed = 0;
+    size_t previous = 0;
+    KingdomRecord zero;
+    memset(&zero, 0, sizeof(zero));
+    uint32_t before[RECORD_WORDS], after[RECORD_WORDS];
+    world.forEachChanged(base, [&](size_t kingdom) {
+        memcpy(before, kingdom < base.size() ? &base[kingdom] : &zero, sizeof(KingdomRecord));
+        memcpy(after, &world[kingdom], sizeof(KingdomRecord));
+        size_t mark = changes.size();
+        appendVarint(changes, changed == 0 ? kingdom : kingdom - previous - 1);
+        if (appendKingdomChanges(changes, before, after)) {
+            changed++;
+            previous = kingdom;
+        } else {
+            changes.resize(mark);
+        }
+    });
+    appendVarint(out, changed);
+    out += changes;
+
+    uint32_t length = (uint32_t)(out.size() - start - 4);
+    memcpy(&out[start], &length, sizeof(length));
+}
+
+int applyReplicationChanges(const char* data, size_t length, PersistentVector<KingdomRecord>& world) {
+    const char* cursor = data;
+    const char* end = data + length;
+    uint64_t kingdoms, changed;
+    if (!readVarint(cursor, end, kingdoms) || !readVarint(cursor, end, changed) || kingdoms > (uint64_t)INT32_MAX) {
+        return -1;
+    }
+    KingdomRecord zero;
+    memset(&zero, 0, sizeof(zero));
+    world.resize((size_t)kingdoms, zero);
+
+    uint64_t kingdom = 0;
+    for (uint64_t c = 0; c < changed; c++) {
+        uint64_t gap, groups;
+        if (!readVarint(cursor, end, gap)) return -1;
+        kingdom = c == 0 ? gap : kingdom + gap + 1;
+        if (kingdom >= kingdoms || !readVarint(cursor, end, groups) || groups >> RECORD_GROUPS) return -1;
+
+        unsigned char masks[RECORD_GROUPS];
+        for (int g = 0; g < RECORD_GROUPS; g++) {
+            masks[g] = 0;
+            if (groups & ((uint64_t)1 << g)) {
+                if (cursor >= end) return -1;
+                masks[g] = (unsigned char)*cursor++;
+            }
+        }
+
+        uint32_t words[RECORD_WORDS];
+        KingdomRecord& record = world.edit((size_t)kingdom);
+        memcpy(words, &record, sizeof(KingdomRecord));
+        for (int w = 0; w < RECORD_WORDS; w++) {
+            if (!(masks[w / 8] & (1 << (w % 8)))) continue;
+            uint64_t zigzag;
+            if (!readVarint(cursor, end, zigzag)) return -1;
+            int32_t delta = (int32_t)((uint32_t)(zigzag >> 1) ^ (uint32_t)-(int32_t)(zigzag & 1));
+            words[w] += (uint32_t)delta;
+        }
+        memcpy(&record, words, sizeof(KingdomRecord));
+    }
+    return cursor == end ? (int)changed : -1;
+}
+
+// ========== Publisher ==========
+
+struct ReplicationPublish {
+    uint32_t sequence;
+    uint32_t turn;
+    PersistentVector<KingdomRecord> world;
+};
+
+struct ReplicationSlot {
+    int fd;
+    string outbox;
+    bool acknowledged;      // Has acknowledged a frame it can still be sent a delta against
+    uint32_t ackedSequence;
+    uint32_t sentSequence;
+    int framesSinceFull;
+    char ack[4];
+    int ackBytes;
+};
+
+struct ReplicationState {
+    int fullEvery;
+    int listener;
+    int wakePipe[2];
+    string socketPath;
+    thread* sender;
+    atomic<bool> stopping;
+
+    mutex lock;             // Guards the two below
+    deque<ReplicationPublish> history; // Newest last
+    uint32_t nextSequence;
+
+    vector<ReplicationSlot*> slots; // Sender thread only
+    atomic<size_t> subscriberCount;
+    atomic<uint64_t> bytesSent;
+};
+
+#ifndef _WIN32
+
+// Helper to write what the socket takes; false if the subscriber is gone
+static bool flushSlot(ReplicationState& state, ReplicationSlot& slot) {
+    size_t sent = 0;
+    while (sent < slot.outbox.size()) {
+        ssize_t n = send(slot.fd, slot.outbox.data() + sent, slot.outbox.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (n <= 0) return false;
+        sent += (size_t)n;
+    }
+    slot.outbox.erase(0, sent);
+    state.bytesSent.fetch_add(sent, memory_order_relaxed);
+    return true;
+}
+
+// Helper to queue the newest publish for one subscriber. Frames against the
+// same base are encoded once per round and shared through `encoded`.
+static void queueLatest(ReplicationState& state, ReplicationSlot& slot, const deque<ReplicationPublish>& history,
+                        map<uint32_t, string>& encoded) {
+    const ReplicationPublish& latest = history.back();
+    if (slot.sentSequence == latest.sequence || slot.outbox.size() > REPLICATION_MAX_BACKLOG) return;
+
+    const ReplicationPublish* base = nullptr;
+    if (slot.acknowledged && slot.framesSinceFull < state.fullEvery) {
+        for (size_t i = 0; i < history.size(); i++) {
+            if (history[i].sequence == slot.ackedSequence) base = &history[i];
+        }
+    }
+
+    uint32_t key = base ? base->sequence : REPLICATION_NEED_FULL;
+    map<uint32_t, string>::iterator frame = encoded.find(key);
+    if (frame == encoded.end()) {
+        string bytes;
+        if (base) {
+            appendReplicationFrame(bytes, REPLICATION_DELTA, latest.sequence, base->sequence, latest.turn,
+                                   base->world, latest.world);
+        } else {
+            appendReplicationFrame(bytes, REPLICATION_FULL, latest.sequence, 0, latest.turn,
+                                   PersistentVector<KingdomRecord>(), latest.world);
+        }
+        frame = encoded.insert(make_pair(key, bytes)).first;
+    }
+
+    slot.outbox += frame->second;
+    slot.sentSequence = latest.sequence;
+    slot.framesSinceFull = base ? slot.framesSinceFull + 1 : 1;
+}
+
+// Helper to read acknowledgements; false if the subscriber is gone
+static bool readAcks(ReplicationSlot& slot) {
+    char buffer[256];
+    while (true) {
+        ssize_t n = recv(slot.fd, buffer, sizeof(buffer), 0);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        if (n <= 0) return false;
+        for (ssize_t i = 0; i < n; i++) {
+            slot.ack[slot.ackBytes++] = buffer[i];
+            if (slot.ackBytes < 4) continue;
+            uint32_t sequence;
+            memcpy(&sequence, slot.ack, sizeof(sequence));
+            slot.ackBytes = 0;
+            slot.acknowledged = sequence != REPLICATION_NEED_FULL;
+            slot.ackedSequence = sequence;
+            if (!slot.acknowledged) slot.sentSequence = REPLICATION_NEED_FULL; // Resend even if current
+        }
+    }
+}
+
+static void runSender(ReplicationState& state) {
+    Trace::setThreadName("replication sender");
+    vector<pollfd> waiting;
+    while (!state.stopping.load()) {
+        waiting.clear();
+        pollfd listener = { state.listener, POLLIN, 0 };
+        pollfd wake = { state.wakePipe[0], POLLIN, 0 };
+        waiting.push_back(listener);
+        waiting.push_back(wake);
+        for (size_t i = 0; i < state.slots.size(); i++) {
+            pollfd subscriber = { state.slots[i]->fd, (short)(POLLIN | (state.slots[i]->outbox.empty() ? 0 : POLLOUT)), 0 };
+            waiting.push_back(subscriber);
+        }
+        if (poll(waiting.data(), waiting.size(), 200) <= 0) continue;
+
+        // New subscribers start with a full frame of the newest publish
+        bool newcomers = false;
+        if (waiting[0].revents & POLLIN) {
+            int fd;
+            while ((fd = accept(state.listener, nullptr, nullptr)) >= 0) {
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                ReplicationSlot* slot = new ReplicationSlot();
+                slot->fd = fd;
+                slot->acknowledged = false;
+                slot->ackedSequence = 0;
+                slot->sentSequence = REPLICATION_NEED_FULL;
+                slot->framesSinceFull = 0;
+                slot->ackBytes = 0;
+                state.slots.push_back(slot);
+                newcomers = true;
+            }
+            state.subscriberCount.store(state.slots.size());
+        }
+        bool published = false;
+        if (waiting[1].revents & POLLIN) {
+            char drain[64];
+            while (read(state.wakePipe[0], drain, sizeof(drain)) > 0) {
+            }
+            published = true;
+        }
+
+        // Acknowledgements first, so this round's deltas use the newest bases
+        for (size_t i = 0; i < state.slots.size(); i++) {
+            ReplicationSlot* slot = state.slots[i];
+            bool alive = true;
+            if (i + 2 < waiting.size() && (waiting[i + 2].revents & (POLLIN | POLLHUP | POLLERR))) {
+                alive = readAcks(*slot);
+            }
+            if (!alive) {
+                close(slot->fd);
+                delete slot;
+                state.slots[i] = state.slots.back();
+                state.slots.pop_back();
+                waiting[i + 2] = waiting.back(); // Keep the poll results lined up with the slots
+                waiting.pop_back();
+                i--;
+            }
+        }
+        state.subscriberCount.store(state.slots.size());
+
+        if (published || newcomers) {
+            deque<ReplicationPublish> history;
+            {
+                lock_guard<mutex> guard(state.lock);
+                history = state.history; // O(1) per publish: the worlds share their chunks
+            }
+            if (!history.empty()) {
+                ScopedTrace span("replication.encode");
+                map<uint32_t, string> encoded;
+                for (size_t i = 0; i < state.slots.size(); i++) {
+                    queueLatest(state, *state.slots[i], history, encoded);
+                }
+            }
+        }
+
+        for (size_t i = 0; i < state.slots.size(); i++) {
+            ReplicationSlot* slot = state.slots[i];
+            if (!slot->outbox.empty() && !flushSlot(state, *slot)) {
+                close(slot->fd);
+                delete slot;
+                state.slots[i] = state.slots.back();
+                state.slots.pop_back();
+                i--;
+            }
+        }
+        state.subscriberCount.store(state.slots.size());
+    }
+}
+
+#endif
+
+ReplicationPublisher::ReplicationPublisher(int fullEvery) {
+    state = new ReplicationState();
+    state->fullEvery = fullEvery > 0 ? fullEvery : REPLICATION_DEFAULT_FULL_EVERY;
+    state->listener = -1;
+    state->wakePipe[0] = -1;
+    state->wakePipe[1] = -1;
+    state->sender = nullptr;
+    state->stopping = false;
+    state->nextSequence = 1;
+    state->subscriberCount = 0;
+    state->bytesSent = 0;
+}
+
+// Destructor stops the sender and disconnects every subscriber
+ReplicationPublisher::~ReplicationPublisher() {
+#ifndef _WIN32
+    if (state->sender) {
+        state->stopping = true;
+        char wake = 1;
+        ssize_t ignored = write(state->wakePipe[1], &wake, 1);
+        (void)ignored;
+        state->sender->join();
+        delete state->sender;
+    }
+    for (size_t i = 0; i < state->slots.size(); i++) {
+        close(state->slots[i]->fd);
+        delete state->slots[i];
+    }
+    if (state->listener >= 0) {
+        close(state->listener);
+        unlink(state->socketPath.c_str());
+    }
+    if (state->wakePipe[0] >= 0) close(state->wakePipe[0]);
+    if (state->wakePipe[1] >= 0) close(state->wakePipe[1]);
+#endif
+    delete state;
+}
+
+bool ReplicationPublisher::listen(const string& socketPath) {
+#ifdef _WIN32
+    (void)socketPath;
+    cerr << "Error: Replication sockets are not supported on this platform.\n";
+    return false;
+#else
+    if (state->sender) return false;
+
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        cerr << "Error: Replication socket path is too long.\n";
+        return false;
+    }
+    strcpy(address.sun_path, socketPath.c_str());
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socketPath.c_str());
+    if (listener < 0 || bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || ::listen(listener, 128) != 0 ||
+        pipe(state->wakePipe) != 0) {
+        if (listener >= 0) close(listener);
+        cerr << "Error: Could not listen for spectators on " << socketPath << ".\n";
+        return false;
+    }
+    fcntl(listener, F_SETFL, fcntl(listener, F_GETFL) | O_NONBLOCK);
+    fcntl(state->wakePipe[0], F_SETFL, fcntl(state->wakePipe[0], F_GETFL) | O_NONBLOCK);
+    fcntl(state->wakePipe[1], F_SETFL, fcntl(state->wakePipe[1], F_GETFL) | O_NONBLOCK);
+    state->listener = listener;
+    state->socketPath = socketPath;
+    state->sender = new thread(runSender, ref(*state));
+    return true;
+#endif
+}
+
+void ReplicationPublisher::publish(uint32_t turn, const PersistentVector<KingdomRecord>& world) {
+    {
+        lock_guard<mutex> guard(state->lock);
+        ReplicationPublish entry = { state->nextSequence++, turn, world };
+        state->history.push_back(entry);
+        if (state->history.size() > (size_t)REPLICATION_HISTORY) state->history.pop_front();
+    }
+#ifndef _WIN32
+    if (state->sender) {
+        char wake = 1;
+        ssize_t ignored = write(state->wakePipe[1], &wake, 1); // A full pipe already means "wake up"
+        (void)ignored;
+    }
+#endif
+}
+
+size_t ReplicationPublisher::getSubscriberCount() const {
+    return state->subscriberCount.load();
+}
+
+uint64_t ReplicationPublisher::getBytesSent() const {
+    return state->bytesSent.load();
+}
+
+// ========== Subscriber ==========
+
+ReplicationSubscriber::ReplicationSubscriber() {
+    fd = -1;
+    lastFull = false;
+    lastBytes = 0;
+    lastChanged = 0;
+}
+
+ReplicationSubscriber::~ReplicationSubscriber() {
+#ifndef _WIN32
+    if (fd >= 0) close(fd);
+#endif
+}
+
+bool ReplicationSubscriber::connect(const string& socketPath) {
+#ifdef _WIN32
+    (void)socketPath;
+    cerr << "Error: Replication sockets are not supported on this platform.\n";
+    return false;
+#else
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        cerr << "Error: Replication socket path is too long.\n";
+        return false;
+    }
+    strcpy(address.sun_path, socketPath.c_str());
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || ::connect(fd, (sockaddr*)&address, sizeof(address)) != 0) {
+        cerr << "Error: Could not connect to " << socketPath << ".\n";
+        if (fd >= 0) close(fd);
+        fd = -1;
+        return false;
+    }
+    return true;
+#endif
+}
+
+bool ReplicationSubscriber::acknowledge(uint32_t sequence) {
+#ifdef _WIN32
+    (void)sequence;
+    return false;
+#else
+    return send(fd, &sequence, sizeof(sequence), MSG_NOSIGNAL) == (ssize_t)sizeof(sequence);
+#endif
+}
+
+bool ReplicationSubscriber::receive() {
+#ifdef _WIN32
+    return false;
+#else
+    if (fd < 0) return false;
+    char buffer[64 * 1024];
+    while (true) {
+        uint32_t length = 0;
+        if (inbox.size() >= 4) memcpy(&length, inbox.data(), sizeof(length));
+        if (inbox.size() >= 4 && inbox.size() - 4 >= length) break;
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) return false;
+        inbox.append(buffer, (size_t)n);
+    }
+
+    uint32_t length;
+    memcpy(&length, inbox.data(), sizeof(length));
+    size_t frameBytes = 4 + (size_t)length;
+    if (frameBytes < FRAME_HEADER_BYTES) {
+        cerr << "Error: Replication frame is too short.\n";
+        return false;
+    }
+    uint8_t type = (uint8_t)inbox[4];
+    uint32_t sequence, baseSequence, turn;
+    memcpy(&sequence, inbox.data() + 5, sizeof(sequence));
+    memcpy(&baseSequence, inbox.data() + 9, sizeof(baseSequence));
+    memcpy(&turn, inbox.data() + 13, sizeof(turn));
+
+    // A delta applies to a copy of its base; copies share every chunk they do not change
+    Version version;
+    version.sequence = sequence;
+    version.turn = turn;
+    bool found = type == REPLICATION_FULL;
+    for (size_t i = 0; !found && i < versions.size(); i++) {
+        if (versions[i].sequence == baseSequence) {
+            version.world = versions[i].world;
+            found = true;
+        }
+    }
+    if (!found) {
+        inbox.erase(0, frameBytes);
+        return acknowledge(REPLICATION_NEED_FULL); // Base already dropped: ask for a full frame
+    }
+
+    int changed = applyReplicationChanges(inbox.data() + FRAME_HEADER_BYTES, frameBytes - FRAME_HEADER_BYTES,
+                                          version.world);
+    inbox.erase(0, frameBytes);
+    if (changed < 0) {
+        cerr << "Error: Replication frame " << sequence << " is malformed.\n";
+        return acknowledge(REPLICATION_NEED_FULL);
+    }
+
+    versions.push_back(version);
+    if (versions.size() > (size_t)REPLICATION_HISTORY) versions.erase(versions.begin());
+    lastFull = type == REPLICATION_FULL;
+    lastBytes = frameBytes;
+    lastChanged = changed;
+    return acknowledge(sequence);
+#endif
+}
+
+bool ReplicationSubscriber::hasWorld() const {
+    return !versions.empty();
+}
+
+uint32_t ReplicationSubscriber::getTurn() const {
+    return versions.empty() ? 0 : versions.back().turn;
+}
+
+const PersistentVector<KingdomRecord>& ReplicationSubscriber::getWorld() const {
+    return versions.back().world;
+}
+
+bool ReplicationSubscriber::wasFull() const {
+    return lastFull;
+}
+
+size_t ReplicationSubscriber::getFrameBytes() const {
+    return lastBytes;
+}
+
+int ReplicationSubscriber::getChangedCount() const {
+    return lastChanged;
+}
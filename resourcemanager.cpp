@@ -12,6 +12,7 @@ ResourceManager::ResourceManager() {
 void ResourceManager::trackResourceChange(int& resource, int change, const std::string& resourceType, const std::string& action) {
     int oldValue = resource;
     resource += change;
+    Metrics::count(METRIC_RESOURCE_CHANGES);
     
     // This can be used for logging with GameSaver later
     // Example: gameSaver.logResourceChange(resourceType, oldValue, resource, action);
@@ -19,34 +20,38 @@ void ResourceManager::trackResourceChange(int& resource, int change, const std::
 
 // General resource management simulation
 void ResourceManager::manage() {
-    cout << "\n--- Resource Management ---\n";
-    cout << "Choose operation:\n";
-    cout << "1. Gather Resources\n";
-    cout << "2. Consume Resources\n";
-    int choice;
-    cin >> choice;
+    console() << "\n--- Resource Management ---\n";
+    InputProvider& input = InputProvider::local();
+    if (input.showsPrompts()) {
+        console() << "Choose operation:\n";
+        console() << "1. Gather Resources\n";
+        console() << "2. Consume Resources\n";
+    }
+    int choice = 0;
+    input.readInt(nullptr, choice);
 
     if (choice == 1) {
         gatherResources();
     } else if (choice == 2) {
         consumeResources();
     } else {
-        cout << "Invalid option.\n";
+        console() << "Invalid option.\n";
     }
 }
 
 // Gather resources (user inputs how much to add)
 void ResourceManager::gatherResources() {
-    int f, w, s, i;
+    int f = 0, w = 0, s = 0, i = 0;
 
-    cout << "\nEnter amount of each resource to gather:\n";
-    cout << "Food: "; cin >> f;
-    cout << "Wood: "; cin >> w;
-    cout << "Stone: "; cin >> s;
-    cout << "Iron: "; cin >> i;
+    InputProvider& input = InputProvider::local();
+    if (input.showsPrompts()) console() << "\nEnter amount of each resource to gather:\n";
+    input.readInt("Food: ", f);
+    input.readInt("Wood: ", w);
+    input.readInt("Stone: ", s);
+    input.readInt("Iron: ", i);
 
     if (f < 0 || w < 0 || s < 0 || i < 0) {
-        cout << "Invalid input. Cannot gather negative resources.\n";
+        console() << "Invalid input. Cannot gather negative resources.\n";
         return;
     }
 
@@ -56,26 +61,27 @@ void ResourceManager::gatherResources() {
     trackResourceChange(stone, s, "STONE", "Gathering");
     trackResourceChange(iron, i, "IRON", "Gathering");
 
-    cout << "Resources gathered successfully.\n";
+    console() << "Resources gathered successfully.\n";
 }
 
 // Consume resources (user inputs how much to use)
 void ResourceManager::consumeResources() {
-    int f, w, s, i;
+    int f = 0, w = 0, s = 0, i = 0;
 
-    cout << "\nEnter amount of each resource to consume:\n";
-    cout << "Food: "; cin >> f;
-    cout << "Wood: "; cin >> w;
-    cout << "Stone: "; cin >> s;
-    cout << "Iron: "; cin >> i;
+    InputProvider& input = InputProvider::local();
+    if (input.showsPrompts()) console() << "\nEnter amount of each resource to consume:\n";
+    input.readInt("Food: ", f);
+    input.readInt("Wood: ", w);
+    input.readInt("Stone: ", s);
+    input.readInt("Iron: ", i);
 
     if (f < 0 || w < 0 || s < 0 || i < 0) {
-        cout << "Invalid input. Cannot consume negative resources.\n";
+        console() << "Invalid input. Cannot consume negative resources.\n";
         return;
     }
 
     if (food < f || wood < w || stone < s || iron < i) {
-        cout << "Insufficient resources. Consumption failed.\n";
+        console() << "Insufficient resources. Consumption failed.\n";
         return;
     }
 
@@ -85,23 +91,24 @@ void ResourceManager::consumeResources() {
     trackResourceChange(stone, -s, "STONE", "Consumption");
     trackResourceChange(iron, -i, "IRON", "Consumption");
 
-    cout << "Resources consumed successfully.\n";
+    console() << "Resources consumed successfully.\n";
 }
 
 // Show current stock
 void ResourceManager::showStats() const {
-    cout << "\n====== Resource Stock ======\n";
-    cout << "Food: " << food << "\n";
-    cout << "Wood: " << wood << "\n";
-    cout << "Stone: " << stone << "\n";
-    cout << "Iron: " << iron << "\n";
+    OutputSink& sink = OutputSink::local();
+    sink.section("Resource Stock", this);
+    sink.field("Food", food);
+    sink.field("Wood", wood);
+    sink.field("Stone", stone);
+    sink.field("Iron", iron);
 }
 
 // Save to file
 void ResourceManager::saveToFile() const {
     ofstream out("resources.txt");
     if (!out) {
-        cout << "Error: Could not save resources.\n";
+        console() << "Error: Could not save resources.\n";
         return;
     }
 
@@ -110,20 +117,20 @@ void ResourceManager::saveToFile() const {
     out << stone << endl;
     out << iron << endl;
     out.close();
-    cout << "Resources saved to file.\n";
+    console() << "Resources saved to file.\n";
 }
 
 // Load from file
 void ResourceManager::loadFromFile() {
     ifstream in("resources.txt");
     if (!in) {
-        cout << "Error: Could not load resources.\n";
+        console() << "Error: Could not load resources.\n";
         return;
     }
 
     in >> food >> wood >> stone >> iron;
     in.close();
-    cout << "Resources loaded from file.\n";
+    console() << "Resources loaded from file.\n";
 }
 void ResourceManager::consumeFixed(string resourceType, int amount) {
     if (resourceType == "food" && food >= amount) {
@@ -139,6 +146,35 @@ void ResourceManager::consumeFixed(string resourceType, int amount) {
         trackResourceChange(iron, -amount, "IRON", "Fixed consumption");
     }
     else {
-        cout << "Not enough " << resourceType << " available.\n";
+        console() << "Not enough " << resourceType << " available.\n";
     }
 }
+
+// Apply units bought (+) or sold (-) on the trade market
+void ResourceManager::applyTrade(int resourceType, int amount) {
+    if (amount == 0) return;
+
+    int* stocks[4] = { &food, &wood, &stone, &iron };
+    const char* names[4] = { "FOOD", "WOOD", "STONE", "IRON" };
+    if (resourceType < 0 || resourceType >= 4) return;
+
+    int& stock = *stocks[resourceType];
+    if (stock + amount < 0) amount = -stock;
+    trackResourceChange(stock, amount, names[resourceType], amount > 0 ? "Trade purchase" : "Trade sale");
+}
+
+// Copy the stockpile into a snapshot record
+void ResourceManager::exportState(KingdomRecord& record) const {
+    record.food = food;
+    record.wood = wood;
+    record.stone = stone;
+    record.iron = iron;
+}
+
+// Restore the stockpile from a snapshot record
+void ResourceManager::importState(const KingdomRecord& record) {
+    food = record.food;
+    wood = record.wood;
+    stone = record.stone;
+    iron = record.iron;
+}
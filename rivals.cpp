@@ -0,0 +1,168 @@
+#include "Stronghold.h"
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+// Queue sizes; a worker never has more than a few snapshot requests to answer
+const size_t RIVAL_COMMAND_SLOTS = 64;
+const size_t RIVAL_RESULT_SLOTS = 256;
+
+// One AI kingdom; only its worker thread ever touches it
+struct RivalKingdom {
+    Population population;
+    Army army;
+    Economy economy;
+    ResourceManager resources;
+    AIController ai;
+    int turn;
+};
+
+struct RivalWorker {
+    SpscQueue<RivalCommand> commands; // Menu thread -> worker
+    SpscQueue<RivalSnapshot> results; // Worker -> menu thread
+    SmallVector<RivalKingdom, 0> kingdoms;
+    int firstKingdom;
+    int kingdomCount;
+    uint64_t seed;
+    thread runner;
+
+    RivalWorker() : commands(RIVAL_COMMAND_SLOTS), results(RIVAL_RESULT_SLOTS) {}
+};
+
+// Helper to give a new rival its own starting fortunes
+static void foundRival(RivalKingdom& kingdom) {
+    KingdomRecord record;
+    memset(&record, 0, sizeof(KingdomRecord));
+    kingdom.army.exportState(record);
+    kingdom.economy.exportState(record);
+    kingdom.resources.exportState(record);
+    record.treasury += GameRandom::local().nextInt(1001) - 500;
+    record.morale += GameRandom::local().nextInt(31) - 15;
+    record.armyFood += GameRandom::local().nextInt(201) - 100;
+    record.food += GameRandom::local().nextInt(401) - 200;
+    kingdom.army.importState(record);
+    kingdom.economy.importState(record);
+    kingdom.resources.importState(record);
+    kingdom.ai.setAutonomous(true);
+    kingdom.turn = 1;
+}
+
+// Helper to run one rival through a turn: the AI decisions the player's
+// kingdom gets when advancing a turn
+static void playRivalTurn(RivalKingdom& kingdom) {
+    ScopedTrace span("rival.turn");
+    kingdom.ai.makeTaxDecision(kingdom.economy, kingdom.population);
+    kingdom.ai.mobilizeArmy(kingdom.army, kingdom.population, kingdom.resources);
+    kingdom.ai.handleInternalConflict(kingdom.population, kingdom.army, kingdom.economy);
+    kingdom.turn++;
+}
+
+static void runRivalWorker(RivalWorker& worker) {
+    Trace::setThreadName("rival kingdoms");
+    OutputSink::local().setMode(OUTPUT_QUIET); // The AI's reports are for nobody
+    GameRandom::local().seed(worker.seed);
+    for (int k = 0; k < worker.kingdomCount; k++) {
+        foundRival(worker.kingdoms[k]);
+    }
+
+    chrono::steady_clock::time_point nextTurn = chrono::steady_clock::now();
+    while (true) {
+        RivalCommand command;
+        while (worker.commands.pop(command)) {
+            switch (command.type) {
+            case RIVAL_SNAPSHOT:
+                for (int k = 0; k < worker.kingdomCount; k++) {
+                    RivalSnapshot snapshot;
+                    snapshot.request = command.request;
+                    snapshot.kingdom = worker.firstKingdom + k;
+                    snapshot.turn = worker.kingdoms[k].turn;
+                    memset(&snapshot.record, 0, sizeof(KingdomRecord));
+                    worker.kingdoms[k].population.exportState(snapshot.record);
+                    worker.kingdoms[k].army.exportState(snapshot.record);
+                    worker.kingdoms[k].economy.exportState(snapshot.record);
+                    worker.kingdoms[k].resources.exportState(snapshot.record);
+                    worker.results.push(snapshot); // A full queue means nobody is waiting for it
+                }
+                break;
+            case RIVAL_STOP:
+                return;
+            }
+        }
+
+        chrono::steady_clock::time_point now = chrono::steady_clock::now();
+        if (now >= nextTurn) {
+            for (int k = 0; k < worker.kingdomCount; k++) {
+                playRivalTurn(worker.kingdoms[k]);
+            }
+            TurnArena::local().reset();
+            nextTurn += chrono::milliseconds(RIVAL_TURN_MILLIS);
+            if (nextTurn < now) nextTurn = now; // Do not race to catch up after a stall
+        }
+        this_thread::sleep_for(chrono::milliseconds(RIVAL_POLL_MILLIS));
+    }
+}
+
+// Constructor deals the kingdoms out to the workers and starts them
+RivalKingdoms::RivalKingdoms(int threads, uint64_t seed) {
+    workerCount = threads < 1 ? 1 : (threads > RIVAL_KINGDOMS ? RIVAL_KINGDOMS : threads);
+    nextRequest = 1;
+    int first = 0;
+    for (int w = 0; w < workerCount; w++) {
+        RivalWorker* worker = new RivalWorker();
+        worker->firstKingdom = first;
+        worker->kingdomCount = RIVAL_KINGDOMS / workerCount + (w < RIVAL_KINGDOMS % workerCount ? 1 : 0);
+        worker->kingdoms.resize(worker->kingdomCount);
+        worker->seed = seed ^ (0x9E3779B97F4A7C15ULL * (uint64_t)(w + 1)); // Each worker its own stream
+        first += worker->kingdomCount;
+        workers.push_back(worker);
+        worker->runner = thread(runRivalWorker, ref(*worker));
+    }
+}
+
+// Destructor stops every worker and frees its kingdoms
+RivalKingdoms::~RivalKingdoms() {
+    for (int w = 0; w < workerCount; w++) {
+        while (!send(w, RIVAL_STOP, 0)) {
+            this_thread::yield();
+        }
+    }
+    for (int w = 0; w < workerCount; w++) {
+        workers[w]->runner.join();
+        delete workers[w];
+    }
+}
+
+// Helper to queue one command; false if the worker's queue is full
+bool RivalKingdoms::send(int worker, int type, uint32_t request) {
+    RivalCommand command;
+    command.type = type;
+    command.request = request;
+    return workers[worker]->commands.push(command);
+}
+
+bool RivalKingdoms::snapshot(vector<RivalSnapshot>& kingdoms) {
+    uint32_t request = nextRequest++;
+    kingdoms.assign(RIVAL_KINGDOMS, RivalSnapshot());
+    int missing = RIVAL_KINGDOMS;
+    for (int w = 0; w < workerCount; w++) {
+        if (!send(w, RIVAL_SNAPSHOT, request)) return false;
+    }
+
+    // Answers to requests that timed out earlier are stale; skip them
+    chrono::steady_clock::time_point deadline =
+        chrono::steady_clock::now() + chrono::milliseconds(RIVAL_REPLY_TIMEOUT_MILLIS);
+    while (missing > 0 && chrono::steady_clock::now() < deadline) {
+        bool received = false;
+        for (int w = 0; w < workerCount; w++) {
+            RivalSnapshot snapshot;
+            while (workers[w]->results.pop(snapshot)) {
+                received = true;
+                if (snapshot.request != request) continue;
+                kingdoms[snapshot.kingdom] = snapshot;
+                missing--;
+            }
+        }
+        if (!received) this_thread::sleep_for(chrono::microseconds(200));
+    }
+    return missing == 0;
+}
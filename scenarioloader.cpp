@@ -0,0 +1,610 @@
+#include "Stronghold.h"
+#include <charconv>
+#include <cstring>
+#include <thread>
+#include <atomic>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Pieces handed out per worker, so one dense piece does not hold up the rest
+static const int PIECES_PER_THREAD = 8;
+
+// Files smaller than this are parsed in one piece
+static const size_t MIN_PARALLEL_BYTES = 1 << 16;
+
+enum ScenarioSection {
+    SECTION_NONE,
+    SECTION_POPULATION,
+    SECTION_ARMY,
+    SECTION_ECONOMY,
+    SECTION_RESOURCES,
+    SECTION_BANK
+};
+
+// A loan read by a worker, placed into the table once every piece is done
+struct PendingLoan {
+    int kingdom;
+    LoanRecord loan;
+};
+
+// ========== Kingdom Table ==========
+
+// Constructor: fields a scenario leaves out get the values of a new game
+KingdomTable::KingdomTable() {
+    kingdomCount = 0;
+    loanStart.push_back(0);
+
+    Population pop;
+    Army army;
+    Economy eco;
+    ResourceManager res;
+    Bank bank;
+    vector<LoanRecord> noLoans;
+    pop.exportState(defaults);
+    army.exportState(defaults);
+    eco.exportState(defaults);
+    res.exportState(defaults);
+    bank.exportState(defaults, noLoans);
+
+    // Cohorts are re-seeded from the class counts unless the scenario has them
+    for (int i = 0; i < COHORT_SIZE; i++) {
+        defaults.cohorts[i] = 0.0f;
+    }
+}
+
+// Size the table, filling every kingdom with the defaults and no loans
+void KingdomTable::reset(int kingdoms) {
+    if (kingdoms < 0) kingdoms = 0;
+    kingdomCount = kingdoms;
+
+    // Fresh chunks, so a fork of the old table keeps its kingdoms
+    records.clear();
+    records.resize(kingdoms, defaults);
+    loanStart.clear();
+    loanStart.resize(kingdoms + 1, 0);
+    loans.clear();
+}
+
+void KingdomTable::setDefaults(const KingdomRecord& record) {
+    defaults = record;
+}
+
+int KingdomTable::getKingdomCount() const {
+    return kingdomCount;
+}
+
+KingdomRecord& KingdomTable::get(int kingdom) {
+    return records.edit(kingdom);
+}
+
+const KingdomRecord& KingdomTable::get(int kingdom) const {
+    return records[kingdom];
+}
+
+int KingdomTable::getLoanCount(int kingdom) const {
+    return loanStart[kingdom + 1] - loanStart[kingdom];
+}
+
+const LoanRecord& KingdomTable::getLoan(int kingdom, int loan) const {
+    return loans[loanStart[kingdom] + loan];
+}
+
+const PersistentVector<KingdomRecord>& KingdomTable::getRecords() const {
+    return records;
+}
+
+// ========== Parsing Helpers ==========
+
+// Helper to read one number, leaving the field untouched if the line lacks it.
+// After a bad field the rest of the line is skipped, as a failed stream would.
+template<typename T>
+static void readField(const char*& cursor, const char* end, T& value) {
+    while (cursor < end && (*cursor == ' ' || *cursor == '\t')) cursor++;
+    T parsed;
+    from_chars_result result = from_chars(cursor, end, parsed);
+    if (result.ec == errc()) {
+        value = parsed;
+        cursor = result.ptr;
+    } else {
+        cursor = end;
+    }
+}
+
+// Helper to check whether a line starts with the given text
+static bool startsWith(const char* line, const char* end, const char* prefix) {
+    size_t length = strlen(prefix);
+    return (size_t)(end - line) >= length && memcmp(line, prefix, length) == 0;
+}
+
+// Helper to read the id of a `[KINGDOM n]` line (-1 if malformed)
+static int kingdomId(const char* line, const char* end) {
+    int id = -1;
+    const char* cursor = line + 9;
+    readField(cursor, end, id);
+    return id;
+}
+
+// Helper to find the first `[KINGDOM` line at or after `from`
+static size_t nextKingdomStart(const char* text, size_t length, size_t from) {
+    const char* end = text + length;
+    const char* cursor = text + from;
+    while (cursor < end) {
+        const char* newline = (const char*)memchr(cursor, '\n', end - cursor);
+        if (!newline) break;
+        cursor = newline + 1;
+        if (startsWith(cursor, end, "[KINGDOM")) return cursor - text;
+    }
+    return length;
+}
+
+// Helper to split the next line off [cursor, end), dropping a trailing '\r'
+static const char* nextLine(const char*& cursor, const char* end, const char*& lineEnd) {
+    const char* line = cursor;
+    const char* newline = (const char*)memchr(cursor, '\n', end - cursor);
+    lineEnd = newline ? newline : end;
+    cursor = newline ? newline + 1 : end;
+    if (lineEnd > line && lineEnd[-1] == '\r') lineEnd--;
+    return line;
+}
+
+// Helper to run `work(piece)` for every piece on a pool of workers
+template<typename Work>
+static void runPieces(int pieces, int threads, Work work) {
+    atomic<int> nextPiece(0);
+    auto worker = [&]() {
+        int piece;
+        while ((piece = nextPiece.fetch_add(1)) < pieces) {
+            ScopedTrace span("scenario.piece");
+            work(piece);
+        }
+    };
+
+    int workers = threads < pieces ? threads : pieces;
+    SmallVector<thread, INLINE_THREADS> pool((size_t)(workers > 1 ? workers - 1 : 0));
+    for (int t = 0; t < workers - 1; t++) {
+        pool[t] = thread([&]() {
+            Trace::setThreadName("scenario loader");
+            worker();
+        });
+    }
+    worker();
+    for (int t = 0; t < workers - 1; t++) {
+        pool[t].join();
+    }
+}
+
+// Helper to find the highest kingdom id in a piece (0 if the piece has none)
+static int highestKingdom(const char* begin, const char* end) {
+    int highest = 0;
+    const char* cursor = begin;
+    while (cursor < end) {
+        const char* lineEnd;
+        const char* line = nextLine(cursor, end, lineEnd);
+        if (startsWith(line, lineEnd, "[KINGDOM")) {
+            int id = kingdomId(line, lineEnd);
+            if (id > highest) highest = id;
+        }
+    }
+    return highest;
+}
+
+// Helper to parse one piece into the records. Text before the first
+// `[KINGDOM n]` line belongs to kingdom 0, so plain save files load too.
+// A kingdom is claimed by the first piece to fill it in; a piece that finds
+// its kingdom already claimed stops and reports it in `duplicate`.
+static void parsePiece(const char* begin, const char* end, PersistentVector<KingdomRecord>& records,
+                       int kingdomCount, vector<PendingLoan>& loans, vector<atomic<bool>>& claimed,
+                       atomic<int>& duplicate) {
+    int kingdom = 0;
+    bool owned = false;     // Whether this piece has claimed `kingdom`
+    ScenarioSection section = SECTION_NONE;
+    int lineInSection = 0;
+    int loansExpected = 0;
+
+    const char* cursor = begin;
+    while (cursor < end) {
+        const char* lineEnd;
+        const char* line = nextLine(cursor, end, lineEnd);
+        if (line == lineEnd || *line == '#') continue;
+
+        // Section and kingdom headers
+        if (*line == '[') {
+            if (startsWith(line, lineEnd, "[KINGDOM")) {
+                kingdom = kingdomId(line, lineEnd);
+                owned = false;
+                section = SECTION_NONE;
+            } else if (startsWith(line, lineEnd, "[POPULATION]")) {
+                section = SECTION_POPULATION;
+            } else if (startsWith(line, lineEnd, "[ARMY]")) {
+                section = SECTION_ARMY;
+            } else if (startsWith(line, lineEnd, "[ECONOMY]")) {
+                section = SECTION_ECONOMY;
+            } else if (startsWith(line, lineEnd, "[RESOURCES]")) {
+                section = SECTION_RESOURCES;
+            } else if (startsWith(line, lineEnd, "[BANK]")) {
+                section = SECTION_BANK;
+            } else {
+                section = SECTION_NONE;
+            }
+            lineInSection = 0;
+            continue;
+        }
+
+        if (kingdom < 0 || kingdom >= kingdomCount) continue;
+        if (!owned) {
+            if (claimed[kingdom].exchange(true)) {
+                duplicate.store(kingdom);
+                return;
+            }
+            owned = true;
+        }
+        KingdomRecord& k = records.edit(kingdom); // The table is fresh, so nothing is copied
+        const char* field = line;
+
+        switch (section) {
+        case SECTION_POPULATION:
+            if (lineInSection == 0) {
+                readField(field, lineEnd, k.total);
+                readField(field, lineEnd, k.peasants);
+                readField(field, lineEnd, k.merchants);
+                readField(field, lineEnd, k.nobles);
+                readField(field, lineEnd, k.happiness);
+                readField(field, lineEnd, k.foodStock);
+            } else if (lineInSection == 1) {
+                for (int i = 0; i < COHORT_SIZE; i++) {
+                    readField(field, lineEnd, k.cohorts[i]);
+                }
+            }
+            break;
+        case SECTION_ARMY:
+            if (lineInSection == 0) {
+                readField(field, lineEnd, k.soldiers);
+                readField(field, lineEnd, k.morale);
+                readField(field, lineEnd, k.armyFood);
+                readField(field, lineEnd, k.armyX);
+                readField(field, lineEnd, k.armyY);
+            } else if (lineInSection == 1) {
+                for (int t = 0; t < UNIT_TYPES; t++) {
+                    readField(field, lineEnd, k.unitMix[t]);
+                }
+            } else if (lineInSection == 2) {
+                for (int t = 0; t < UNIT_TYPES; t++) {
+                    readField(field, lineEnd, k.unitStrength[t]);
+                }
+            }
+            break;
+        case SECTION_ECONOMY:
+            if (lineInSection == 0) {
+                readField(field, lineEnd, k.treasury);
+                readField(field, lineEnd, k.taxRate);
+                readField(field, lineEnd, k.inflation);
+            }
+            break;
+        case SECTION_RESOURCES:
+            if (lineInSection == 0) {
+                readField(field, lineEnd, k.food);
+                readField(field, lineEnd, k.wood);
+                readField(field, lineEnd, k.stone);
+                readField(field, lineEnd, k.iron);
+            }
+            break;
+        case SECTION_BANK:
+            if (lineInSection == 0) {
+                loansExpected = 0;
+                readField(field, lineEnd, k.loansIssued);
+                readField(field, lineEnd, k.fraudDetected);
+                readField(field, lineEnd, k.defaults);
+                readField(field, lineEnd, k.anomalies);
+                readField(field, lineEnd, loansExpected);
+            } else if (lineInSection <= loansExpected) {
+                PendingLoan pending;
+                pending.kingdom = kingdom;
+                pending.loan.balance = -1.0;
+                pending.loan.rateTier = -1;
+                pending.loan.turnsLeft = -1;
+                readField(field, lineEnd, pending.loan.balance);
+                readField(field, lineEnd, pending.loan.rateTier);
+                readField(field, lineEnd, pending.loan.turnsLeft);
+                if (pending.loan.turnsLeft >= 0) loans.push_back(pending);
+            }
+            break;
+        default:
+            break;
+        }
+        lineInSection++;
+    }
+}
+
+// ========== Scenario Formats ==========
+
+// Fill in a binary scenario header for this build
+void initScenarioHeader(ScenarioHeader& header, uint64_t kingdoms, uint64_t loans) {
+    memcpy(header.magic, SCENARIO_MAGIC, sizeof(header.magic));
+    header.version = SCENARIO_VERSION;
+    header.recordSize = (uint32_t)sizeof(KingdomRecord);
+    header.kingdomCount = kingdoms;
+    header.loanCount = loans;
+}
+
+// Check a binary scenario header against this build
+bool isScenarioHeaderValid(const ScenarioHeader& header) {
+    return memcmp(header.magic, SCENARIO_MAGIC, sizeof(header.magic)) == 0 &&
+           header.version == SCENARIO_VERSION &&
+           header.recordSize == sizeof(KingdomRecord);
+}
+
+// Helper to append a number and a separator
+template<typename T>
+static void appendField(string& out, T value, char separator) {
+    char buffer[32];
+    to_chars_result result = to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+    out.push_back(separator);
+}
+
+// Append one kingdom in the text scenario (and save file) format
+void appendKingdomText(string& out, int kingdom, const KingdomRecord& k,
+                       const LoanRecord* loans, int loanCount) {
+    out += "[KINGDOM ";
+    appendField(out, kingdom, ']');
+    out += "\n[POPULATION]\n";
+    appendField(out, k.total, ' ');
+    appendField(out, k.peasants, ' ');
+    appendField(out, k.merchants, ' ');
+    appendField(out, k.nobles, ' ');
+    appendField(out, k.happiness, ' ');
+    appendField(out, k.foodStock, '\n');
+    for (int i = 0; i < COHORT_SIZE; i++) {
+        appendField(out, k.cohorts[i], i + 1 < COHORT_SIZE ? ' ' : '\n');
+    }
+
+    out += "[ARMY]\n";
+    appendField(out, k.soldiers, ' ');
+    appendField(out, k.morale, ' ');
+    appendField(out, k.armyFood, ' ');
+    appendField(out, k.armyX, ' ');
+    appendField(out, k.armyY, '\n');
+    for (int t = 0; t < UNIT_TYPES; t++) {
+        appendField(out, k.unitMix[t], t + 1 < UNIT_TYPES ? ' ' : '\n');
+    }
+    for (int t = 0; t < UNIT_TYPES; t++) {
+        appendField(out, k.unitStrength[t], t + 1 < UNIT_TYPES ? ' ' : '\n');
+    }
+
+    out += "[ECONOMY]\n";
+    appendField(out, k.treasury, ' ');
+    appendField(out, k.taxRate, ' ');
+    appendField(out, k.inflation, '\n');
+
+    out += "[RESOURCES]\n";
+    appendField(out, k.food, ' ');
+    appendField(out, k.wood, ' ');
+    appendField(out, k.stone, ' ');
+    appendField(out, k.iron, '\n');
+
+    // One line per active loan after the bank counters
+    out += "[BANK]\n";
+    appendField(out, k.loansIssued, ' ');
+    appendField(out, k.fraudDetected, ' ');
+    appendField(out, k.defaults, ' ');
+    appendField(out, k.anomalies, ' ');
+    appendField(out, loanCount, '\n');
+    for (int i = 0; i < loanCount; i++) {
+        appendField(out, loans[i].balance, ' ');
+        appendField(out, loans[i].rateTier, ' ');
+        appendField(out, loans[i].turnsLeft, '\n');
+    }
+}
+
+// ========== Scenario Loader ==========
+
+ScenarioLoader::ScenarioLoader(int threads) {
+    threadCount = threads > 0 ? threads : (int)thread::hardware_concurrency();
+    if (threadCount <= 0) threadCount = 1;
+}
+
+// Parse scenario text already in memory; false if a kingdom id is too large
+// or appears twice
+bool ScenarioLoader::parse(const char* text, size_t length, KingdomTable& table) const {
+    ScopedTrace span("scenario.parse");
+
+    // Cut the text at kingdom boundaries so no kingdom spans two pieces
+    int pieces = length < MIN_PARALLEL_BYTES ? 1 : threadCount * PIECES_PER_THREAD;
+    SmallVector<size_t, 64> pieceStart((size_t)pieces + 1);
+    pieceStart[0] = 0;
+    for (int p = 1; p < pieces; p++) {
+        size_t start = nextKingdomStart(text, length, length / pieces * p);
+        pieceStart[p] = start > pieceStart[p - 1] ? start : pieceStart[p - 1];
+    }
+    pieceStart[pieces] = length;
+
+    // First pass sizes the table, second pass fills it
+    SmallVector<int, 64> highest((size_t)pieces);
+    runPieces(pieces, threadCount, [&](int p) {
+        highest[p] = highestKingdom(text + pieceStart[p], text + pieceStart[p + 1]);
+    });
+    int kingdoms = 1;
+    for (int p = 0; p < pieces; p++) {
+        if (highest[p] >= MAX_SCENARIO_KINGDOMS) {
+            cerr << "Error: Kingdom " << highest[p] << " is past the scenario limit of "
+                 << MAX_SCENARIO_KINGDOMS << " kingdoms.\n";
+            return false;
+        }
+        if (highest[p] + 1 > kingdoms) kingdoms = highest[p] + 1;
+    }
+    table.reset(kingdoms);
+
+    SmallVector<vector<PendingLoan>, 0> pieceLoans((size_t)pieces);
+    vector<atomic<bool>> claimed((size_t)kingdoms);
+    atomic<int> duplicate(-1);
+    runPieces(pieces, threadCount, [&](int p) {
+        parsePiece(text + pieceStart[p], text + pieceStart[p + 1], table.records, kingdoms, pieceLoans[p],
+                   claimed, duplicate);
+    });
+    if (duplicate.load() >= 0) {
+        cerr << "Error: Kingdom " << duplicate.load() << " appears more than once in the scenario.\n";
+        return false;
+    }
+
+    // Group the loans by kingdom, keeping file order within each kingdom
+    PersistentVector<int>& loanStart = table.loanStart;
+    size_t loanCount = 0;
+    for (int p = 0; p < pieces; p++) {
+        for (size_t i = 0; i < pieceLoans[p].size(); i++) {
+            loanStart.edit(pieceLoans[p][i].kingdom + 1)++;
+        }
+        loanCount += pieceLoans[p].size();
+    }
+    for (int k = 0; k < kingdoms; k++) {
+        loanStart.edit(k + 1) += loanStart[k];
+    }
+    table.loans.resize(loanCount);
+    SmallVector<int, 0> fill((size_t)kingdoms);
+    for (int k = 0; k < kingdoms; k++) {
+        fill[k] = loanStart[k];
+    }
+    for (int p = 0; p < pieces; p++) {
+        for (size_t i = 0; i < pieceLoans[p].size(); i++) {
+            table.loans.set(fill[pieceLoans[p][i].kingdom]++, pieceLoans[p][i].loan);
+        }
+    }
+    return true;
+}
+
+// Copy a binary scenario already in memory; false if the header does not match
+bool ScenarioLoader::parseBinary(const char* data, size_t length, KingdomTable& table) const {
+    ScenarioHeader header;
+    if (length < sizeof(header)) return false;
+    memcpy(&header, data, sizeof(header));
+    if (!isScenarioHeaderValid(header)) return false;
+
+    // Bound both counts by what is left of the file before multiplying them
+    if (header.kingdomCount > (uint64_t)MAX_SCENARIO_KINGDOMS) return false;
+    size_t recordBytes = (size_t)header.kingdomCount * sizeof(KingdomRecord);
+    size_t available = length - sizeof(header);
+    if (available < recordBytes ||
+        header.loanCount > (available - recordBytes) / sizeof(ScenarioLoan)) return false;
+
+    int kingdoms = (int)header.kingdomCount;
+    table.reset(kingdoms);
+    const char* recordData = data + sizeof(header);
+    for (int k = 0; k < kingdoms; k++) {
+        memcpy(&table.records.edit(k), recordData + (size_t)k * sizeof(KingdomRecord), sizeof(KingdomRecord));
+    }
+
+    // Loans come in any order; group them by kingdom
+    const char* loanData = data + sizeof(header) + recordBytes;
+    PersistentVector<int>& loanStart = table.loanStart;
+    size_t loanCount = 0;
+    for (uint64_t i = 0; i < header.loanCount; i++) {
+        ScenarioLoan loan;
+        memcpy(&loan, loanData + i * sizeof(ScenarioLoan), sizeof(loan));
+        if (loan.kingdom < 0 || loan.kingdom >= kingdoms) continue;
+        loanStart.edit(loan.kingdom + 1)++;
+        loanCount++;
+    }
+    for (int k = 0; k < kingdoms; k++) {
+        loanStart.edit(k + 1) += loanStart[k];
+    }
+    table.loans.resize(loanCount);
+    SmallVector<int, 0> fill((size_t)kingdoms);
+    for (int k = 0; k < kingdoms; k++) {
+        fill[k] = loanStart[k];
+    }
+    for (uint64_t i = 0; i < header.loanCount; i++) {
+        ScenarioLoan loan;
+        memcpy(&loan, loanData + i * sizeof(ScenarioLoan), sizeof(loan));
+        if (loan.kingdom < 0 || loan.kingdom >= kingdoms) continue;
+        LoanRecord& record = table.loans.edit(fill[loan.kingdom]++);
+        record.balance = loan.balance;
+        record.rateTier = loan.rateTier;
+        record.turnsLeft = loan.turnsLeft;
+    }
+    return true;
+}
+
+// Helper to load mapped file contents in whichever format they are
+static bool loadMapped(const ScenarioLoader& loader, const string& path, const char* data,
+                       size_t length, KingdomTable& table) {
+    if (length >= sizeof(SCENARIO_MAGIC) && memcmp(data, SCENARIO_MAGIC, sizeof(SCENARIO_MAGIC)) == 0) {
+        if (!loader.parseBinary(data, length, table)) {
+            cerr << "Error: " << path << " is not a binary scenario this build can read.\n";
+            return false;
+        }
+        return true;
+    }
+    return loader.parse(data, length, table);
+}
+
+// Load a scenario file; kingdoms missing from it keep the table defaults
+bool ScenarioLoader::load(const string& path, KingdomTable& table) const {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        cerr << "Error: Could not open " << path << " for loading scenario.\n";
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(file, &fileSize);
+    size_t length = (size_t)fileSize.QuadPart;
+    if (length == 0) {
+        CloseHandle(file);
+        parse("", 0, table);
+        return true;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    const char* text = mapping ? (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!text) {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        cerr << "Error: Could not map " << path << " for loading scenario.\n";
+        return false;
+    }
+
+    bool loaded = loadMapped(*this, path, text, length, table);
+
+    UnmapViewOfFile(text);
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return loaded;
+#else
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0) {
+        cerr << "Error: Could not open " << path << " for loading scenario.\n";
+        return false;
+    }
+    struct stat info;
+    if (fstat(file, &info) != 0) {
+        close(file);
+        cerr << "Error: Could not read " << path << " for loading scenario.\n";
+        return false;
+    }
+    size_t length = (size_t)info.st_size;
+    if (length == 0) {
+        close(file);
+        parse("", 0, table);
+        return true;
+    }
+
+    void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (mapped == MAP_FAILED) {
+        cerr << "Error: Could not map " << path << " for loading scenario.\n";
+        return false;
+    }
+    madvise(mapped, length, MADV_SEQUENTIAL);
+
+    bool loaded = loadMapped(*this, path, (const char*)mapped, length, table);
+
+    munmap(mapped, length);
+    return loaded;
+#endif
+}
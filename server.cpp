@@ -0,0 +1,650 @@
+#include "Stronghold.h"
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+// Bytes read from a socket per call
+const size_t SERVER_READ_BYTES = 64 * 1024;
+
+struct ServerConnection {
+    int fd;
+    bool listening;         // A listening socket rather than a client
+    size_t slot;            // Index in ServerState::connections
+    string inbox;           // Bytes of a request not complete yet
+    mutex outLock;
+    string outbox;          // Responses not written yet
+    bool writeWanted;       // Registered for EPOLLOUT
+    bool readClosed;        // The client shut down its side; answer what it sent, then close
+    // Guarded by the state's completionLock: commands still running for this
+    // connection, whether the socket is gone, and whether it is in the
+    // completed list (a queued connection is never freed)
+    int pending;
+    bool closed;
+    bool queued;
+};
+
+struct ServerCommandEntry {
+    ServerConnection* connection;
+    ServerRequest request;
+};
+
+struct ServerSession {
+    uint32_t id;
+    StrongholdGame* game;
+    uint64_t rngState;      // The session's random stream between commands
+    string savePath;
+    string scorePath;
+
+    mutex lock;             // Guards the two below
+    deque<ServerCommandEntry> queue;
+    bool scheduled;         // In the run queue or running on a worker
+};
+
+struct ServerState {
+    int threadCount;
+    string saveDirectory;
+    vector<int> listeners;
+    vector<string> unixPaths;
+    int epollFd;
+    int wakeFd;             // eventfd: completions and stop()
+    atomic<bool> stopping;
+
+    // Owned by the event loop thread
+    vector<ServerConnection*> connections; // Listeners and clients
+    unordered_map<uint32_t, ServerSession*> sessions; // Open sessions by id; CLOSE removes them
+    uint32_t nextSessionId;
+    atomic<size_t> openSessions;
+
+    // One writer thread for every session's saves
+    SaveWorker saves;
+
+    // Sessions with commands waiting, for the workers
+    mutex runLock;
+    condition_variable runReady;
+    deque<ServerSession*> runQueue;
+    bool workersStopping;
+
+    // Connections with responses to write, and closed sessions no worker
+    // will touch again, for the event loop
+    mutex completionLock;
+    vector<ServerConnection*> completed;
+    vector<ServerSession*> finished;
+};
+
+#ifdef __linux__
+
+// ========== Workers ==========
+
+// Helper to fill in the headline numbers of a session
+static void summarize(const StrongholdGame& game, ServerResponse& response) {
+    KingdomRecord record;
+    game.exportKingdom(record);
+    response.turn = game.getTurn();
+    response.population = record.total;
+    response.treasury = record.treasury;
+    response.soldiers = record.soldiers;
+    response.food = record.food;
+}
+
+// Helper to run one command on a worker
+static void execute(ServerState& state, ServerSession& session, const ServerRequest& request,
+                    ServerResponse& response) {
+    ScopedTrace span("server.command");
+    switch (request.command) {
+    case SERVER_OPEN: {
+        uint64_t seed = request.valueCount > 0 && request.values[0] != 0 ? (uint64_t)(uint32_t)request.values[0]
+                                                                          : GAME_DEFAULT_SEED;
+        session.game = new StrongholdGame(seed, session.savePath, session.scorePath);
+        session.game->setRivalThreads(0); // Two threads per session would not scale
+        session.game->setSaveWorker(&state.saves);
+        session.rngState = GameRandom::local().getState();
+        break;
+    }
+
+    case SERVER_PLAY: {
+        if (!session.game->isRunning()) {
+            response.status = SERVER_GAME_OVER;
+            break;
+        }
+        ReplayInput input;
+        for (int i = 0; i < request.valueCount; i++) {
+            input.add(request.values[i]);
+        }
+        GameRandom::local().setState(session.rngState);
+        InputProvider::setLocal(&input);
+        session.game->playChoice(input);
+        InputProvider::setLocal(nullptr);
+        session.rngState = GameRandom::local().getState();
+        break;
+    }
+
+    case SERVER_CLOSE:
+        delete session.game;
+        session.game = nullptr;
+        remove(session.savePath.c_str());
+        remove(session.scorePath.c_str());
+        state.openSessions.fetch_sub(1);
+        break;
+    }
+    if (session.game) summarize(*session.game, response);
+}
+
+// Helper to hand a connection to the event loop's next drainCompletions()
+static void complete(ServerState& state, ServerConnection* connection, bool fromWorker) {
+    {
+        lock_guard<mutex> guard(state.completionLock);
+        if (fromWorker) connection->pending--;
+        if (!connection->queued) state.completed.push_back(connection);
+        connection->queued = true;
+    }
+    uint64_t one = 1;
+    ssize_t ignored = write(state.wakeFd, &one, sizeof(one));
+    (void)ignored;
+}
+
+// Helper to queue a response and wake the event loop to write it
+static void respond(ServerState& state, ServerConnection* connection, const ServerResponse& response,
+                    bool fromWorker) {
+    {
+        lock_guard<mutex> guard(connection->outLock);
+        connection->outbox.append((const char*)&response, sizeof(response));
+    }
+    complete(state, connection, fromWorker);
+}
+
+static void runWorker(ServerState& state) {
+    Trace::setThreadName("server worker");
+    OutputSink::local().setMode(OUTPUT_QUIET);
+
+    while (true) {
+        ServerSession* session;
+        {
+            unique_lock<mutex> guard(state.runLock);
+            state.runReady.wait(guard, [&] { return !state.runQueue.empty() || state.workersStopping; });
+            if (state.runQueue.empty()) break;
+            session = state.runQueue.front();
+            state.runQueue.pop_front();
+        }
+
+        // Run what the session has queued, in order; it stays scheduled until empty
+        bool closing = false;
+        while (true) {
+            ServerCommandEntry entry;
+            {
+                lock_guard<mutex> guard(session->lock);
+                if (session->queue.empty()) {
+                    session->scheduled = false;
+                    break;
+                }
+                entry = session->queue.front();
+                session->queue.pop_front();
+            }
+            closing = closing || entry.request.command == SERVER_CLOSE;
+
+            ServerResponse response;
+            memset(&response, 0, sizeof(response));
+            response.requestId = entry.request.requestId;
+            response.session = session->id;
+            response.status = SERVER_OK;
+            execute(state, *session, entry.request, response);
+            respond(state, entry.connection, response, true);
+        }
+
+        // Nothing can be queued after CLOSE, so the event loop may free the session
+        if (closing) {
+            {
+                lock_guard<mutex> guard(state.completionLock);
+                state.finished.push_back(session);
+            }
+            uint64_t one = 1;
+            ssize_t ignored = write(state.wakeFd, &one, sizeof(one));
+            (void)ignored;
+        }
+    }
+}
+
+// ========== Event Loop ==========
+
+// Helper to answer a request the event loop can refuse by itself
+static void refuse(ServerState& state, ServerConnection* connection, const ServerRequest& request, int32_t status) {
+    ServerResponse response;
+    memset(&response, 0, sizeof(response));
+    response.requestId = request.requestId;
+    response.session = request.session;
+    response.status = status;
+    respond(state, connection, response, false);
+}
+
+// Helper to hand one request to its session
+static void dispatch(ServerState& state, ServerConnection* connection, const ServerRequest& request) {
+    if (request.valueCount > SERVER_MAX_VALUES ||
+        (request.command == SERVER_PLAY && request.valueCount == 0)) {
+        refuse(state, connection, request, SERVER_BAD_REQUEST);
+        return;
+    }
+
+    ServerSession* session;
+    if (request.command == SERVER_OPEN) {
+        session = new ServerSession();
+        session->id = state.nextSessionId++;
+        session->game = nullptr;
+        session->rngState = 0;
+        session->savePath = state.saveDirectory + "/session" + to_string(session->id) + ".save";
+        session->scorePath = state.saveDirectory + "/session" + to_string(session->id) + ".score";
+        session->scheduled = false;
+        state.sessions[session->id] = session;
+        state.openSessions.fetch_add(1);
+    } else if (request.command == SERVER_PLAY || request.command == SERVER_STATUS ||
+               request.command == SERVER_CLOSE) {
+        unordered_map<uint32_t, ServerSession*>::iterator found = state.sessions.find(request.session);
+        if (found == state.sessions.end()) {
+            refuse(state, connection, request, SERVER_NO_SESSION);
+            return;
+        }
+        session = found->second;
+        if (request.command == SERVER_CLOSE) state.sessions.erase(found); // Freed once its worker is done
+    } else {
+        refuse(state, connection, request, SERVER_BAD_REQUEST);
+        return;
+    }
+
+    {
+        lock_guard<mutex> guard(state.completionLock);
+        connection->pending++;
+    }
+    ServerCommandEntry entry = { connection, request };
+    bool schedule;
+    {
+        lock_guard<mutex> guard(session->lock);
+        session->queue.push_back(entry);
+        schedule = !session->scheduled;
+        session->scheduled = true;
+    }
+    if (schedule) {
+        {
+            lock_guard<mutex> guard(state.runLock);
+            state.runQueue.push_back(session);
+        }
+        state.runReady.notify_one();
+    }
+}
+
+// Helper to write as much of a connection's outbox as the socket takes
+static void flush(ServerState& state, ServerConnection* connection) {
+    lock_guard<mutex> guard(connection->outLock);
+    size_t sent = 0;
+    while (sent < connection->outbox.size()) {
+        ssize_t n = send(connection->fd, connection->outbox.data() + sent, connection->outbox.size() - sent,
+                         MSG_NOSIGNAL);
+        if (n <= 0) break;
+        sent += (size_t)n;
+    }
+    connection->outbox.erase(0, sent);
+
+    bool wantWrite = !connection->outbox.empty();
+    if (wantWrite != connection->writeWanted) {
+        epoll_event event;
+        event.events = (connection->readClosed ? 0u : (uint32_t)EPOLLIN) | (wantWrite ? (uint32_t)EPOLLOUT : 0u);
+        event.data.ptr = connection;
+        epoll_ctl(state.epollFd, EPOLL_CTL_MOD, connection->fd, &event);
+        connection->writeWanted = wantWrite;
+    }
+}
+
+// Helper to track a socket in the event loop
+static ServerConnection* watch(ServerState& state, int fd, bool listening) {
+    ServerConnection* connection = new ServerConnection();
+    connection->fd = fd;
+    connection->listening = listening;
+    connection->slot = state.connections.size();
+    connection->writeWanted = false;
+    connection->readClosed = false;
+    connection->pending = 0;
+    connection->closed = false;
+    connection->queued = false;
+    state.connections.push_back(connection);
+
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = connection;
+    epoll_ctl(state.epollFd, EPOLL_CTL_ADD, fd, &event);
+    return connection;
+}
+
+// Helper to free a connection the event loop no longer needs
+static void release(ServerState& state, ServerConnection* connection) {
+    ServerConnection* last = state.connections.back();
+    state.connections[connection->slot] = last;
+    last->slot = connection->slot;
+    state.connections.pop_back();
+    delete connection;
+}
+
+// Helper to drop a connection. It may still sit in the completed list, so
+// only drainCompletions() frees it, once no command is running for it.
+static void disconnect(ServerState& state, ServerConnection* connection) {
+    epoll_ctl(state.epollFd, EPOLL_CTL_DEL, connection->fd, nullptr);
+    close(connection->fd);
+    connection->fd = -1;
+    {
+        lock_guard<mutex> guard(state.completionLock);
+        connection->closed = true;
+    }
+    complete(state, connection, false);
+}
+
+// Helper to close a half-closed connection once every answer has been written
+static void closeIfAnswered(ServerState& state, ServerConnection* connection) {
+    if (!connection->readClosed || connection->closed) return;
+    bool idle, written;
+    {
+        lock_guard<mutex> guard(state.completionLock);
+        idle = connection->pending == 0;
+    }
+    {
+        lock_guard<mutex> guard(connection->outLock);
+        written = connection->outbox.empty();
+    }
+    if (idle && written) disconnect(state, connection);
+}
+
+// Helper to read whatever a connection sent and dispatch every whole request
+static void receive(ServerState& state, ServerConnection* connection) {
+    if (connection->readClosed) {
+        disconnect(state, connection); // Hung up while its answers were still going out
+        return;
+    }
+
+    char buffer[SERVER_READ_BYTES];
+    bool ended = false;
+    while (true) {
+        ssize_t n = recv(connection->fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            connection->inbox.append(buffer, (size_t)n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (n < 0) {
+            disconnect(state, connection); // Failed; nobody is left to answer
+            return;
+        }
+        ended = true; // The client is done sending, but may still be reading
+        break;
+    }
+
+    size_t used = 0;
+    while (connection->inbox.size() - used >= sizeof(ServerRequest)) {
+        ServerRequest request;
+        memcpy(&request, connection->inbox.data() + used, sizeof(request));
+        used += sizeof(request);
+        dispatch(state, connection, request);
+    }
+    connection->inbox.erase(0, used);
+
+    if (ended) {
+        // Stop listening for input; drainCompletions() closes it once answered
+        connection->readClosed = true;
+        epoll_event event;
+        event.events = connection->writeWanted ? (uint32_t)EPOLLOUT : 0u;
+        event.data.ptr = connection;
+        epoll_ctl(state.epollFd, EPOLL_CTL_MOD, connection->fd, &event);
+        complete(state, connection, false);
+    }
+}
+
+// Helper to free the closed sessions the workers have handed back
+static void releaseSessions(ServerState& state) {
+    vector<ServerSession*> finished;
+    {
+        lock_guard<mutex> guard(state.completionLock);
+        finished.swap(state.finished);
+    }
+    for (size_t i = 0; i < finished.size(); i++) {
+        delete finished[i];
+    }
+}
+
+// Helper to write out finished responses and free connections and sessions that are done
+static void drainCompletions(ServerState& state) {
+    uint64_t count;
+    ssize_t ignored = read(state.wakeFd, &count, sizeof(count));
+    (void)ignored;
+
+    releaseSessions(state);
+    vector<ServerConnection*> completed;
+    {
+        lock_guard<mutex> guard(state.completionLock);
+        completed.swap(state.completed);
+        for (size_t i = 0; i < completed.size(); i++) {
+            completed[i]->queued = false;
+        }
+    }
+
+    for (size_t i = 0; i < completed.size(); i++) {
+        ServerConnection* connection = completed[i];
+        bool closed, idle;
+        {
+            // A worker that finished since the swap queued it again; the next drain frees it
+            lock_guard<mutex> guard(state.completionLock);
+            closed = connection->closed;
+            idle = connection->pending == 0 && !connection->queued;
+        }
+        if (!closed) {
+            flush(state, connection);
+            closeIfAnswered(state, connection);
+        } else if (idle) {
+            release(state, connection);
+        }
+    }
+}
+
+static void acceptClients(ServerState& state, int listener) {
+    while (true) {
+        int fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) break;
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on)); // Fails harmlessly on Unix sockets
+        watch(state, fd, false);
+    }
+}
+
+#endif
+
+// ========== Session Server ==========
+
+SessionServer::SessionServer(int threads, const string& saveDirectory) {
+    state = new ServerState();
+    state->threadCount = threads > 0 ? threads : (int)thread::hardware_concurrency();
+    if (state->threadCount <= 0) state->threadCount = 1;
+    state->saveDirectory = saveDirectory;
+    state->epollFd = -1;
+    state->wakeFd = -1;
+    state->stopping = false;
+    state->nextSessionId = 1;
+    state->openSessions = 0;
+    state->workersStopping = false;
+}
+
+// Destructor closes the sockets and ends every session still open
+SessionServer::~SessionServer() {
+#ifdef __linux__
+    for (size_t i = 0; i < state->listeners.size(); i++) {
+        close(state->listeners[i]);
+    }
+    for (size_t i = 0; i < state->unixPaths.size(); i++) {
+        unlink(state->unixPaths[i].c_str());
+    }
+#endif
+    for (unordered_map<uint32_t, ServerSession*>::iterator i = state->sessions.begin();
+         i != state->sessions.end(); ++i) {
+        ServerSession* session = i->second;
+        if (session->game) {
+            delete session->game;
+            remove(session->savePath.c_str());
+            remove(session->scorePath.c_str());
+        }
+        delete session;
+    }
+    delete state;
+}
+
+bool SessionServer::listenUnix(const string& path) {
+#ifdef __linux__
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        cerr << "Error: Server socket path is too long.\n";
+        return false;
+    }
+    strcpy(address.sun_path, path.c_str());
+
+    int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    unlink(path.c_str());
+    if (listener < 0 || bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 1024) != 0) {
+        if (listener >= 0) close(listener);
+        cerr << "Error: Could not listen on " << path << ".\n";
+        return false;
+    }
+    state->listeners.push_back(listener);
+    state->unixPaths.push_back(path);
+    return true;
+#else
+    (void)path;
+    cerr << "Error: The session server needs Linux.\n";
+    return false;
+#endif
+}
+
+// Listen on 127.0.0.1 only; the protocol has no authentication
+bool SessionServer::listenTcp(int port) {
+#ifdef __linux__
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons((uint16_t)port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int listener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int on = 1;
+    if (listener >= 0) setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (listener < 0 || bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 1024) != 0) {
+        if (listener >= 0) close(listener);
+        cerr << "Error: Could not listen on port " << port << ".\n";
+        return false;
+    }
+    state->listeners.push_back(listener);
+    return true;
+#else
+    (void)port;
+    cerr << "Error: The session server needs Linux.\n";
+    return false;
+#endif
+}
+
+bool SessionServer::run() {
+#ifdef __linux__
+    if (state->listeners.empty()) {
+        cerr << "Error: The server has nothing to listen on.\n";
+        return false;
+    }
+    state->epollFd = epoll_create1(EPOLL_CLOEXEC);
+    state->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (state->epollFd < 0 || state->wakeFd < 0) {
+        cerr << "Error: Could not create the server event loop.\n";
+        return false;
+    }
+    epoll_event wake;
+    wake.events = EPOLLIN;
+    wake.data.ptr = nullptr;
+    epoll_ctl(state->epollFd, EPOLL_CTL_ADD, state->wakeFd, &wake);
+    for (size_t i = 0; i < state->listeners.size(); i++) {
+        watch(*state, state->listeners[i], true);
+    }
+
+    SmallVector<thread, INLINE_THREADS> workers((size_t)state->threadCount);
+    for (int t = 0; t < state->threadCount; t++) {
+        workers[t] = thread(runWorker, ref(*state));
+    }
+
+    Trace::setThreadName("server loop");
+    const int EVENTS = 256;
+    epoll_event events[EVENTS];
+    while (!state->stopping.load()) {
+        int ready = epoll_wait(state->epollFd, events, EVENTS, -1);
+        for (int i = 0; i < ready; i++) {
+            ServerConnection* connection = (ServerConnection*)events[i].data.ptr;
+            if (!connection) {
+                drainCompletions(*state);
+            } else if (connection->listening) {
+                acceptClients(*state, connection->fd);
+            } else if (!connection->closed) { // Closed earlier in this batch, freed by the next drain
+                if (events[i].events & EPOLLOUT) {
+                    flush(*state, connection);
+                    closeIfAnswered(*state, connection);
+                }
+                if (!connection->closed && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+                    receive(*state, connection);
+                }
+            }
+        }
+    }
+
+    // Let the workers finish what is queued, then drop every client
+    {
+        lock_guard<mutex> guard(state->runLock);
+        state->workersStopping = true;
+    }
+    state->runReady.notify_all();
+    for (int t = 0; t < state->threadCount; t++) {
+        workers[t].join();
+    }
+    releaseSessions(*state);
+
+    for (size_t i = 0; i < state->connections.size(); i++) {
+        ServerConnection* connection = state->connections[i];
+        if (!connection->listening && connection->fd >= 0) close(connection->fd);
+        delete connection;
+    }
+    state->connections.clear();
+    close(state->epollFd);
+    close(state->wakeFd);
+    state->epollFd = -1;
+    state->wakeFd = -1;
+    return true;
+#else
+    cerr << "Error: The session server needs Linux.\n";
+    return false;
+#endif
+}
+
+void SessionServer::stop() {
+    state->stopping.store(true);
+#ifdef __linux__
+    if (state->wakeFd >= 0) {
+        uint64_t one = 1;
+        ssize_t ignored = write(state->wakeFd, &one, sizeof(one));
+        (void)ignored;
+    }
+#endif
+}
+
+size_t SessionServer::getSessionCount() const {
+    return state->openSessions.load();
+}
@@ -0,0 +1,279 @@
+#include "Stronghold.h"
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+// Chunks in flight: one being read, one being ticked, one being written
+static const int STREAM_BUFFERS = 3;
+
+// Regional food market settings
+static const float FOOD_BASE_PRICE = 2.0f;
+static const float FOOD_MIN_PRICE = 1.0f;
+static const float FOOD_MAX_PRICE = 8.0f;
+static const int FOOD_PER_PERSON = 2;
+
+// Helper to seek past 2 GB on every platform
+static bool seekTo(FILE* file, long long offset) {
+#ifdef _WIN32
+    return _fseeki64(file, offset, SEEK_SET) == 0;
+#else
+    return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+// ========== Chunk Queue ==========
+
+// Blocking queue of buffer indexes passed between the reader, the compute
+// loop and the writer. -1 marks the end of the turn.
+class StreamChunkQueue {
+public:
+    void push(int buffer) {
+        {
+            lock_guard<mutex> guard(lock);
+            items.push_back(buffer);
+        }
+        ready.notify_one();
+    }
+
+    int pop() {
+        unique_lock<mutex> guard(lock);
+        ready.wait(guard, [this] { return !items.empty(); });
+        int buffer = items.front();
+        items.pop_front();
+        return buffer;
+    }
+
+private:
+    mutex lock;
+    condition_variable ready;
+    deque<int> items;
+};
+
+// One buffer's worth of kingdoms
+struct StreamChunk {
+    SmallVector<KingdomRecord, 0> records;
+    long long first;
+    int count;
+    bool ok;
+};
+
+// ========== Streaming Simulator ==========
+
+// Constructor only records the settings; open() reads the file header
+StreamingSimulator::StreamingSimulator(const string& scenarioPath, int chunkKingdoms, int regionSize)
+    : path(scenarioPath) {
+    this->chunkKingdoms = chunkKingdoms > 0 ? chunkKingdoms : 1;
+    this->regionSize = regionSize > 0 ? regionSize : 1;
+    kingdomCount = 0;
+    turn = 0;
+
+    previous.resize(REGION_COUNT);
+    current.resize(REGION_COUNT);
+    for (int r = 0; r < REGION_COUNT; r++) {
+        previous[r].foodPrice = FOOD_BASE_PRICE;
+    }
+}
+
+// Check the file header; must succeed before running turns
+bool StreamingSimulator::open() {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        cerr << "Error: Could not open " << path << " for streaming.\n";
+        return false;
+    }
+
+    ScenarioHeader header;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 && isScenarioHeaderValid(header);
+    fclose(file);
+    if (!valid) {
+        cerr << "Error: " << path << " is not a binary scenario this build can read.\n";
+        return false;
+    }
+
+    kingdomCount = (long long)header.kingdomCount;
+    return true;
+}
+
+// Helper method to find the region a kingdom's army stands in
+int StreamingSimulator::regionOf(const KingdomRecord& record) const {
+    int cellX = record.armyX > 0 ? record.armyX / regionSize : 0;
+    int cellY = record.armyY > 0 ? record.armyY / regionSize : 0;
+    if (cellX >= REGION_GRID) cellX = REGION_GRID - 1;
+    if (cellY >= REGION_GRID) cellY = REGION_GRID - 1;
+    return cellY * REGION_GRID + cellX;
+}
+
+// Helper method to run one kingdom through a turn
+void StreamingSimulator::tickKingdom(KingdomRecord& record) {
+    int region = regionOf(record);
+    const RegionSummary& market = previous[region];
+    RegionSummary& summary = current[region];
+
+    // Regional food market at last turn's price: buyers are filled and sellers
+    // cleared in proportion to last turn's supply and demand
+    int needed = record.total * FOOD_PER_PERSON + record.soldiers;
+    int stock = record.food;
+    if (stock < needed) {
+        int shortage = needed - stock;
+        summary.foodDemand += shortage;
+
+        double fill = market.foodDemand > 0.0 ? market.foodSupply / market.foodDemand : 0.0;
+        if (fill > 1.0) fill = 1.0;
+        int affordable = record.treasury > 0 ? (int)(record.treasury / market.foodPrice) : 0;
+        int bought = (int)(shortage * fill);
+        if (bought > affordable) bought = affordable;
+        record.food += bought;
+        record.treasury -= (int)(bought * market.foodPrice);
+    } else {
+        int surplus = (stock - needed) / 2; // Keep half the surplus in reserve
+        summary.foodSupply += surplus;
+
+        double cleared = market.foodSupply > 0.0 ? market.foodDemand / market.foodSupply : 0.0;
+        if (cleared > 1.0) cleared = 1.0;
+        int sold = (int)(surplus * cleared);
+        record.food -= sold;
+        record.treasury += (int)(sold * market.foodPrice);
+    }
+
+    // The granary feeds the people and the army
+    int toPeople = record.food < record.total * FOOD_PER_PERSON ? record.food : record.total * FOOD_PER_PERSON;
+    record.foodStock += toPeople;
+    record.food -= toPeople;
+    int toArmy = record.food < record.soldiers ? record.food : record.soldiers;
+    record.armyFood += toArmy;
+    record.food -= toArmy;
+
+    Population pop;
+    Army army;
+    Economy eco;
+    ResourceManager res;
+    pop.importState(record);
+    army.importState(record);
+    eco.importState(record);
+    res.importState(record);
+
+    pop.simulate();
+    eco.taxPopulation(pop);
+
+    // Soldiers eat from the army's own supply; hungry armies lose heart
+    if (army.getFoodSupply() < army.getSoldiers()) {
+        army.lowerMorale(5);
+    }
+
+    pop.exportState(record);
+    army.exportState(record);
+    eco.exportState(record);
+    res.exportState(record);
+    record.armyFood -= record.armyFood < record.soldiers ? record.armyFood : record.soldiers;
+
+    summary.kingdoms++;
+    summary.population += record.total;
+    summary.soldiers += record.soldiers;
+    summary.treasury += record.treasury;
+}
+
+// Stream every kingdom through one turn
+bool StreamingSimulator::runTurn() {
+    if (kingdomCount <= 0) return kingdomCount == 0;
+
+    FILE* in = fopen(path.c_str(), "rb");
+    FILE* out = fopen(path.c_str(), "r+b");
+    if (!in || !out) {
+        if (in) fclose(in);
+        if (out) fclose(out);
+        cerr << "Error: Could not open " << path << " for streaming.\n";
+        return false;
+    }
+
+    StreamChunk buffers[STREAM_BUFFERS];
+    for (int b = 0; b < STREAM_BUFFERS; b++) {
+        buffers[b].records.resizeForOverwrite(chunkKingdoms);
+        buffers[b].ok = true;
+    }
+    StreamChunkQueue freeBuffers, readBuffers, tickedBuffers;
+    for (int b = 0; b < STREAM_BUFFERS; b++) {
+        freeBuffers.push(b);
+    }
+
+    long long chunks = (kingdomCount + chunkKingdoms - 1) / chunkKingdoms;
+    long long recordsStart = (long long)sizeof(ScenarioHeader);
+
+    // Reader: fill free buffers ahead of the compute loop
+    thread reader([&]() {
+        Trace::setThreadName("stream reader");
+        for (long long c = 0; c < chunks; c++) {
+            int b = freeBuffers.pop();
+            ScopedTrace span("stream.read");
+            StreamChunk& chunk = buffers[b];
+            chunk.first = c * chunkKingdoms;
+            long long remaining = kingdomCount - chunk.first;
+            chunk.count = remaining < chunkKingdoms ? (int)remaining : chunkKingdoms;
+            chunk.ok = seekTo(in, recordsStart + chunk.first * (long long)sizeof(KingdomRecord)) &&
+                       fread(chunk.records.data(), sizeof(KingdomRecord), chunk.count, in) == (size_t)chunk.count;
+            readBuffers.push(b);
+        }
+        readBuffers.push(-1);
+    });
+
+    // Writer: put ticked chunks back where they came from
+    bool written = true;
+    thread writer([&]() {
+        Trace::setThreadName("stream writer");
+        int b;
+        while ((b = tickedBuffers.pop()) >= 0) {
+            ScopedTrace span("stream.write");
+            StreamChunk& chunk = buffers[b];
+            if (chunk.ok) {
+                chunk.ok = seekTo(out, recordsStart + chunk.first * (long long)sizeof(KingdomRecord)) &&
+                           fwrite(chunk.records.data(), sizeof(KingdomRecord), chunk.count, out) == (size_t)chunk.count;
+            }
+            if (!chunk.ok) written = false;
+            freeBuffers.push(b);
+        }
+    });
+
+    // Compute on this thread, between the two
+    {
+        MutedOutput muted;
+        int b;
+        while ((b = readBuffers.pop()) >= 0) {
+            ScopedTrace span("stream.tick");
+            StreamChunk& chunk = buffers[b];
+            if (chunk.ok) {
+                for (int i = 0; i < chunk.count; i++) {
+                    tickKingdom(chunk.records[i]);
+                }
+            }
+            tickedBuffers.push(b);
+        }
+        tickedBuffers.push(-1);
+    }
+
+    reader.join();
+    writer.join();
+    fclose(in);
+    written = fclose(out) == 0 && written;
+
+    if (!written) {
+        cerr << "Error: Could not stream turn " << turn + 1 << " through " << path << ".\n";
+        return false;
+    }
+
+    // This turn's totals set next turn's prices
+    for (int r = 0; r < REGION_COUNT; r++) {
+        RegionSummary& summary = current[r];
+        float pressure = summary.foodSupply > 0.0 ? (float)(summary.foodDemand / summary.foodSupply) : FOOD_MAX_PRICE;
+        float price = FOOD_BASE_PRICE * pressure;
+        if (price < FOOD_MIN_PRICE) price = FOOD_MIN_PRICE;
+        if (price > FOOD_MAX_PRICE) price = FOOD_MAX_PRICE;
+        summary.foodPrice = summary.foodDemand > 0.0 ? price : FOOD_MIN_PRICE;
+    }
+    swap(current, previous);
+    memset(current.data(), 0, sizeof(RegionSummary) * REGION_COUNT);
+
+    turn++;
+    return true;
+}
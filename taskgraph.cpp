@@ -0,0 +1,233 @@
+#include "Stronghold.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// One run of a graph: what is left to do and who is waiting for it
+struct TaskRun {
+    const TaskPhase* phases;
+    uint64_t callerOnly;
+    int pending[TASK_GRAPH_MAX_PHASES]; // Unfinished phases each phase waits on
+    int unfinished;
+    deque<int> callerReady;             // Ready phases only the caller may run
+    bool callerWaiting;
+    condition_variable wake;            // The caller waits here
+};
+
+struct TaskJob {
+    TaskRun* run;
+    int phase;
+};
+
+struct TaskExecutorState {
+    mutex lock;                // Guards everything below and every TaskRun
+    condition_variable ready;
+    deque<TaskJob> jobs;
+    bool stopping;
+    SmallVector<thread, INLINE_THREADS> workers;
+    int threadCount;
+};
+
+static void runPhase(const TaskPhase& phase) {
+    ScopedTrace span(phase.name);
+    phase.run();
+}
+
+// Helper to queue a phase whose waits are over; true if any thread may run it
+static bool dispatch(TaskExecutorState& state, TaskRun& run, int phase) {
+    const TaskPhase& ready = run.phases[phase];
+    if ((ready.reads | ready.writes) & run.callerOnly) {
+        run.callerReady.push_back(phase);
+        return false;
+    }
+    TaskJob job = { &run, phase };
+    state.jobs.push_back(job);
+    return true;
+}
+
+// Helper to wake threads for newly queued phases. The thread that queued
+// them takes one itself, so short phases never pay for a wakeup; workers are
+// only woken for the phases left over, which can truly run alongside.
+static void wakeFor(TaskExecutorState& state, TaskRun& run, int jobs, bool byCaller) {
+    if (!byCaller && (!run.callerReady.empty() || (run.callerWaiting && jobs > 1))) {
+        run.wake.notify_one();
+        if (run.callerReady.empty()) jobs--; // The caller will take one
+    }
+    bool takesOne = byCaller ? run.callerReady.empty() : true;
+    for (int i = takesOne ? 1 : 0; i < jobs; i++) {
+        state.ready.notify_one();
+    }
+}
+
+// Helper to release what waited on a finished phase; called with the lock held
+static void finish(TaskExecutorState& state, TaskRun& run, int phase, bool byCaller) {
+    uint64_t successors = run.phases[phase].successors;
+    int jobs = 0;
+    for (int next = 0; successors != 0; next++, successors >>= 1) {
+        if ((successors & 1) && --run.pending[next] == 0 && dispatch(state, run, next)) jobs++;
+    }
+    if (--run.unfinished == 0 && !byCaller) run.wake.notify_one();
+    wakeFor(state, run, jobs, byCaller);
+}
+
+static void runTaskWorker(TaskExecutorState& state) {
+    Trace::setThreadName("task worker");
+    OutputSink::local().setMode(OUTPUT_QUIET); // Phases that print run on their caller or hold it for them
+    unique_lock<mutex> guard(state.lock);
+    while (true) {
+        if (state.jobs.empty()) TurnArena::local().reset(); // Between turns, nothing of theirs is left
+        state.ready.wait(guard, [&] { return !state.jobs.empty() || state.stopping; });
+        if (state.jobs.empty()) return;
+        TaskJob job = state.jobs.front();
+        state.jobs.pop_front();
+        guard.unlock();
+        runPhase(job.run->phases[job.phase]);
+        guard.lock();
+        finish(state, *job.run, job.phase, false);
+    }
+}
+
+// ========== Executor ==========
+
+TaskExecutor::TaskExecutor(int threads) {
+    if (threads <= 0) {
+        int cores = (int)thread::hardware_concurrency();
+        threads = cores > 1 ? cores - 1 : 1;
+    }
+    state = new TaskExecutorState();
+    state->stopping = false;
+    state->threadCount = threads;
+    state->workers.resize(threads);
+    for (int i = 0; i < threads; i++) {
+        state->workers[i] = thread(runTaskWorker, ref(*state));
+    }
+}
+
+// Destructor lets queued phases finish, then stops the workers
+TaskExecutor::~TaskExecutor() {
+    {
+        lock_guard<mutex> guard(state->lock);
+        state->stopping = true;
+    }
+    state->ready.notify_all();
+    for (int i = 0; i < state->threadCount; i++) {
+        state->workers[i].join();
+    }
+    delete state;
+}
+
+int TaskExecutor::getThreadCount() const {
+    return state->threadCount;
+}
+
+// ========== Graph ==========
+
+TaskGraph::TaskGraph() {
+    callerOnly = 0;
+}
+
+int TaskGraph::add(const char* name, uint64_t reads, uint64_t writes, uint64_t after, function<void()> run) {
+    int index = (int)phases.size();
+    if (index >= TASK_GRAPH_MAX_PHASES || (after >> index) != 0) {
+        cerr << "Error: Task phase " << name << " waits on a phase not added before it.\n";
+        return -1;
+    }
+    TaskPhase phase = { name, reads, writes, after, 0, run };
+    phases.push_back(phase);
+    for (int i = 0; i < index; i++) {
+        if (after & ((uint64_t)1 << i)) phases[i].successors |= (uint64_t)1 << index;
+    }
+    return index;
+}
+
+void TaskGraph::setCallerOnly(uint64_t state) {
+    callerOnly = state;
+}
+
+size_t TaskGraph::size() const {
+    return phases.size();
+}
+
+// Helper to check that phases free to run together leave each other's state alone
+bool TaskGraph::validate() const {
+    uint64_t before[TASK_GRAPH_MAX_PHASES]; // Every phase that must finish first
+    bool valid = true;
+    for (size_t i = 0; i < phases.size(); i++) {
+        before[i] = phases[i].after;
+        for (size_t j = 0; j < i; j++) {
+            if (phases[i].after & ((uint64_t)1 << j)) before[i] |= before[j];
+        }
+        for (size_t j = 0; j < i; j++) {
+            if (before[i] & ((uint64_t)1 << j)) continue;
+            const TaskPhase& a = phases[j];
+            const TaskPhase& b = phases[i];
+            uint64_t clash = (a.writes & (b.reads | b.writes)) | (b.writes & a.reads);
+            if (clash) {
+                cerr << "Error: Task phases " << a.name << " and " << b.name
+                     << " may run together but share written state (mask 0x" << hex << clash << dec << ").\n";
+                valid = false;
+            }
+        }
+    }
+    return valid;
+}
+
+bool TaskGraph::run(TaskExecutor* executor) {
+#ifndef NDEBUG
+    if (!validate()) return false;
+#endif
+    if (!executor) {
+        for (size_t i = 0; i < phases.size(); i++) {
+            runPhase(phases[i]);
+        }
+        return true;
+    }
+    if (phases.empty()) return true;
+
+    TaskExecutorState& state = *executor->state;
+    TaskRun run;
+    run.phases = phases.data();
+    run.callerOnly = callerOnly;
+    run.unfinished = (int)phases.size();
+    run.callerWaiting = false;
+
+    unique_lock<mutex> guard(state.lock);
+    int jobs = 0;
+    for (size_t i = 0; i < phases.size(); i++) {
+        uint64_t after = phases[i].after;
+        int waits = 0;
+        for (; after != 0; after &= after - 1) waits++;
+        run.pending[i] = waits;
+        if (waits == 0 && dispatch(state, run, (int)i)) jobs++;
+    }
+    wakeFor(state, run, jobs, true);
+
+    // The caller runs its own phases, and helps with the rest while it waits
+    while (run.unfinished > 0) {
+        int phase = -1;
+        if (!run.callerReady.empty()) {
+            phase = run.callerReady.front();
+            run.callerReady.pop_front();
+        } else {
+            for (deque<TaskJob>::iterator job = state.jobs.begin(); job != state.jobs.end(); ++job) {
+                if (job->run == &run) {
+                    phase = job->phase;
+                    state.jobs.erase(job);
+                    break;
+                }
+            }
+        }
+        if (phase < 0) {
+            run.callerWaiting = true;
+            run.wake.wait(guard);
+            run.callerWaiting = false;
+            continue;
+        }
+        guard.unlock();
+        runPhase(phases[(size_t)phase]);
+        guard.lock();
+        finish(state, run, phase, true);
+    }
+    return true;
+}
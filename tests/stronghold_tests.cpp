@@ -0,0 +1,264 @@
+#include "../Stronghold.h"
+#include <functional>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <thread>
+
+// Regression tests for behaviour the benchmarks do not check.
+//
+//   stronghold_tests [name]
+//
+// Runs every test, or only the one named (CTest runs each on its own).
+// The game's console output is muted; a failed check prints where it failed.
+
+struct TestCase {
+    string name;
+    function<bool()> run;   // True if every check held
+};
+
+// Helper to fail the running test with the condition that did not hold
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            return false; \
+        } \
+    } while (0)
+
+// Helper to count the soldiers of one side
+static float headCount(const BattleSide& side) {
+    float total = 0.0f;
+    for (int t = 0; t < UNIT_TYPES; t++) {
+        total += side.units[t];
+    }
+    return total;
+}
+
+// Helper to play four turns, recruiting a few soldiers each, and return what
+// the console showed. The game gets a thread of its own, so diff mode starts
+// with nothing rendered yet.
+static string playTurns(TaskExecutor* executor, OutputMode mode) {
+    ostringstream text;
+    streambuf* saved = cout.rdbuf(text.rdbuf());
+    thread player([&]() {
+        ReplayInput script;
+        for (int turn = 0; turn < 4; turn++) {
+            script.add(10);
+            script.add(turn == 2 ? 5 : 50);
+        }
+        InputProvider::setLocal(&script);
+        OutputSink::local().setMode(mode);
+        StrongholdGame game(GAME_DEFAULT_SEED, "test_save.txt", "test_score.txt");
+        game.setRivalThreads(0);
+        game.setTurnExecutor(executor);
+        game.play(script);
+        OutputSink::local().flush();
+    });
+    player.join();
+    cout.rdbuf(saved);
+    return text.str();
+}
+
+static void addTests(vector<TestCase>& tests) {
+    // Two identical armies meet twice; the second time the defenders are drilled
+    tests.push_back({ "battle.strengthFactors", []() {
+        BattleSide side = { { 600.0f, 150.0f, 200.0f, 30.0f, 20.0f }, 80.0f, 500.0f };
+        float drilled[UNIT_TYPES] = { 1.5f, 1.5f, 1.5f, 1.5f, 1.5f };
+
+        BattleBatch battle(2);
+        battle.setAttacker(0, side, nullptr);
+        battle.setDefender(0, side, nullptr);
+        battle.setAttacker(1, side, nullptr);
+        battle.setDefender(1, side, drilled);
+        BattleEngine::resolveBatch(battle);
+
+        float start = headCount(side);
+        float evenAttackerLosses = start - headCount(battle.getAttacker(0));
+        float evenDefenderLosses = start - headCount(battle.getDefender(0));
+        float drilledAttackerLosses = start - headCount(battle.getAttacker(1));
+        float drilledDefenderLosses = start - headCount(battle.getDefender(1));
+        CHECK(evenDefenderLosses > 0.0f && drilledDefenderLosses > 0.0f);
+        CHECK(drilledDefenderLosses < evenDefenderLosses);
+        CHECK(drilledAttackerLosses / drilledDefenderLosses > evenAttackerLosses / evenDefenderLosses * 1.2f);
+        return true;
+    } });
+
+    // The army's training survives a save and load
+    tests.push_back({ "army.unitStrengthSaved", []() {
+        Army army;
+        army.setUnitStrength(0, 1.3f);
+        army.setUnitStrength(2, 0.7f);
+        KingdomRecord record = {};
+        vector<LoanRecord> loans;
+        Population().exportState(record);
+        army.exportState(record);
+        Economy().exportState(record);
+        ResourceManager().exportState(record);
+        Bank().exportState(record, loans);
+        string text;
+        appendKingdomText(text, 0, record, nullptr, 0);
+
+        KingdomTable table;
+        CHECK(ScenarioLoader(1).parse(text.data(), text.size(), table));
+        Army loaded;
+        loaded.importState(table.get(0));
+        CHECK(loaded.getUnitStrength()[0] == 1.3f);
+        CHECK(loaded.getUnitStrength()[1] == 1.0f);
+        CHECK(loaded.getUnitStrength()[2] == 0.7f);
+        return true;
+    } });
+
+    // A kingdom listed twice is rejected, whether or not both copies land in one piece
+    tests.push_back({ "scenario.duplicateKingdom", []() {
+        KingdomTable defaults;
+        defaults.reset(1);
+        KingdomRecord record = defaults.get(0);
+        string text;
+        for (int k = 0; k < 2000; k++) {
+            appendKingdomText(text, k, record, nullptr, 0);
+        }
+        KingdomTable table;
+        CHECK(ScenarioLoader(4).parse(text.data(), text.size(), table));
+        CHECK(table.getKingdomCount() == 2000);
+
+        string twice = text;
+        appendKingdomText(twice, 5, record, nullptr, 0);
+        CHECK(!ScenarioLoader(4).parse(twice.data(), twice.size(), table));
+
+        string small;
+        appendKingdomText(small, 1, record, nullptr, 0);
+        appendKingdomText(small, 1, record, nullptr, 0);
+        CHECK(!ScenarioLoader(1).parse(small.data(), small.size(), table));
+        return true;
+    } });
+
+    // Steady income, then a new but normal rhythm: the detector adapts instead of freezing
+    tests.push_back({ "anomaly.steadyThenRegimeChange", []() {
+        TreasuryMonitor monitor;
+        int treasury = 1000;
+        monitor.observe(0, treasury, 0);
+        for (int turn = 0; turn < 6; turn++) {
+            treasury += 10;
+            monitor.observe(0, treasury, 0);
+        }
+
+        int lateAlerts = 0;
+        for (int turn = 0; turn < 40; turn++) {
+            treasury += turn % 2 == 0 ? 40 : -20;
+            monitor.observe(0, treasury, 0);
+            int worstDrop;
+            if (monitor.takeAlerts(0, worstDrop) != 0 && turn >= 20) lateAlerts++;
+        }
+
+        const StreamStats& deltas = monitor.getStats(0).treasuryDeltas;
+        CHECK(lateAlerts == 0);
+        CHECK(deltas.variance > 100.0f);
+        CHECK(deltas.low.estimate() < 0.0f); // The sketch sees the raw drops
+        return true;
+    } });
+
+    // A fast tier compounds far past the rebase point without losing balances
+    tests.push_back({ "ledger.indexRebase", []() {
+        LoanLedger ledger;
+        ledger.setTierRate(7, 0.5);
+        int early = ledger.issue(0, 100.0, 7, LOAN_MAX_TERM - 1);
+        double expected = 100.0;
+        for (int turn = 0; turn < 60; turn++) {
+            ledger.advanceTurn();
+            expected *= 1.5;
+        }
+        CHECK(fabs(ledger.balance(early) / expected - 1.0) < 1e-9);
+        CHECK(fabs(ledger.totalOutstanding() / expected - 1.0) < 1e-9);
+        ledger.writeOff(early);
+
+        // 1.5^2000 would overflow an index that is never rebased
+        for (int turn = 0; turn < 2000; turn++) {
+            ledger.advanceTurn();
+        }
+        int late = ledger.issue(0, 1000.0, 7, 10);
+        ledger.advanceTurn();
+        CHECK(fabs(ledger.balance(late) - 1500.0) < 1e-6);
+        CHECK(fabs(ledger.totalOutstanding() - 1500.0) < 1e-6);
+        return true;
+    } });
+
+    // Two phases that wait for each other only finish if they run at the same
+    // time; what they print still comes out in the order they were added
+    tests.push_back({ "taskgraph.phasesOverlap", []() {
+        TaskExecutor executor(1);
+        atomic<int> started(0);
+        atomic<int> met(0);
+        OutputSink held[2] = { OutputSink(true), OutputSink(true) };
+        TaskGraph graph;
+        for (int p = 0; p < 2; p++) {
+            graph.add(p == 0 ? "first" : "second", 0, (uint64_t)1 << p, 0, [&, p]() {
+                RedirectedOutput into(held[p]);
+                started++;
+                chrono::steady_clock::time_point giveUp = chrono::steady_clock::now() + chrono::seconds(5);
+                while (started.load() < 2 && chrono::steady_clock::now() < giveUp) {
+                    this_thread::yield();
+                }
+                if (started.load() == 2) met++;
+                console() << (p == 0 ? "first\n" : "second\n");
+            });
+        }
+        CHECK(graph.run(&executor));
+        CHECK(met.load() == 2);
+
+        ostringstream text;
+        streambuf* saved = cout.rdbuf(text.rdbuf());
+        OutputSink::local().setMode(OUTPUT_BUFFERED);
+        held[0].replayInto(OutputSink::local());
+        held[1].replayInto(OutputSink::local());
+        OutputSink::local().flush();
+        OutputSink::local().setMode(OUTPUT_QUIET);
+        cout.rdbuf(saved);
+        CHECK(text.str() == "first\nsecond\n");
+        return true;
+    } });
+
+    // A turn's phases print the same whether or not they run on other threads
+    tests.push_back({ "turn.threadedOutputMatchesSerial", []() {
+        TaskExecutor executor(2);
+        OutputMode modes[2] = { OUTPUT_BUFFERED, OUTPUT_DIFF };
+        for (int m = 0; m < 2; m++) {
+            string serial = playTurns(nullptr, modes[m]);
+            string threaded = playTurns(&executor, modes[m]);
+            CHECK(serial.find("[AI TAX DECISION]") != string::npos);
+            CHECK(serial.find("[HISTORY] Advanced to turn 4") != string::npos);
+            CHECK(serial == threaded);
+        }
+        return true;
+    } });
+}
+
+int main(int argc, char** argv) {
+    string only = argc > 1 ? argv[1] : "";
+
+    // Nothing may wait on the terminal; unscripted prompts find no answers
+    ReplayInput noInput;
+    InputProvider::setLocal(&noInput);
+
+    vector<TestCase> tests;
+    addTests(tests);
+
+    int ran = 0, failed = 0;
+    for (size_t t = 0; t < tests.size(); t++) {
+        if (!only.empty() && tests[t].name != only) continue;
+        bool passed;
+        {
+            MutedOutput muted;
+            passed = tests[t].run();
+        }
+        printf("%-40s %s\n", tests[t].name.c_str(), passed ? "ok" : "FAILED");
+        ran++;
+        if (!passed) failed++;
+    }
+
+    if (ran == 0) {
+        cerr << "Error: No test named " << only << ".\n";
+        return 1;
+    }
+    return failed > 0 ? 1 : 0;
+}
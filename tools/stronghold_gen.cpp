@@ -0,0 +1,348 @@
+#include "../Stronghold.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <thread>
+#include <atomic>
+
+// Generates large scenario files for benchmarks and stress tests.
+//
+//   stronghold_gen -n 1000000 -o world.txt [--binary] [--seed 42] [--threads 8]
+//                  [--population lognormal:4.6:0.5] [--treasury lognormal:6.9:0.6] ...
+//
+// Every kingdom draws from its own generator seeded by (seed, kingdom id), so
+// the output is the same for a given seed whatever the thread count.
+
+// Kingdoms generated per block of work
+static const int BLOCK_KINGDOMS = 4096;
+
+// Most loans a generated kingdom can have
+static const int MAX_GENERATED_LOANS = 8;
+
+// ========== Random Numbers ==========
+
+// SplitMix64: small, fast, and good enough to seed and draw from
+struct KingdomRandom {
+    uint64_t state;
+
+    KingdomRandom(uint64_t seed, uint64_t kingdom) {
+        state = seed ^ (kingdom * 0x9E3779B97F4A7C15ull);
+        next();
+    }
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform in [0, 1)
+    double uniform() {
+        return (next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    // Standard normal (Box-Muller)
+    double normal() {
+        double u = uniform();
+        if (u < 1e-300) u = 1e-300;
+        return sqrt(-2.0 * log(u)) * cos(6.283185307179586 * uniform());
+    }
+};
+
+// ========== Distributions ==========
+
+enum DistributionKind { DIST_CONST, DIST_UNIFORM, DIST_NORMAL, DIST_LOGNORMAL };
+
+// One configurable distribution, written `kind:a[:b]` on the command line
+struct Distribution {
+    DistributionKind kind;
+    double a, b;
+
+    double sample(KingdomRandom& random) const {
+        double value;
+        switch (kind) {
+        case DIST_UNIFORM:   value = a + (b - a) * random.uniform(); break;
+        case DIST_NORMAL:    value = a + b * random.normal(); break;
+        case DIST_LOGNORMAL: value = exp(a + b * random.normal()); break;
+        default:             value = a; break;
+        }
+        return value > 0.0 ? value : 0.0;
+    }
+};
+
+// Helper to parse `const:5`, `uniform:10:60`, `normal:500:100` or `lognormal:4.6:0.5`
+static bool parseDistribution(const char* text, Distribution& dist) {
+    char kind[16];
+    double a = 0.0, b = 0.0;
+    int fields = sscanf(text, "%15[a-z]:%lf:%lf", kind, &a, &b);
+    if (fields < 2) return false;
+
+    if (strcmp(kind, "const") == 0) dist.kind = DIST_CONST;
+    else if (strcmp(kind, "uniform") == 0 && fields == 3) dist.kind = DIST_UNIFORM;
+    else if (strcmp(kind, "normal") == 0 && fields == 3) dist.kind = DIST_NORMAL;
+    else if (strcmp(kind, "lognormal") == 0 && fields == 3) dist.kind = DIST_LOGNORMAL;
+    else return false;
+
+    dist.a = a;
+    dist.b = b;
+    return true;
+}
+
+// ========== Configuration ==========
+
+struct GeneratorConfig {
+    long long kingdoms = 1000;
+    string outputPath;
+    bool binary = false;
+    uint64_t seed = 1;
+    int threads = 0;
+    int mapSize = 1024;
+
+    // Defaults are centred on a new game (100 people, 1000 gold, 500 food, ...)
+    Distribution population = { DIST_LOGNORMAL, 4.6, 0.5 };
+    Distribution treasury = { DIST_LOGNORMAL, 6.9, 0.6 };
+    Distribution soldiers = { DIST_UNIFORM, 10.0, 60.0 };
+    Distribution happiness = { DIST_UNIFORM, 40.0, 90.0 };
+    Distribution taxRate = { DIST_UNIFORM, 2.0, 10.0 };
+    Distribution food = { DIST_NORMAL, 500.0, 100.0 };
+    Distribution wood = { DIST_NORMAL, 300.0, 60.0 };
+    Distribution stone = { DIST_NORMAL, 200.0, 40.0 };
+    Distribution iron = { DIST_NORMAL, 100.0, 25.0 };
+    Distribution loans = { DIST_UNIFORM, 0.0, 3.0 };
+};
+
+static void printUsage() {
+    cout << "Usage: stronghold_gen -n <kingdoms> -o <file> [options]\n"
+         << "  --binary               write the binary scenario format (default: text)\n"
+         << "  --seed <n>             generator seed (default 1)\n"
+         << "  --threads <n>          worker threads (default: all cores)\n"
+         << "  --map <size>           armies are placed on a size x size map (default 1024)\n"
+         << "  --population <dist>    people per kingdom\n"
+         << "  --treasury <dist>      gold per kingdom\n"
+         << "  --soldiers <dist>      soldiers per kingdom\n"
+         << "  --happiness <dist>     happiness (clamped to 0..100)\n"
+         << "  --tax <dist>           tax rate\n"
+         << "  --food|--wood|--stone|--iron <dist>   stockpiles\n"
+         << "  --loans <dist>         outstanding loans per kingdom (at most 8)\n"
+         << "A <dist> is const:v, uniform:lo:hi, normal:mean:sd or lognormal:mu:sigma.\n";
+}
+
+// Helper to parse the command line; false on any bad argument
+static bool parseArguments(int argc, char** argv, GeneratorConfig& config) {
+    struct NamedDistribution { const char* name; Distribution* dist; };
+    NamedDistribution named[] = {
+        { "--population", &config.population }, { "--treasury", &config.treasury },
+        { "--soldiers", &config.soldiers }, { "--happiness", &config.happiness },
+        { "--tax", &config.taxRate }, { "--food", &config.food }, { "--wood", &config.wood },
+        { "--stone", &config.stone }, { "--iron", &config.iron }, { "--loans", &config.loans }
+    };
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--binary") {
+            config.binary = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            cerr << "Error: " << arg << " needs a value.\n";
+            return false;
+        }
+        const char* value = argv[++i];
+
+        if (arg == "-n") config.kingdoms = atoll(value);
+        else if (arg == "-o") config.outputPath = value;
+        else if (arg == "--seed") config.seed = strtoull(value, nullptr, 10);
+        else if (arg == "--threads") config.threads = atoi(value);
+        else if (arg == "--map") config.mapSize = atoi(value);
+        else {
+            bool found = false;
+            for (size_t d = 0; d < sizeof(named) / sizeof(named[0]); d++) {
+                if (arg == named[d].name) {
+                    if (!parseDistribution(value, *named[d].dist)) {
+                        cerr << "Error: bad distribution '" << value << "' for " << arg << ".\n";
+                        return false;
+                    }
+                    found = true;
+                }
+            }
+            if (!found) {
+                cerr << "Error: unknown option " << arg << ".\n";
+                return false;
+            }
+        }
+    }
+
+    if (config.kingdoms <= 0 || config.kingdoms > INT32_MAX || config.outputPath.empty()) {
+        return false;
+    }
+    if (config.mapSize < 1) config.mapSize = 1;
+    return true;
+}
+
+// ========== Generation ==========
+
+// Helper to draw one kingdom; returns how many loans it has
+static int generateKingdom(const GeneratorConfig& config, int id, KingdomRecord& k, LoanRecord* loans) {
+    KingdomRandom random(config.seed, (uint64_t)id);
+    memset(&k, 0, sizeof(k));
+
+    // Population, split roughly 60/25/15 between the classes
+    k.total = (int)config.population.sample(random);
+    double peasantShare = 0.5 + 0.2 * random.uniform();
+    double merchantShare = (1.0 - peasantShare) * (0.5 + 0.2 * random.uniform());
+    k.peasants = (int)(k.total * peasantShare);
+    k.merchants = (int)(k.total * merchantShare);
+    k.nobles = k.total - k.peasants - k.merchants;
+    double happiness = config.happiness.sample(random);
+    k.happiness = (float)(happiness < 100.0 ? happiness : 100.0);
+    k.foodStock = (int)(k.total * (2.0 + 2.0 * random.uniform()));
+    // Cohorts stay zero: they are seeded from the class counts on load
+
+    // Army, with a random unit mix that sums to 1 and baseline training
+    k.soldiers = (int)config.soldiers.sample(random);
+    k.morale = 50 + (int)(40.0 * random.uniform());
+    k.armyFood = k.soldiers * 5;
+    float mixTotal = 0.0f;
+    for (int t = 0; t < UNIT_TYPES; t++) {
+        k.unitMix[t] = (float)(0.05 + random.uniform());
+        mixTotal += k.unitMix[t];
+    }
+    for (int t = 0; t < UNIT_TYPES; t++) {
+        k.unitMix[t] /= mixTotal;
+        k.unitStrength[t] = 1.0f;
+    }
+    k.armyX = (int)(random.next() % (uint64_t)config.mapSize);
+    k.armyY = (int)(random.next() % (uint64_t)config.mapSize);
+
+    // Economy and resources
+    k.treasury = (int)config.treasury.sample(random);
+    k.taxRate = (float)config.taxRate.sample(random);
+    k.inflation = (float)(100.0 + 10.0 * random.uniform());
+    k.food = (int)config.food.sample(random);
+    k.wood = (int)config.wood.sample(random);
+    k.stone = (int)config.stone.sample(random);
+    k.iron = (int)config.iron.sample(random);
+
+    // Bank: a few loans of up to half the treasury each
+    int loanCount = (int)config.loans.sample(random);
+    if (loanCount > MAX_GENERATED_LOANS) loanCount = MAX_GENERATED_LOANS;
+    for (int i = 0; i < loanCount; i++) {
+        loans[i].balance = floor(50.0 + k.treasury * 0.5 * random.uniform());
+        loans[i].rateTier = 1 + (int)(random.next() % 3);
+        loans[i].turnsLeft = 1 + (int)(random.next() % 20);
+        k.outstandingDebt += (int)loans[i].balance;
+    }
+    k.loansIssued = k.outstandingDebt;
+    return loanCount;
+}
+
+// One block of kingdoms, generated by a worker and written in order by main
+struct GeneratedBlock {
+    string text;                    // Text format
+    vector<KingdomRecord> records;  // Binary format
+    vector<ScenarioLoan> loans;
+};
+
+static void generateBlock(const GeneratorConfig& config, int first, int count, GeneratedBlock& block) {
+    KingdomRecord record;
+    LoanRecord loans[MAX_GENERATED_LOANS];
+
+    block.text.clear();
+    block.records.clear();
+    block.loans.clear();
+    for (int id = first; id < first + count; id++) {
+        int loanCount = generateKingdom(config, id, record, loans);
+        if (config.binary) {
+            block.records.push_back(record);
+            for (int i = 0; i < loanCount; i++) {
+                ScenarioLoan loan = { id, loans[i].rateTier, loans[i].turnsLeft, 0, loans[i].balance };
+                block.loans.push_back(loan);
+            }
+        } else {
+            appendKingdomText(block.text, id, record, loans, loanCount);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    GeneratorConfig config;
+    if (!parseArguments(argc, argv, config)) {
+        printUsage();
+        return 1;
+    }
+
+    FILE* out = fopen(config.outputPath.c_str(), "wb");
+    if (!out) {
+        cerr << "Error: Could not open " << config.outputPath << " for writing.\n";
+        return 1;
+    }
+
+    // Binary: the header is rewritten with the loan count at the end
+    ScenarioHeader header;
+    initScenarioHeader(header, (uint64_t)config.kingdoms, 0);
+    if (config.binary) {
+        fwrite(&header, sizeof(header), 1, out);
+    } else {
+        fprintf(out, "# Stronghold scenario: %lld kingdoms, seed %llu\n",
+                config.kingdoms, (unsigned long long)config.seed);
+    }
+
+    int threads = config.threads > 0 ? config.threads : (int)thread::hardware_concurrency();
+    if (threads <= 0) threads = 1;
+    int kingdoms = (int)config.kingdoms;
+    int blocks = (kingdoms + BLOCK_KINGDOMS - 1) / BLOCK_KINGDOMS;
+
+    // Rounds of one block per thread; main writes each round in block order
+    SmallVector<GeneratedBlock, 0> round((size_t)threads);
+    vector<ScenarioLoan> allLoans;
+    bool ok = true;
+    for (int firstBlock = 0; firstBlock < blocks && ok; firstBlock += threads) {
+        int roundBlocks = blocks - firstBlock < threads ? blocks - firstBlock : threads;
+
+        atomic<int> nextBlock(0);
+        auto worker = [&]() {
+            int b;
+            while ((b = nextBlock.fetch_add(1)) < roundBlocks) {
+                int first = (firstBlock + b) * BLOCK_KINGDOMS;
+                int count = kingdoms - first < BLOCK_KINGDOMS ? kingdoms - first : BLOCK_KINGDOMS;
+                generateBlock(config, first, count, round[b]);
+            }
+        };
+        SmallVector<thread, INLINE_THREADS> pool((size_t)(roundBlocks > 1 ? roundBlocks - 1 : 0));
+        for (int t = 0; t < roundBlocks - 1; t++) {
+            pool[t] = thread(worker);
+        }
+        worker();
+        for (int t = 0; t < roundBlocks - 1; t++) {
+            pool[t].join();
+        }
+
+        for (int b = 0; b < roundBlocks && ok; b++) {
+            if (config.binary) {
+                size_t count = round[b].records.size();
+                ok = fwrite(round[b].records.data(), sizeof(KingdomRecord), count, out) == count;
+                allLoans.insert(allLoans.end(), round[b].loans.begin(), round[b].loans.end());
+            } else {
+                size_t size = round[b].text.size();
+                ok = fwrite(round[b].text.data(), 1, size, out) == size;
+            }
+        }
+    }
+
+    if (ok && config.binary) {
+        ok = fwrite(allLoans.data(), sizeof(ScenarioLoan), allLoans.size(), out) == allLoans.size();
+        header.loanCount = allLoans.size();
+        ok = ok && fseek(out, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, out) == 1;
+    }
+    ok = fclose(out) == 0 && ok;
+
+    if (!ok) {
+        cerr << "Error: Could not write " << config.outputPath << ".\n";
+        return 1;
+    }
+    cout << "Wrote " << config.kingdoms << " kingdoms to " << config.outputPath
+         << (config.binary ? " (binary)" : " (text)") << endl;
+    return 0;
+}
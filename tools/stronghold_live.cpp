@@ -0,0 +1,71 @@
+#include "../Stronghold.h"
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+// Reads the live state of a game started with STRONGHOLD_LIVE_STATE set.
+//
+//   stronghold_live <name> [--kingdom k] [--watch ms] [--count n]
+//
+// Prints kingdom k (every kingdom if none is given) as of the latest turn.
+// --watch keeps printing every `ms` milliseconds, n times if --count is given.
+
+static void printKingdom(int kingdom, const KingdomRecord& record, uint32_t turn) {
+    printf("turn %u kingdom %d: treasury %d, population %d, soldiers %d, morale %d, "
+           "food %d, wood %d, stone %d, iron %d\n",
+           turn, kingdom, record.treasury, record.total, record.soldiers, record.morale, record.food, record.wood,
+           record.stone, record.iron);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        cout << "Usage: stronghold_live <name> [--kingdom k] [--watch ms] [--count n]\n";
+        return 1;
+    }
+
+    int kingdom = -1;
+    int watchMs = 0;
+    int count = -1;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        if (arg == "--kingdom") kingdom = atoi(argv[i + 1]);
+        else if (arg == "--watch") watchMs = atoi(argv[i + 1]);
+        else if (arg == "--count") count = atoi(argv[i + 1]);
+        else {
+            cerr << "Error: unknown option " << arg << ".\n";
+            return 1;
+        }
+    }
+    if (argc % 2 == 1 || watchMs < 0) {
+        cerr << "Error: Options take one value each.\n";
+        return 1;
+    }
+
+    LiveStateReader reader;
+    if (!reader.open(argv[1])) return 1;
+
+    vector<KingdomRecord> kingdoms;
+    KingdomRecord record;
+    uint32_t turn = 0;
+    for (int shown = 0; count < 0 || shown < count; shown++) {
+        if (kingdom >= 0) {
+            if (!reader.readKingdom(kingdom, record, turn)) {
+                cerr << "Error: No state for kingdom " << kingdom << " yet.\n";
+                return 1;
+            }
+            printKingdom(kingdom, record, turn);
+        } else {
+            if (!reader.snapshot(kingdoms, turn)) {
+                cerr << "Error: No turn has been published yet.\n";
+                return 1;
+            }
+            for (size_t k = 0; k < kingdoms.size(); k++) {
+                printKingdom((int)k, kingdoms[k], turn);
+            }
+        }
+        fflush(stdout);
+        if (watchMs == 0) break;
+        this_thread::sleep_for(chrono::milliseconds(watchMs));
+    }
+    return 0;
+}
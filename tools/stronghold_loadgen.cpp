@@ -0,0 +1,278 @@
+#include "../Stronghold.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <unordered_map>
+#ifdef __linux__
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#endif
+
+// Drives a stronghold_server and reports throughput and tail latency.
+//
+//   stronghold_loadgen (--unix path | --tcp port) [--connections 8] [--sessions 64]
+//                      [--depth 16] [--seconds 5]
+//
+// Each connection opens its own sessions, then keeps `depth` requests in
+// flight across them until time is up: a mix of population, tax, advance
+// turn (recruiting 5) and status commands. Sessions are closed at the end.
+
+struct LoadConfig {
+    string unixPath;
+    int port = 0;
+    int connections = 8;
+    int sessions = 64;      // Per connection
+    int depth = 16;         // Requests in flight per connection
+    double seconds = 5.0;
+};
+
+// What one connection measured
+struct LoadResult {
+    vector<uint32_t> latencies; // Nanoseconds
+    long long errors = 0;
+    bool failed = false;
+};
+
+#ifdef __linux__
+
+static uint64_t nowNanoseconds() {
+    return (uint64_t)chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int connectTo(const LoadConfig& config) {
+    int fd;
+    if (!config.unixPath.empty()) {
+        sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, config.unixPath.c_str(), sizeof(address.sun_path) - 1);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, (sockaddr*)&address, sizeof(address)) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    } else {
+        sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons((uint16_t)config.port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        int on = 1;
+        if (fd >= 0) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        if (fd >= 0 && connect(fd, (sockaddr*)&address, sizeof(address)) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    return fd;
+}
+
+static bool sendAll(int fd, const string& bytes) {
+    size_t sent = 0;
+    while (sent < bytes.size()) {
+        ssize_t n = send(fd, bytes.data() + sent, bytes.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        sent += (size_t)n;
+    }
+    return true;
+}
+
+// Helper to read at least one whole response into `responses`
+static bool readResponses(int fd, string& inbox, vector<ServerResponse>& responses) {
+    responses.clear();
+    char buffer[16 * 1024];
+    while (inbox.size() < sizeof(ServerResponse)) {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) return false;
+        inbox.append(buffer, (size_t)n);
+    }
+    size_t used = 0;
+    while (inbox.size() - used >= sizeof(ServerResponse)) {
+        ServerResponse response;
+        memcpy(&response, inbox.data() + used, sizeof(response));
+        responses.push_back(response);
+        used += sizeof(response);
+    }
+    inbox.erase(0, used);
+    return true;
+}
+
+static void appendRequest(string& out, uint32_t id, uint32_t session, uint8_t command,
+                          int32_t first = 0, int32_t second = 0, int valueCount = 0) {
+    ServerRequest request;
+    memset(&request, 0, sizeof(request));
+    request.requestId = id;
+    request.session = session;
+    request.command = command;
+    request.valueCount = (uint8_t)valueCount;
+    request.values[0] = first;
+    request.values[1] = second;
+    out.append((const char*)&request, sizeof(request));
+}
+
+// Helper to add the next request of the mix
+static void appendMixed(string& out, uint32_t id, uint32_t session) {
+    switch (id % 4) {
+    case 0: appendRequest(out, id, session, SERVER_PLAY, 2, 0, 1); break;  // Population
+    case 1: appendRequest(out, id, session, SERVER_PLAY, 4, 0, 1); break;  // Taxes
+    case 2: appendRequest(out, id, session, SERVER_PLAY, 10, 5, 2); break; // Next turn, recruit 5
+    default: appendRequest(out, id, session, SERVER_STATUS); break;
+    }
+}
+
+// Helper to send `out`, then wait for `count` responses that are not timed
+static bool exchange(int fd, string& inbox, string& out, int count, vector<ServerResponse>& all) {
+    if (!sendAll(fd, out)) return false;
+    out.clear();
+    all.clear();
+    vector<ServerResponse> responses;
+    while ((int)all.size() < count) {
+        if (!readResponses(fd, inbox, responses)) return false;
+        all.insert(all.end(), responses.begin(), responses.end());
+    }
+    return true;
+}
+
+static void runConnection(const LoadConfig& config, uint64_t deadline, LoadResult& result) {
+    int fd = connectTo(config);
+    if (fd < 0) {
+        result.failed = true;
+        return;
+    }
+
+    // Open this connection's sessions
+    string inbox, out;
+    vector<ServerResponse> responses;
+    uint32_t nextId = 1;
+    for (int s = 0; s < config.sessions; s++) {
+        appendRequest(out, nextId++, 0, SERVER_OPEN, s + 1, 0, 1);
+    }
+    vector<uint32_t> sessions;
+    if (!exchange(fd, inbox, out, config.sessions, responses)) {
+        result.failed = true;
+        close(fd);
+        return;
+    }
+    for (size_t i = 0; i < responses.size(); i++) {
+        if (responses[i].status == SERVER_OK) sessions.push_back(responses[i].session);
+    }
+    if (sessions.empty()) {
+        result.failed = true;
+        close(fd);
+        return;
+    }
+
+    // Keep `depth` requests in flight until the deadline, then drain
+    unordered_map<uint32_t, uint64_t> sentAt;
+    size_t nextSession = 0;
+    auto issue = [&]() {
+        uint32_t id = nextId++;
+        appendMixed(out, id, sessions[nextSession]);
+        nextSession = (nextSession + 1) % sessions.size();
+        sentAt[id] = nowNanoseconds();
+    };
+    for (int i = 0; i < config.depth; i++) issue();
+    while (!sentAt.empty()) {
+        if (!out.empty() && !sendAll(fd, out)) {
+            result.failed = true;
+            break;
+        }
+        out.clear();
+        if (!readResponses(fd, inbox, responses)) {
+            result.failed = true;
+            break;
+        }
+        uint64_t now = nowNanoseconds();
+        for (size_t i = 0; i < responses.size(); i++) {
+            unordered_map<uint32_t, uint64_t>::iterator sent = sentAt.find(responses[i].requestId);
+            if (sent == sentAt.end()) continue;
+            result.latencies.push_back((uint32_t)min<uint64_t>(now - sent->second, UINT32_MAX));
+            if (responses[i].status != SERVER_OK) result.errors++;
+            sentAt.erase(sent);
+            if (now < deadline) issue();
+        }
+    }
+
+    // Close the sessions
+    if (!result.failed) {
+        for (size_t s = 0; s < sessions.size(); s++) {
+            appendRequest(out, nextId++, sessions[s], SERVER_CLOSE);
+        }
+        exchange(fd, inbox, out, (int)sessions.size(), responses);
+    }
+    close(fd);
+}
+
+#endif
+
+int main(int argc, char** argv) {
+    LoadConfig config;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        if (arg == "--unix") config.unixPath = argv[i + 1];
+        else if (arg == "--tcp") config.port = atoi(argv[i + 1]);
+        else if (arg == "--connections") config.connections = atoi(argv[i + 1]);
+        else if (arg == "--sessions") config.sessions = atoi(argv[i + 1]);
+        else if (arg == "--depth") config.depth = atoi(argv[i + 1]);
+        else if (arg == "--seconds") config.seconds = atof(argv[i + 1]);
+        else {
+            cerr << "Error: unknown option " << arg << ".\n";
+            return 1;
+        }
+    }
+    if (argc % 2 == 0 || (config.unixPath.empty() && config.port <= 0) || config.connections < 1 ||
+        config.sessions < 1 || config.depth < 1 || config.seconds <= 0.0) {
+        cout << "Usage: stronghold_loadgen (--unix path | --tcp port) [--connections 8] [--sessions 64] "
+                "[--depth 16] [--seconds 5]\n";
+        return 1;
+    }
+
+#ifdef __linux__
+    SmallVector<LoadResult, 0> results((size_t)config.connections);
+    SmallVector<thread, INLINE_THREADS> clients((size_t)config.connections);
+    uint64_t start = nowNanoseconds();
+    uint64_t deadline = start + (uint64_t)(config.seconds * 1e9);
+    for (int c = 0; c < config.connections; c++) {
+        clients[c] = thread(runConnection, cref(config), deadline, ref(results[c]));
+    }
+    for (int c = 0; c < config.connections; c++) {
+        clients[c].join();
+    }
+    double elapsed = (double)(nowNanoseconds() - start) / 1e9;
+
+    vector<uint32_t> latencies;
+    long long errors = 0;
+    int failed = 0;
+    for (int c = 0; c < config.connections; c++) {
+        latencies.insert(latencies.end(), results[c].latencies.begin(), results[c].latencies.end());
+        errors += results[c].errors;
+        if (results[c].failed) failed++;
+    }
+    if (failed > 0) {
+        cerr << "Error: " << failed << " of " << config.connections << " connections failed.\n";
+    }
+    if (latencies.empty()) return 1;
+
+    sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) {
+        size_t index = (size_t)(p * (double)(latencies.size() - 1));
+        return latencies[index] / 1000.0;
+    };
+    printf("%zu requests in %.2f s: %.0f requests/s (%lld not OK)\n", latencies.size(), elapsed,
+           (double)latencies.size() / elapsed, errors);
+    printf("latency us: p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n", percentile(0.50),
+           percentile(0.90), percentile(0.99), percentile(0.999), latencies.back() / 1000.0);
+    return failed > 0 ? 1 : 0;
+#else
+    cerr << "Error: stronghold_loadgen needs Linux.\n";
+    return 1;
+#endif
+}
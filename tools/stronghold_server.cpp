@@ -0,0 +1,57 @@
+#include "../Stronghold.h"
+#include <cstdlib>
+#include <csignal>
+
+// Hosts many independent games behind a socket (see SessionServer for the protocol).
+//
+//   stronghold_server (--unix path | --tcp port)... [--threads n] [--save-dir dir]
+//
+// Runs until SIGINT or SIGTERM. stronghold_loadgen drives it.
+
+static SessionServer* running = nullptr;
+
+static void onSignal(int) {
+    if (running) running->stop();
+}
+
+int main(int argc, char** argv) {
+    vector<string> unixPaths;
+    vector<int> ports;
+    int threads = 0;
+    string saveDirectory = ".";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        if (arg == "--unix") unixPaths.push_back(argv[i + 1]);
+        else if (arg == "--tcp") ports.push_back(atoi(argv[i + 1]));
+        else if (arg == "--threads") threads = atoi(argv[i + 1]);
+        else if (arg == "--save-dir") saveDirectory = argv[i + 1];
+        else {
+            cerr << "Error: unknown option " << arg << ".\n";
+            return 1;
+        }
+    }
+    if (argc % 2 == 0 || (unixPaths.empty() && ports.empty())) {
+        cout << "Usage: stronghold_server (--unix path | --tcp port)... [--threads n] [--save-dir dir]\n";
+        return 1;
+    }
+
+    SessionServer server(threads, saveDirectory);
+    for (size_t i = 0; i < unixPaths.size(); i++) {
+        if (!server.listenUnix(unixPaths[i])) return 1;
+        cout << "Listening on " << unixPaths[i] << "\n";
+    }
+    for (size_t i = 0; i < ports.size(); i++) {
+        if (!server.listenTcp(ports[i])) return 1;
+        cout << "Listening on 127.0.0.1:" << ports[i] << "\n";
+    }
+    cout.flush();
+
+    running = &server;
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    bool served = server.run();
+    running = nullptr;
+
+    cout << "Stopped with " << server.getSessionCount() << " sessions open\n";
+    return served ? 0 : 1;
+}
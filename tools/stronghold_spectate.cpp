@@ -0,0 +1,53 @@
+#include "../Stronghold.h"
+#include <cstdlib>
+
+// Follows a game started with `stronghold --replicate socket`.
+//
+//   stronghold_spectate <socket> [--kingdom k] [--frames n]
+//
+// Prints one line per frame received: its size, whether it was full or a
+// delta, how many kingdoms changed, and a headline for kingdom k. Stops
+// after n frames, or when the game ends.
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        cout << "Usage: stronghold_spectate <socket> [--kingdom k] [--frames n]\n";
+        return 1;
+    }
+
+    int kingdom = 0;
+    int frames = -1;
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--kingdom" && i + 1 < argc) kingdom = atoi(argv[++i]);
+        else if (arg == "--frames" && i + 1 < argc) frames = atoi(argv[++i]);
+        else {
+            cerr << "Error: unknown option " << arg << ".\n";
+            return 1;
+        }
+    }
+
+    ReplicationSubscriber subscriber;
+    if (!subscriber.connect(argv[1])) return 1;
+
+    int received = 0;
+    uint64_t bytes = 0;
+    while ((frames < 0 || received < frames) && subscriber.receive()) {
+        if (!subscriber.hasWorld()) continue;
+        received++;
+        bytes += subscriber.getFrameBytes();
+
+        const PersistentVector<KingdomRecord>& world = subscriber.getWorld();
+        printf("turn %u: %s %zu bytes, %d changed", subscriber.getTurn(), subscriber.wasFull() ? "full " : "delta",
+               subscriber.getFrameBytes(), subscriber.getChangedCount());
+        if (kingdom >= 0 && (size_t)kingdom < world.size()) {
+            const KingdomRecord& record = world[(size_t)kingdom];
+            printf(" | population %d, soldiers %d, treasury %d, food %d", record.total, record.soldiers,
+                   record.treasury, record.food);
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+    cout << received << " frames, " << bytes << " bytes\n";
+    return received > 0 ? 0 : 1;
+}
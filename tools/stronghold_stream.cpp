@@ -0,0 +1,66 @@
+#include "../Stronghold.h"
+#include <cstdlib>
+#include <chrono>
+
+// Runs turns over a binary scenario too large to hold in memory.
+//
+//   stronghold_stream <world.bin> [--turns 1] [--chunk 65536] [--region 64] [--trace out.json]
+//
+// The file is updated in place; each turn prints world totals. --trace writes
+// a Chrome trace of the reader, compute and writer threads at the end.
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        cout << "Usage: stronghold_stream <world.bin> [--turns n] [--chunk kingdoms] [--region tiles] [--trace file]\n";
+        return 1;
+    }
+
+    int turns = 1;
+    int chunk = 65536;
+    int region = 64;
+    string tracePath;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        if (arg == "--turns") turns = atoi(argv[i + 1]);
+        else if (arg == "--chunk") chunk = atoi(argv[i + 1]);
+        else if (arg == "--region") region = atoi(argv[i + 1]);
+        else if (arg == "--trace") tracePath = argv[i + 1];
+        else {
+            cerr << "Error: unknown option " << arg << ".\n";
+            return 1;
+        }
+    }
+
+    if (!tracePath.empty()) {
+        Trace::setThreadName("stream compute");
+        Trace::setEnabled(true);
+    }
+
+    StreamingSimulator simulator(argv[1], chunk, region);
+    if (!simulator.open()) return 1;
+
+    for (int t = 0; t < turns; t++) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        if (!simulator.runTurn()) return 1;
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        long long population = 0, soldiers = 0, treasury = 0;
+        double supply = 0.0, demand = 0.0;
+        for (int r = 0; r < REGION_COUNT; r++) {
+            const RegionSummary& summary = simulator.getRegion(r);
+            population += summary.population;
+            soldiers += summary.soldiers;
+            treasury += summary.treasury;
+            supply += summary.foodSupply;
+            demand += summary.foodDemand;
+        }
+
+        cout << "Turn " << simulator.getTurn() << ": " << simulator.getKingdomCount() << " kingdoms in "
+             << seconds << " s | population " << population << ", soldiers " << soldiers
+             << ", treasury " << treasury << " | food offered " << (long long)supply
+             << ", wanted " << (long long)demand << endl;
+    }
+
+    if (!tracePath.empty() && !Trace::writeChromeTrace(tracePath)) return 1;
+    return 0;
+}
@@ -0,0 +1,186 @@
+#include "Stronghold.h"
+#include <mutex>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+// One finished span. Times are nanoseconds on the steady clock.
+struct TraceEvent {
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+};
+
+// One thread's spans. Only the owning thread appends: it fills the next slot,
+// then publishes it by bumping `published` with a release store, so a reader
+// that loads `published` with acquire sees complete events only.
+struct TraceBuffer {
+    SmallVector<TraceEvent, 0> events;
+    atomic<int> published;
+    atomic<uint64_t> dropped;
+    atomic<const char*> threadName;
+    int rowId;
+    TraceBuffer* next;
+    bool inUse;
+};
+
+atomic<bool> Trace::enabled(false);
+
+// Spans are exported relative to the first time tracing was switched on
+static atomic<uint64_t> traceEpoch(0);
+
+// Every buffer ever created; a finished thread's buffer is handed to the next
+// thread of the same name, whose spans continue on the same row
+static mutex registryLock;
+static TraceBuffer* registry = nullptr;
+static int nextRowId = 1;
+
+// Helper to give a thread a buffer, reusing one a finished thread left behind
+static TraceBuffer* acquireBuffer(const char* threadName) {
+    lock_guard<mutex> guard(registryLock);
+    for (TraceBuffer* buffer = registry; buffer; buffer = buffer->next) {
+        const char* owner = buffer->threadName.load(memory_order_relaxed);
+        bool sameName = owner == threadName || (owner && threadName && strcmp(owner, threadName) == 0);
+        if (!buffer->inUse && sameName && buffer->published.load(memory_order_relaxed) < TRACE_BUFFER_EVENTS) {
+            buffer->inUse = true;
+            return buffer;
+        }
+    }
+
+    TraceBuffer* buffer = new TraceBuffer();
+    buffer->events.resizeForOverwrite(TRACE_BUFFER_EVENTS);
+    buffer->published.store(0, memory_order_relaxed);
+    buffer->dropped.store(0, memory_order_relaxed);
+    buffer->threadName.store(threadName, memory_order_relaxed);
+    buffer->rowId = nextRowId++;
+    buffer->inUse = true;
+    buffer->next = registry;
+    registry = buffer;
+    return buffer;
+}
+
+// Returns the thread's buffer to the registry when the thread ends
+struct BufferHandle {
+    TraceBuffer* buffer = nullptr;
+    ~BufferHandle() {
+        if (buffer) {
+            lock_guard<mutex> guard(registryLock);
+            buffer->inUse = false;
+        }
+    }
+};
+
+static thread_local BufferHandle localBuffer;
+static thread_local const char* localThreadName = nullptr;
+
+// Buffers are only made for threads that record a span
+static inline TraceBuffer* buffer() {
+    TraceBuffer* current = localBuffer.buffer;
+    if (!current) {
+        current = acquireBuffer(localThreadName);
+        localBuffer.buffer = current;
+    }
+    return current;
+}
+
+// ========== Recording ==========
+
+void Trace::setEnabled(bool on) {
+    uint64_t unset = 0;
+    if (on) traceEpoch.compare_exchange_strong(unset, now());
+    enabled.store(on, memory_order_relaxed);
+}
+
+void Trace::setThreadName(const char* name) {
+    localThreadName = name;
+    if (localBuffer.buffer) {
+        localBuffer.buffer->threadName.store(name, memory_order_relaxed);
+    }
+}
+
+uint64_t Trace::now() {
+    return (uint64_t)chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Trace::record(const char* name, uint64_t start, uint64_t end) {
+    TraceBuffer* current = buffer();
+    int slot = current->published.load(memory_order_relaxed);
+    if (slot >= TRACE_BUFFER_EVENTS) {
+        current->dropped.store(current->dropped.load(memory_order_relaxed) + 1, memory_order_relaxed);
+        return;
+    }
+    current->events[slot].name = name;
+    current->events[slot].start = start;
+    current->events[slot].end = end;
+    current->published.store(slot + 1, memory_order_release);
+}
+
+// ========== Export ==========
+
+// Helper to print a time in microseconds, the unit Chrome traces use
+static void appendMicroseconds(string& out, uint64_t nanoseconds) {
+    char text[32];
+    snprintf(text, sizeof(text), "%llu.%03llu", (unsigned long long)(nanoseconds / 1000),
+             (unsigned long long)(nanoseconds % 1000));
+    out += text;
+}
+
+// Write every span published so far as Chrome trace-event JSON (temporary
+// file + rename). Recording carries on while this runs.
+bool Trace::writeChromeTrace(const string& path) {
+    uint64_t epoch = traceEpoch.load(memory_order_relaxed);
+    string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+
+    {
+        lock_guard<mutex> guard(registryLock);
+        for (TraceBuffer* buffer = registry; buffer; buffer = buffer->next) {
+            string row = to_string(buffer->rowId);
+            const char* threadName = buffer->threadName.load(memory_order_relaxed);
+            if (!first) out += ",\n";
+            first = false;
+            out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + row +
+                   ",\"args\":{\"name\":\"" + (threadName ? threadName : "thread " + row) + "\"}}";
+
+            int published = buffer->published.load(memory_order_acquire);
+            for (int i = 0; i < published; i++) {
+                const TraceEvent& event = buffer->events[i];
+                uint64_t start = event.start > epoch ? event.start - epoch : 0;
+                uint64_t duration = event.end > event.start ? event.end - event.start : 0;
+                out += ",\n{\"name\":\"";
+                out += event.name;
+                out += "\",\"ph\":\"X\",\"pid\":1,\"tid\":" + row + ",\"ts\":";
+                appendMicroseconds(out, start);
+                out += ",\"dur\":";
+                appendMicroseconds(out, duration);
+                out += "}";
+            }
+
+            uint64_t dropped = buffer->dropped.load(memory_order_relaxed);
+            if (dropped > 0) {
+                cerr << "Warning: Trace buffer of " << (threadName ? threadName : "thread " + row)
+                     << " was full; " << dropped << " spans were dropped.\n";
+            }
+        }
+    }
+    out += "\n]}\n";
+
+    string tempPath = path + ".tmp";
+    FILE* file = fopen(tempPath.c_str(), "wb");
+    if (!file) {
+        cerr << "Error: Could not open " << tempPath << " for the trace.\n";
+        return false;
+    }
+    bool written = fwrite(out.data(), 1, out.size(), file) == out.size();
+    written = fclose(file) == 0 && written;
+#ifdef _WIN32
+    remove(path.c_str()); // rename() does not replace there; elsewhere it swaps the file in atomically
+#endif
+    if (!written || rename(tempPath.c_str(), path.c_str()) != 0) {
+        cerr << "Error: Could not write the trace to " << path << ".\n";
+        remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
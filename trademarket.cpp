@@ -0,0 +1,232 @@
+#include "Stronghold.h"
+#include <thread>
+#include <atomic>
+#include <cmath>
+
+// Base gold price per unit of Food, Wood, Stone, Iron
+static const float BASE_PRICE[TRADE_RESOURCES] = { 2.0f, 3.0f, 4.0f, 8.0f };
+
+// Tatonnement settings
+static const int MAX_ITERATIONS = 60;
+static const float PRICE_STEP = 0.5f;
+static const float TOLERANCE = 0.001f;
+
+// Constructor allocates order and result arrays for every kingdom
+TradeMarket::TradeMarket(int kingdoms, int regions, int threads) {
+    kingdomCount = kingdoms > 0 ? kingdoms : 0;
+    regionCount = regions > 0 ? regions : 1;
+    threadCount = threads > 0 ? threads : (int)thread::hardware_concurrency();
+    if (threadCount <= 0) threadCount = 1;
+
+    kingdomRegion.resize(kingdomCount, 0);
+    willingness.resize(kingdomCount, 1.0f);
+    goldFlow.resize(kingdomCount, 0.0f);
+
+    for (int r = 0; r < TRADE_RESOURCES; r++) {
+        offered[r].resize(kingdomCount, 0.0f);
+        wanted[r].resize(kingdomCount, 0.0f);
+        budget[r].resize(kingdomCount, 0.0f);
+        filled[r].resize(kingdomCount, 0.0f);
+    }
+
+    prices.resize(regionCount * TRADE_RESOURCES);
+    iterationsUsed.resize(regionCount * TRADE_RESOURCES);
+    for (int g = 0; g < regionCount; g++) {
+        for (int r = 0; r < TRADE_RESOURCES; r++) {
+            prices[g * TRADE_RESOURCES + r] = BASE_PRICE[r];
+            iterationsUsed[g * TRADE_RESOURCES + r] = 0;
+        }
+    }
+
+    regionStart.resize(regionCount + 1);
+    regionMembers.resize(kingdomCount);
+}
+
+void TradeMarket::setRegion(int kingdom, int region) {
+    if (kingdom < 0 || kingdom >= kingdomCount) return;
+    if (region < 0 || region >= regionCount) return;
+    kingdomRegion[kingdom] = region;
+}
+
+// Post a raw order for one resource
+void TradeMarket::postOrder(int kingdom, int resource, float surplus, float deficit, float goldBudget) {
+    if (kingdom < 0 || kingdom >= kingdomCount) return;
+    if (resource < 0 || resource >= TRADE_RESOURCES) return;
+    offered[resource][kingdom] = surplus > 0.0f ? surplus : 0.0f;
+    wanted[resource][kingdom] = deficit > 0.0f ? deficit : 0.0f;
+    budget[resource][kingdom] = goldBudget > 0.0f ? goldBudget : 0.0f;
+}
+
+// Derive a kingdom's orders from its stocks and needs
+void TradeMarket::postOrders(int kingdom, const ResourceManager& res, const Population& pop,
+                             const Army& army, const Economy& eco) {
+    if (kingdom < 0 || kingdom >= kingdomCount) return;
+
+    int stock[TRADE_RESOURCES] = { res.getFood(), res.getWood(), res.getStone(), res.getIron() };
+
+    // Reserve each kingdom wants to keep: a turn of food, building stock, iron for the army
+    int reserve[TRADE_RESOURCES] = {
+        pop.getTotal() * 2 + army.getSoldiers(),
+        200,
+        150,
+        50 + army.getSoldiers()
+    };
+
+    // Split the treasury between resources in proportion to the value of each deficit
+    float deficitValue[TRADE_RESOURCES];
+    float totalValue = 0.0f;
+    for (int r = 0; r < TRADE_RESOURCES; r++) {
+        int deficit = reserve[r] - stock[r];
+        deficitValue[r] = deficit > 0 ? deficit * BASE_PRICE[r] : 0.0f;
+        totalValue += deficitValue[r];
+    }
+
+    int treasury = eco.getTreasury() > 0 ? eco.getTreasury() : 0;
+    for (int r = 0; r < TRADE_RESOURCES; r++) {
+        float goldBudget = totalValue > 0.0f ? treasury * deficitValue[r] / totalValue : 0.0f;
+        postOrder(kingdom, r, (float)(stock[r] - reserve[r]), (float)(reserve[r] - stock[r]), goldBudget);
+    }
+
+    // Richer kingdoms tolerate higher prices (1x to 3x the base price)
+    float wealth = treasury / 5000.0f;
+    willingness[kingdom] = 1.0f + (wealth > 2.0f ? 2.0f : wealth);
+}
+
+// Helper method to clear one market by tatonnement.
+// Sellers offer more as the price rises (p / (p + base)); buyers want less
+// (w / (p + w) with w their tolerated price) and never spend past their budget.
+void TradeMarket::clearMarket(int region, int resource) {
+    int market = region * TRADE_RESOURCES + resource;
+    const int* members = regionMembers.data() + regionStart[region];
+    int memberCount = regionStart[region + 1] - regionStart[region];
+    float base = BASE_PRICE[resource];
+    float price = prices[market];
+
+    const float* offer = offered[resource].data();
+    const float* want = wanted[resource].data();
+    const float* gold = budget[resource].data();
+
+    float supply = 0.0f, demand = 0.0f;
+    int iteration = 0;
+    for (; iteration < MAX_ITERATIONS; iteration++) {
+        supply = 0.0f;
+        demand = 0.0f;
+        float sellShare = price / (price + base);
+        for (int m = 0; m < memberCount; m++) {
+            int k = members[m];
+            supply += offer[k] * sellShare;
+            float tolerated = base * willingness[k];
+            float desired = want[k] * tolerated / (price + tolerated);
+            float affordable = gold[k] / price;
+            demand += desired < affordable ? desired : affordable;
+        }
+
+        if (supply + demand <= 0.0f) break;
+        float excess = (demand - supply) / (demand + supply);
+        if (fabs(excess) < TOLERANCE) break;
+
+        price *= 1.0f + PRICE_STEP * excess;
+        if (price < base * 0.1f) price = base * 0.1f;
+        if (price > base * 10.0f) price = base * 10.0f;
+    }
+
+    prices[market] = price;
+    iterationsUsed[market] = iteration;
+
+    // Ration the short side pro rata at the clearing price
+    float traded = supply < demand ? supply : demand;
+    float sellScale = supply > 0.0f ? traded / supply : 0.0f;
+    float buyScale = demand > 0.0f ? traded / demand : 0.0f;
+    float sellShare = price / (price + base);
+
+    for (int m = 0; m < memberCount; m++) {
+        int k = members[m];
+        float sold = offer[k] * sellShare * sellScale;
+        float tolerated = base * willingness[k];
+        float desired = want[k] * tolerated / (price + tolerated);
+        float affordable = gold[k] / price;
+        float bought = (desired < affordable ? desired : affordable) * buyScale;
+        filled[resource][k] = bought - sold;
+    }
+}
+
+// Clear every (region, resource) market in parallel
+void TradeMarket::clear() {
+    ScopedTrace span("market.clear");
+
+    // Group kingdoms by region
+    for (int g = 0; g <= regionCount; g++) {
+        regionStart[g] = 0;
+    }
+    for (int k = 0; k < kingdomCount; k++) {
+        regionStart[kingdomRegion[k] + 1]++;
+    }
+    for (int g = 0; g < regionCount; g++) {
+        regionStart[g + 1] += regionStart[g];
+    }
+    SmallVector<int, 64> fill((size_t)regionCount);
+    for (int g = 0; g < regionCount; g++) {
+        fill[g] = regionStart[g];
+    }
+    for (int k = 0; k < kingdomCount; k++) {
+        regionMembers[fill[kingdomRegion[k]]++] = k;
+    }
+
+    // Workers pull markets off a shared counter
+    int markets = regionCount * TRADE_RESOURCES;
+    atomic<int> nextMarket(0);
+    auto worker = [&]() {
+        ScopedTrace workerSpan("market.worker");
+        int market;
+        while ((market = nextMarket.fetch_add(1)) < markets) {
+            clearMarket(market / TRADE_RESOURCES, market % TRADE_RESOURCES);
+        }
+    };
+
+    int workers = threadCount < markets ? threadCount : markets;
+    SmallVector<thread, INLINE_THREADS> pool((size_t)(workers > 1 ? workers - 1 : 0));
+    for (int t = 0; t < workers - 1; t++) {
+        pool[t] = thread([&]() {
+            Trace::setThreadName("market worker");
+            worker();
+        });
+    }
+    worker();
+    for (int t = 0; t < workers - 1; t++) {
+        pool[t].join();
+    }
+
+    // Gold changes hands at each region's clearing prices
+    for (int k = 0; k < kingdomCount; k++) {
+        float flow = 0.0f;
+        for (int r = 0; r < TRADE_RESOURCES; r++) {
+            flow -= filled[r][k] * prices[kingdomRegion[k] * TRADE_RESOURCES + r];
+        }
+        goldFlow[k] = flow;
+    }
+}
+
+// Apply a kingdom's trades to its stockpile and treasury
+void TradeMarket::settle(int kingdom, ResourceManager& res, Economy& eco) const {
+    if (kingdom < 0 || kingdom >= kingdomCount) return;
+    for (int r = 0; r < TRADE_RESOURCES; r++) {
+        res.applyTrade(r, (int)lround(filled[r][kingdom]));
+    }
+    eco.settleTrade((int)lround(goldFlow[kingdom]));
+}
+
+float TradeMarket::getPrice(int region, int resource) const {
+    return prices[region * TRADE_RESOURCES + resource];
+}
+
+float TradeMarket::getFilled(int kingdom, int resource) const {
+    return filled[resource][kingdom];
+}
+
+float TradeMarket::getGoldFlow(int kingdom) const {
+    return goldFlow[kingdom];
+}
+
+int TradeMarket::getIterations(int region, int resource) const {
+    return iterationsUsed[region * TRADE_RESOURCES + resource];
+}
@@ -0,0 +1,55 @@
+#include "Stronghold.h"
+
+// ========== Overflow ==========
+
+void* TurnArena::Overflow::do_allocate(size_t size, size_t alignment) {
+    bytes += size;
+    return pmr::new_delete_resource()->allocate(size, alignment);
+}
+
+void TurnArena::Overflow::do_deallocate(void* pointer, size_t size, size_t alignment) {
+    pmr::new_delete_resource()->deallocate(pointer, size, alignment);
+}
+
+bool TurnArena::Overflow::do_is_equal(const pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+// ========== Arena ==========
+
+TurnArena::TurnArena(size_t initialCapacity) {
+    capacity = initialCapacity > 0 ? initialCapacity : TURN_ARENA_INITIAL_BYTES;
+    buffer.resizeForOverwrite(capacity);
+    arena = new pmr::monotonic_buffer_resource(buffer.data(), capacity, &overflow);
+}
+
+TurnArena::~TurnArena() {
+    delete arena;
+}
+
+TurnArena& TurnArena::local() {
+    static thread_local TurnArena arena;
+    return arena;
+}
+
+pmr::memory_resource* TurnArena::resource() {
+    return arena;
+}
+
+void TurnArena::reset() {
+    arena->release();
+    if (overflow.bytes == 0) return;
+
+    // The last turn spilled: make room for all of it next time
+    size_t needed = capacity + overflow.bytes;
+    while (capacity < needed) capacity *= 2;
+    overflow.bytes = 0;
+    delete arena;
+    buffer.clear(); // Nothing to keep, so nothing is copied
+    buffer.resizeForOverwrite(capacity);
+    arena = new pmr::monotonic_buffer_resource(buffer.data(), capacity, &overflow);
+}
+
+size_t TurnArena::getCapacity() const {
+    return capacity;
+}
@@ -0,0 +1,197 @@
+#include "Stronghold.h"
+
+// Constructor sets up an empty grid covering the whole map
+WorldMap::WorldMap(int width, int height, int cellSize) {
+    this->width = width > 0 ? width : 1;
+    this->height = height > 0 ? height : 1;
+    this->cellSize = cellSize > 0 ? cellSize : 1;
+    gridWidth = (this->width + this->cellSize - 1) / this->cellSize;
+    gridHeight = (this->height + this->cellSize - 1) / this->cellSize;
+
+    cellMembers.resize((size_t)gridWidth * gridHeight);
+
+    kingdomCount = 0;
+    activeKingdoms = 0;
+}
+
+// Helper method to find the grid cell holding a tile
+int WorldMap::cellOf(int x, int y) const {
+    return (y / cellSize) * gridWidth + (x / cellSize);
+}
+
+// Helper method to append a kingdom to a cell's member list
+void WorldMap::insertIntoCell(int id, int cell) {
+    kingdomCell[id] = cell;
+    kingdomSlot[id] = (int)cellMembers[cell].size();
+    cellMembers[cell].push_back(id);
+}
+
+// Helper method to drop a kingdom from its cell (swap with the last member)
+void WorldMap::removeFromCell(int id) {
+    int cell = kingdomCell[id];
+    int slot = kingdomSlot[id];
+    SmallVector<int, WORLD_CELL_INLINE>& members = cellMembers[cell];
+    int last = members.back();
+    members[slot] = last;
+    members.pop_back();
+    kingdomSlot[last] = slot;
+    kingdomCell[id] = -1;
+}
+
+// Place a kingdom on a tile and return its id
+int WorldMap::addKingdom(int x, int y) {
+    // Clamp to the map
+    if (x < 0) x = 0;
+    if (y < 0) y = 0;
+    if (x >= width) x = width - 1;
+    if (y >= height) y = height - 1;
+
+    int id = kingdomCount++;
+    kingdomX.push_back(x);
+    kingdomY.push_back(y);
+    kingdomCell.push_back(-1);
+    kingdomSlot.push_back(-1);
+    insertIntoCell(id, cellOf(x, y));
+    activeKingdoms++;
+    return id;
+}
+
+// Move a kingdom; only its old and new cell are touched
+void WorldMap::moveKingdom(int id, int x, int y) {
+    if (!isPlaced(id)) return;
+
+    if (x < 0) x = 0;
+    if (y < 0) y = 0;
+    if (x >= width) x = width - 1;
+    if (y >= height) y = height - 1;
+
+    int newCell = cellOf(x, y);
+    if (newCell != kingdomCell[id]) {
+        removeFromCell(id);
+        insertIntoCell(id, newCell);
+    }
+    kingdomX[id] = x;
+    kingdomY[id] = y;
+}
+
+// Take a kingdom off the map (its id is not reused)
+void WorldMap::removeKingdom(int id) {
+    if (!isPlaced(id)) return;
+    removeFromCell(id);
+    activeKingdoms--;
+}
+
+// Ids of kingdoms within `radius` tiles of (x, y)
+int WorldMap::queryRadius(int x, int y, int radius, int* results, int maxResults) const {
+    if (radius < 0) return 0;
+
+    int minCellX = (x - radius) / cellSize, maxCellX = (x + radius) / cellSize;
+    int minCellY = (y - radius) / cellSize, maxCellY = (y + radius) / cellSize;
+    if (x - radius < 0) minCellX = 0;
+    if (y - radius < 0) minCellY = 0;
+    if (maxCellX >= gridWidth) maxCellX = gridWidth - 1;
+    if (maxCellY >= gridHeight) maxCellY = gridHeight - 1;
+
+    long long radiusSquared = (long long)radius * radius;
+    int found = 0;
+
+    for (int gy = minCellY; gy <= maxCellY; gy++) {
+        for (int gx = minCellX; gx <= maxCellX; gx++) {
+            int cell = gy * gridWidth + gx;
+            int count = (int)cellMembers[cell].size();
+            if (count == 0) continue;
+            const int* members = cellMembers[cell].data();
+
+            // Cells entirely inside the circle need no per-kingdom distance test
+            long long farX = max(abs(gx * cellSize - x), abs((gx + 1) * cellSize - 1 - x));
+            long long farY = max(abs(gy * cellSize - y), abs((gy + 1) * cellSize - 1 - y));
+            if (farX * farX + farY * farY <= radiusSquared) {
+                for (int i = 0; i < count; i++) {
+                    if (found < maxResults) results[found] = members[i];
+                    found++;
+                }
+                continue;
+            }
+
+            for (int i = 0; i < count; i++) {
+                int id = members[i];
+                long long dx = kingdomX[id] - x;
+                long long dy = kingdomY[id] - y;
+                if (dx * dx + dy * dy <= radiusSquared) {
+                    if (found < maxResults) results[found] = id;
+                    found++;
+                }
+            }
+        }
+    }
+    return found;
+}
+
+// Ids of the k kingdoms closest to (x, y), nearest first.
+// Grid cells are visited in rings around the query cell until the next
+// ring cannot hold anything closer than the current k-th result.
+int WorldMap::queryNearest(int x, int y, int k, int* results) const {
+    if (k <= 0) return 0;
+
+    SmallVector<long long, 32> bestDistance((size_t)k);
+    int found = 0;
+    int centerX = (x < 0 ? 0 : x >= width ? width - 1 : x) / cellSize;
+    int centerY = (y < 0 ? 0 : y >= height ? height - 1 : y) / cellSize;
+    int maxRing = gridWidth > gridHeight ? gridWidth : gridHeight;
+
+    for (int ring = 0; ring <= maxRing; ring++) {
+        if (found == k && ring > 0) {
+            long long bound = (long long)(ring - 1) * cellSize + 1;
+            if (bound * bound > bestDistance[k - 1]) break;
+        }
+
+        for (int dy = -ring; dy <= ring; dy++) {
+            int gy = centerY + dy;
+            if (gy < 0 || gy >= gridHeight) continue;
+
+            // Interior rows only contribute their two edge cells
+            int step = (dy == -ring || dy == ring || ring == 0) ? 1 : 2 * ring;
+            for (int dx = -ring; dx <= ring; dx += step) {
+                int gx = centerX + dx;
+                if (gx < 0 || gx >= gridWidth) continue;
+
+                int cell = gy * gridWidth + gx;
+                const SmallVector<int, WORLD_CELL_INLINE>& members = cellMembers[cell];
+                for (size_t i = 0; i < members.size(); i++) {
+                    int id = members[i];
+                    long long ddx = kingdomX[id] - x;
+                    long long ddy = kingdomY[id] - y;
+                    long long distance = ddx * ddx + ddy * ddy;
+                    if (found == k && distance >= bestDistance[k - 1]) continue;
+
+                    // Insertion into the sorted result list
+                    int pos = found < k ? found++ : k - 1;
+                    while (pos > 0 && bestDistance[pos - 1] > distance) {
+                        bestDistance[pos] = bestDistance[pos - 1];
+                        results[pos] = results[pos - 1];
+                        pos--;
+                    }
+                    bestDistance[pos] = distance;
+                    results[pos] = id;
+                }
+            }
+        }
+    }
+
+    return found;
+}
+
+// Get the tile a kingdom stands on
+TilePosition WorldMap::getPosition(int id) const {
+    TilePosition position = { -1, -1 };
+    if (isPlaced(id)) {
+        position.x = kingdomX[id];
+        position.y = kingdomY[id];
+    }
+    return position;
+}
+
+// True if the id refers to a kingdom currently on the map
+bool WorldMap::isPlaced(int id) const {
+    return id >= 0 && id < kingdomCount && kingdomCell[id] >= 0;
+}